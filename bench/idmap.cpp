@@ -0,0 +1,104 @@
+#include <benchmark/benchmark.h>
+
+#include <piwcsprwmodel.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace piwcs::prw;
+
+namespace {
+
+/*
+ * The map IdMap was backed by before FlatMap, kept as a baseline.
+ */
+template <typename V>
+using NodeIdMap = std::unordered_map<Identifier, V, IdHash, std::equal_to<>>;
+
+std::vector<Identifier> makeKeys(std::size_t count) {
+    std::vector<Identifier> keys;
+    keys.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        keys.push_back("sec" + std::to_string(i));
+    }
+    return keys;
+}
+
+template <typename Map> void insert(benchmark::State &state) {
+    auto keys = makeKeys(static_cast<std::size_t>(state.range(0)));
+
+    for (auto _ : state) {
+        Map map;
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            map.emplace(keys[i], i);
+        }
+        benchmark::DoNotOptimize(map);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename Map> void lookupHit(benchmark::State &state) {
+    auto keys = makeKeys(static_cast<std::size_t>(state.range(0)));
+
+    Map map;
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        map.emplace(keys[i], i);
+    }
+
+    // Query as IdRefs in random order, like Model::node() does
+    std::vector<IdRef> queries(keys.begin(), keys.end());
+    std::shuffle(queries.begin(), queries.end(), std::mt19937(42)); // NOLINT
+
+    for (auto _ : state) {
+        std::size_t sum = 0;
+        for (IdRef query : queries) {
+            sum += map.find(query)->second;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename Map> void lookupMiss(benchmark::State &state) {
+    auto keys = makeKeys(static_cast<std::size_t>(state.range(0)));
+
+    Map map;
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        map.emplace(keys[i], i);
+    }
+
+    std::vector<Identifier> misses;
+    misses.reserve(keys.size());
+    for (const auto &key : keys) {
+        misses.push_back(key + "x");
+    }
+
+    for (auto _ : state) {
+        std::size_t found = 0;
+        for (const auto &miss : misses) {
+            found += map.contains(IdRef(miss)) ? 1 : 0;
+        }
+        benchmark::DoNotOptimize(found);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void sizes(benchmark::internal::Benchmark *b) {
+    b->RangeMultiplier(10)->Range(10'000, 1'000'000);
+    b->Unit(benchmark::kMillisecond);
+}
+
+} // namespace
+
+BENCHMARK(insert<IdMap<std::size_t>>)->Apply(sizes);
+BENCHMARK(insert<NodeIdMap<std::size_t>>)->Apply(sizes);
+BENCHMARK(lookupHit<IdMap<std::size_t>>)->Apply(sizes);
+BENCHMARK(lookupHit<NodeIdMap<std::size_t>>)->Apply(sizes);
+BENCHMARK(lookupMiss<IdMap<std::size_t>>)->Apply(sizes);
+BENCHMARK(lookupMiss<NodeIdMap<std::size_t>>)->Apply(sizes);
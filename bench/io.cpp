@@ -0,0 +1,289 @@
+#include <benchmark/benchmark.h>
+
+#include <piwcsprwmodel.h>
+
+#include "network.h"
+
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+using namespace piwcs::prw;
+
+namespace {
+
+Model destinationModelObject(std::size_t count) {
+    Model model;
+    for (std::size_t i = 0; i < count; i++) {
+        auto index = std::to_string(i);
+        model.newSection("s" + index, Section::AllowedTravel::UNIDIR,
+                         std::make_unique<Destination>("1." + index,
+                                                       "Dest " + index));
+    }
+    return model;
+}
+
+std::string destinationModel(std::size_t count) {
+    std::ostringstream out;
+    writeModel(out, destinationModelObject(count));
+    return std::move(out).str();
+}
+
+void readDestinationModel(benchmark::State &state) {
+    const std::string data =
+        destinationModel(static_cast<std::size_t>(state.range(0)));
+
+    for (auto _ : state) {
+        std::istringstream in(data);
+        benchmark::DoNotOptimize(readModel(in));
+    }
+
+    state.SetComplexityN(state.range(0));
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<std::int64_t>(data.size()));
+}
+
+void readDestinationModelBuffer(benchmark::State &state) {
+    const std::string data =
+        destinationModel(static_cast<std::size_t>(state.range(0)));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(readModelBuffer(data));
+    }
+
+    state.SetComplexityN(state.range(0));
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<std::int64_t>(data.size()));
+}
+
+void readDestinationModelParallel(benchmark::State &state) {
+    const std::string data =
+        destinationModel(static_cast<std::size_t>(state.range(0)));
+    auto threads = static_cast<unsigned>(state.range(1));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(readModelParallel(data, threads));
+    }
+
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<std::int64_t>(data.size()));
+}
+
+void readDestinationModelMapped(benchmark::State &state) {
+    std::string filename = (std::filesystem::temp_directory_path() /
+                            "piwcsprw-bench-mapped.json")
+                               .string();
+    auto count = static_cast<std::size_t>(state.range(0));
+    writeModel(filename, destinationModelObject(count));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(readModelMapped(filename));
+    }
+
+    state.SetComplexityN(state.range(0));
+    state.SetBytesProcessed(
+        state.iterations() *
+        static_cast<std::int64_t>(std::filesystem::file_size(filename)));
+    std::filesystem::remove(filename);
+}
+
+/*
+ * Measures dumping a model to a file in pretty or compact format.
+ */
+template <bool Pretty> void writeDestinationModel(benchmark::State &state) {
+    Model model =
+        destinationModelObject(static_cast<std::size_t>(state.range(0)));
+    std::string filename =
+        (std::filesystem::temp_directory_path() / "piwcsprw-bench-write.json")
+            .string();
+
+    for (auto _ : state) {
+        writeModel(filename, model, {.pretty = Pretty});
+    }
+
+    state.SetBytesProcessed(
+        state.iterations() *
+        static_cast<std::int64_t>(std::filesystem::file_size(filename)));
+    std::filesystem::remove(filename);
+}
+
+void writeDestinationModelParallel(benchmark::State &state) {
+    Model model =
+        destinationModelObject(static_cast<std::size_t>(state.range(0)));
+    WriterOptions options{.pretty = false,
+                          .threads = static_cast<unsigned>(state.range(1))};
+
+    std::size_t size = 0;
+    for (auto _ : state) {
+        std::string buffer;
+        writeModelBuffer(buffer, model, options);
+        size = buffer.size();
+        benchmark::DoNotOptimize(buffer);
+    }
+
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<std::int64_t>(size));
+}
+
+/*
+ * Measures parsing the definition of a generated network.
+ */
+void readNetwork(benchmark::State &state) {
+    std::ostringstream out;
+    auto count = static_cast<std::size_t>(state.range(0));
+    writeModel(out, bench::generateNetwork(count).build());
+    std::string data = std::move(out).str();
+
+    for (auto _ : state) {
+        std::istringstream in(data);
+        benchmark::DoNotOptimize(readModel(in));
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+/*
+ * Measures writing the definition of a generated network.
+ */
+void writeNetwork(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+    Model model = bench::generateNetwork(count).build();
+
+    for (auto _ : state) {
+        std::ostringstream out;
+        writeModel(out, model);
+        benchmark::DoNotOptimize(out);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/*
+ * Measures persisting a single edit through the journal, for comparison with
+ * writeDestinationModel.
+ */
+void journalEdit(benchmark::State &state) {
+    std::string snapshot =
+        (std::filesystem::temp_directory_path() / "piwcsprw-bench-jnl.prwbin")
+            .string();
+    std::string filename =
+        (std::filesystem::temp_directory_path() / "piwcsprw-bench.prwjnl")
+            .string();
+    std::filesystem::remove(filename);
+
+    writeModelBinary(snapshot, Model());
+    compactJournal(snapshot, filename);
+
+    {
+        Journal journal(filename);
+        for (auto _ : state) {
+            journal.setMetadata(Journal::Target::SECTION, "s1", "key",
+                                "value");
+            journal.flush();
+        }
+    }
+
+    std::filesystem::remove(snapshot);
+    std::filesystem::remove(filename);
+}
+
+/*
+ * Measures loading a model from a file at process startup, comparing the JSON
+ * definition with the binary snapshot.
+ */
+template <bool Binary> void loadDestinationModel(benchmark::State &state) {
+    Model model =
+        destinationModelObject(static_cast<std::size_t>(state.range(0)));
+    std::string filename =
+        (std::filesystem::temp_directory_path() /
+         (Binary ? "piwcsprw-bench.prwbin" : "piwcsprw-bench.json"))
+            .string();
+
+    if constexpr (Binary) {
+        writeModelBinary(filename, model);
+    } else {
+        writeModel(filename, model);
+    }
+
+    for (auto _ : state) {
+        if constexpr (Binary) {
+            benchmark::DoNotOptimize(readModelBinary(filename));
+        } else {
+            benchmark::DoNotOptimize(readModel(filename));
+        }
+    }
+
+    state.SetComplexityN(state.range(0));
+    state.SetBytesProcessed(
+        state.iterations() *
+        static_cast<std::int64_t>(std::filesystem::file_size(filename)));
+    std::filesystem::remove(filename);
+}
+
+} // namespace
+
+BENCHMARK(readDestinationModel)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond)
+    ->Complexity(benchmark::oN);
+
+BENCHMARK(readDestinationModelBuffer)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond)
+    ->Complexity(benchmark::oN);
+
+BENCHMARK(readDestinationModelParallel)
+    ->ArgsProduct({{1 << 14, 1 << 20}, {1, 2, 4, 8}})
+    ->ArgNames({"sections", "threads"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK(readDestinationModelMapped)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond)
+    ->Complexity(benchmark::oN);
+
+BENCHMARK(writeDestinationModel<true>)
+    ->Name("writeDestinationModel/pretty")
+    ->RangeMultiplier(32)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(writeDestinationModel<false>)
+    ->Name("writeDestinationModel/compact")
+    ->RangeMultiplier(32)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(writeDestinationModelParallel)
+    ->ArgsProduct({{1 << 14, 1 << 20}, {1, 2, 4, 8}})
+    ->ArgNames({"sections", "threads"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK(readNetwork)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(writeNetwork)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(journalEdit)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(loadDestinationModel<false>)
+    ->Name("loadDestinationModel/json")
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(loadDestinationModel<true>)
+    ->Name("loadDestinationModel/binary")
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond);
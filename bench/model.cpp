@@ -0,0 +1,310 @@
+#include <benchmark/benchmark.h>
+
+#include <piwcsprwmodel.h>
+
+#include "network.h"
+
+#include <string>
+#include <vector>
+
+using namespace piwcs::prw;
+
+namespace {
+
+void addDestinationSections(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+
+    for (auto _ : state) {
+        Model model;
+        for (std::size_t i = 0; i < count; i++) {
+            auto index = std::to_string(i);
+            model.newSection("s" + index, Section::AllowedTravel::UNIDIR,
+                             std::make_unique<Destination>("1." + index,
+                                                           "Dest " + index));
+        }
+        benchmark::DoNotOptimize(model);
+    }
+
+    state.SetComplexityN(state.range(0));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/*
+ * Measures adding the Nodes of a generated network to an empty Model.
+ */
+void addNetworkNodes(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+    auto network = bench::generateNetwork(count);
+
+    for (auto _ : state) {
+        Model model;
+        network.addNodes(model);
+        benchmark::DoNotOptimize(model);
+    }
+
+    state.SetItemsProcessed(state.iterations() * network.nodes.size());
+}
+
+/*
+ * Measures adding the Sections of a generated network to an empty Model.
+ */
+void addNetworkSections(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+    auto network = bench::generateNetwork(count);
+
+    for (auto _ : state) {
+        Model model;
+        network.addSections(model);
+        benchmark::DoNotOptimize(model);
+    }
+
+    state.SetItemsProcessed(state.iterations() * network.sections.size());
+}
+
+/*
+ * Measures linking all Sections of a generated network.
+ */
+void linkNetwork(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+    auto network = bench::generateNetwork(count);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        Model model;
+        network.addNodes(model);
+        network.addSections(model);
+        state.ResumeTiming();
+
+        network.link(model);
+        benchmark::DoNotOptimize(model);
+
+        state.PauseTiming();
+        model = Model();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * network.links.size());
+}
+
+/*
+ * Measures constructing a generated network from scratch, either edit by edit
+ * or with a ModelBuilder.
+ */
+template <bool Builder> void buildNetwork(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+    auto network = bench::generateNetwork(count);
+
+    for (auto _ : state) {
+        Model model;
+        if constexpr (Builder) {
+            ModelBuilder builder;
+            network.addTo(builder);
+            model = builder.build();
+        } else {
+            model = network.build();
+        }
+        benchmark::DoNotOptimize(model);
+
+        state.PauseTiming();
+        model = Model();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * network.sections.size());
+}
+
+/*
+ * Measures finding the Sections of one of 100 maintainers, with and without
+ * the metadata index. Each query follows an edit to one Section.
+ */
+template <bool Indexed> void findSectionsByMetadata(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+    auto network = bench::generateNetwork(count);
+    Model model = network.build();
+
+    for (std::size_t i = 0; i < network.sections.size(); i++) {
+        model.section(network.sections[i].id)->metadata("maintainer") =
+            "Team " + std::to_string(i % 100);
+    }
+    model.setMetadataIndexed(Indexed);
+    benchmark::DoNotOptimize(model.sectionsWithMetadata("maintainer"));
+
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const auto &def = network.sections[i++ % network.sections.size()];
+        model.section(def.id)->metadata("maintainer") = "Team 0";
+        benchmark::DoNotOptimize(
+            model.sectionsWithMetadata("maintainer", "Team 0"));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+/*
+ * Measures looking up every Section of a generated network by ID.
+ */
+void lookupNetworkSections(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+    auto network = bench::generateNetwork(count);
+    Model model = network.build();
+
+    for (auto _ : state) {
+        for (const auto &def : network.sections) {
+            benchmark::DoNotOptimize(model.section(def.id));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * network.sections.size());
+}
+
+/*
+ * Measures the completeness check of a generated network.
+ */
+void isNetworkComplete(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+    Model model = bench::generateNetwork(count).build();
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(isComplete(model));
+    }
+}
+
+/*
+ * Measures estimating the memory usage of a generated network.
+ */
+void networkMemoryUsage(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+    Model model = bench::generateNetwork(count).build();
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(model.memoryUsage());
+    }
+
+    state.counters["bytes"] =
+        static_cast<double>(model.memoryUsage().total());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/*
+ * Measures publishing a single metadata edit from a ModelStore of the given
+ * size.
+ */
+void publishEdit(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+
+    Model model;
+    for (std::size_t i = 0; i < count; i++) {
+        model.newSection("s" + std::to_string(i));
+    }
+    ModelStore store(std::move(model));
+
+    std::size_t i = 0;
+    for (auto _ : state) {
+        store.section("s" + std::to_string(i++ % count))->metadata("k") = "v";
+        benchmark::DoNotOptimize(store.publish());
+    }
+}
+
+/*
+ * Measures repeated Node lookups, comparing lookup by ID with cached handles.
+ */
+template <bool Handles> void lookupNodes(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+
+    Model model;
+    std::vector<Identifier> ids;
+    std::vector<NodeHandle> handles;
+    for (std::size_t i = 0; i < count; i++) {
+        ids.push_back("n" + std::to_string(i));
+        model.newNode(THRU, ids.back());
+        handles.push_back(model.nodeHandle(ids.back()));
+    }
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < count; i++) {
+            if constexpr (Handles) {
+                benchmark::DoNotOptimize(model.node(handles[i]));
+            } else {
+                benchmark::DoNotOptimize(model.node(ids[i]));
+            }
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+BENCHMARK(addDestinationSections)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond)
+    ->Complexity(benchmark::oN);
+
+BENCHMARK(addNetworkNodes)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(addNetworkSections)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(linkNetwork)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(buildNetwork<false>)
+    ->Name("buildNetwork/edits")
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(buildNetwork<true>)
+    ->Name("buildNetwork/builder")
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(findSectionsByMetadata<false>)
+    ->Name("findSectionsByMetadata/scan")
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(findSectionsByMetadata<true>)
+    ->Name("findSectionsByMetadata/index")
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(lookupNetworkSections)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(isNetworkComplete)->Range(1 << 10, 1 << 20);
+
+BENCHMARK(networkMemoryUsage)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(lookupNodes<false>)
+    ->Name("lookupNodes/id")
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(lookupNodes<true>)
+    ->Name("lookupNodes/handle")
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(publishEdit)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,172 @@
+#include "network.h"
+
+#include <random>
+#include <string>
+
+namespace piwcs::prw::bench {
+
+namespace {
+
+using Dir = Section::AllowedTravel;
+
+class Generator {
+
+    Network m_net;
+    std::mt19937 m_random;
+
+    // The open slot the next segment attaches to
+    std::size_t m_node = 0;
+    SlotId m_slot = 0;
+
+    std::size_t m_destinations = 0;
+
+    std::size_t node(NodeType type) {
+        m_net.nodes.push_back({type, "n" + std::to_string(m_net.nodes.size())});
+        return m_net.nodes.size() - 1;
+    }
+
+    std::size_t section(Dir dir = Dir::UNIDIR, bool destination = false) {
+        Identifier address;
+        if (destination) {
+            // Hierarchical addresses as used on PIWCS
+            address = std::to_string(m_destinations / 256 + 1) + "." +
+                      std::to_string(m_destinations % 256);
+            m_destinations++;
+        }
+        m_net.sections.push_back(
+            {"s" + std::to_string(m_net.sections.size()), dir, address});
+        return m_net.sections.size() - 1;
+    }
+
+    void link(std::size_t section, std::size_t start, SlotId startSlot,
+              std::size_t end, SlotId endSlot) {
+        m_net.links.push_back({section, start, startSlot, end, endSlot});
+    }
+
+    // Links a new section from the open slot to `slot` of `node`
+    void advance(std::size_t node, SlotId slot, bool destination = false) {
+        link(section(Dir::UNIDIR, destination), m_node, m_slot, node, slot);
+    }
+
+    // mt19937 output is fully specified, unlike standard distributions
+    unsigned percent() { return m_random() % 100; }
+
+    void thru() {
+        std::size_t n = node(THRU);
+        advance(n, 0, percent() < 3);
+        m_node = n;
+        m_slot = 1;
+    }
+
+    void siding() {
+        std::size_t m = node(MOTORIZED);
+        std::size_t p = node(PASSIVE);
+        advance(m, COMMON);
+        link(section(), m, STRAIGHT, p, STRAIGHT);
+        link(section(Dir::UNIDIR, percent() < 25), m, DIVERGING, p, DIVERGING);
+        m_node = p;
+        m_slot = COMMON;
+    }
+
+    void crossing() {
+        std::size_t c = node(CROSSING);
+        std::size_t a = node(END);
+        std::size_t b = node(END);
+        advance(c, 0);
+        link(section(Dir::BIDIR), a, 0, c, 2);
+        link(section(Dir::BIDIR), c, 3, b, 0);
+        m_node = c;
+        m_slot = 1;
+    }
+
+    void station() {
+        std::size_t m = node(MOTORIZED);
+        std::size_t e = node(END);
+        advance(m, COMMON);
+        link(section(Dir::BIDIR, true), m, DIVERGING, e, 0);
+        m_node = m;
+        m_slot = STRAIGHT;
+    }
+
+  public:
+    explicit Generator(std::uint32_t seed) : m_random(seed) {}
+
+    Network generate(std::size_t sections) {
+        std::size_t first = node(THRU);
+        m_node = first;
+        m_slot = 1;
+
+        while (m_net.sections.size() + 1 < sections) {
+            unsigned kind = percent();
+            if (kind < 70) {
+                thru();
+            } else if (kind < 85) {
+                siding();
+            } else if (kind < 90) {
+                crossing();
+            } else {
+                station();
+            }
+        }
+
+        // Close the loop
+        advance(first, 0);
+        return std::move(m_net);
+    }
+};
+
+std::unique_ptr<Destination> destination(const Network::SectionDef &def) {
+    if (def.address.empty()) {
+        return nullptr;
+    }
+    return std::make_unique<Destination>(def.address, "Station " + def.address);
+}
+
+} // namespace
+
+void Network::addNodes(Model &model) const {
+    for (const auto &def : nodes) {
+        model.newNode(def.type, def.id);
+    }
+}
+
+void Network::addSections(Model &model) const {
+    for (const auto &def : sections) {
+        model.newSection(def.id, def.dir, destination(def));
+    }
+}
+
+void Network::link(Model &model) const {
+    for (const auto &def : links) {
+        model.link(sections[def.section].id, nodes[def.start].id,
+                   def.startSlot, nodes[def.end].id, def.endSlot);
+    }
+}
+
+Model Network::build() const {
+    Model model;
+    addNodes(model);
+    addSections(model);
+    link(model);
+    return model;
+}
+
+void Network::addTo(ModelBuilder &builder) const {
+    builder.reserve(nodes.size(), sections.size());
+    for (const auto &def : nodes) {
+        builder.addNode(Node(def.type, def.id));
+    }
+    for (const auto &def : sections) {
+        builder.addSection(Section(def.id, def.dir, destination(def)));
+    }
+    for (const auto &def : links) {
+        builder.link(sections[def.section].id, nodes[def.start].id,
+                     def.startSlot, nodes[def.end].id, def.endSlot);
+    }
+}
+
+Network generateNetwork(std::size_t sections, std::uint32_t seed) {
+    return Generator(seed).generate(sections);
+}
+
+} // namespace piwcs::prw::bench
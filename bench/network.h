@@ -0,0 +1,73 @@
+#ifndef PIWCS_PRW_BENCH_NETWORK
+#define PIWCS_PRW_BENCH_NETWORK
+
+#include <piwcsprwmodel.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace piwcs::prw::bench {
+
+/*
+ * The definition of a synthetic PRW network, kept separate from a Model so
+ * that benchmarks can time individual construction steps.
+ *
+ * The network is a single loop of track built from randomly chosen segments:
+ *   - THRU nodes on plain track;
+ *   - passing sidings, a MOTORIZED and a PASSIVE switch joined by a straight
+ *     and a diverging track;
+ *   - CROSSINGs of the loop with a short bidirectional track between two END
+ *     nodes;
+ *   - dead-end stations, a MOTORIZED switch leading to a bidirectional
+ *     destination section and an END node.
+ *
+ * Every Node slot is linked, so the resulting Model is complete.
+ */
+struct Network {
+    struct NodeDef {
+        NodeType type;
+        Identifier id;
+    };
+
+    struct SectionDef {
+        Identifier id;
+        Section::AllowedTravel dir;
+
+        // Empty for sections that are not destinations
+        Identifier address;
+    };
+
+    struct LinkDef {
+        std::size_t section;
+        std::size_t start;
+        SlotId startSlot;
+        std::size_t end;
+        SlotId endSlot;
+    };
+
+    std::vector<NodeDef> nodes;
+    std::vector<SectionDef> sections;
+
+    // Indices into nodes and sections
+    std::vector<LinkDef> links;
+
+    void addNodes(Model &model) const;
+    void addSections(Model &model) const;
+    void link(Model &model) const;
+
+    [[nodiscard]] Model build() const;
+
+    // Adds all Nodes, Sections and links to a builder
+    void addTo(ModelBuilder &builder) const;
+};
+
+/*
+ * Generates a network with at least `sections` sections. The same size and
+ * seed always produce the same network on every platform.
+ */
+Network generateNetwork(std::size_t sections, std::uint32_t seed = 0);
+
+} // namespace piwcs::prw::bench
+
+#endif // PIWCS_PRW_BENCH_NETWORK
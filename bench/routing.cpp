@@ -0,0 +1,192 @@
+#include <benchmark/benchmark.h>
+
+#include <piwcsprwmodel.h>
+
+#include "network.h"
+
+#include <bit>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace piwcs::prw;
+
+namespace {
+
+/*
+ * A ring of THRU nodes joined by unidirectional sections with a destination
+ * every 64 sections.
+ */
+Model ringModel(std::size_t count) {
+    Model model;
+    for (std::size_t i = 0; i < count; i++) {
+        auto index = std::to_string(i);
+        model.newNode(THRU, "n" + index);
+        if (i % 64 == 0) {
+            model.newSection("s" + index, Section::AllowedTravel::UNIDIR,
+                             std::make_unique<Destination>(index, index));
+        } else {
+            model.newSection("s" + index);
+        }
+    }
+    for (std::size_t i = 0; i < count; i++) {
+        model.link("s" + std::to_string(i), "n" + std::to_string(i), 1,
+                   "n" + std::to_string((i + 1) % count), 0);
+    }
+    return model;
+}
+
+/*
+ * A ring of passing sidings, each a MOTORIZED and a PASSIVE node joined by two
+ * parallel sections, with a destination on every 16th diverging track.
+ */
+Model sidingModel(std::size_t count) {
+    Model model;
+    for (std::size_t i = 0; i < count; i++) {
+        auto index = std::to_string(i);
+        model.newNode(MOTORIZED, "M" + index);
+        model.newNode(PASSIVE, "P" + index);
+        model.newSection("a" + index);
+        model.newSection("b" + index);
+        if (i % 16 == 0) {
+            model.newSection("d" + index, Section::AllowedTravel::UNIDIR,
+                             std::make_unique<Destination>(index, index));
+        } else {
+            model.newSection("d" + index);
+        }
+        model.link("a" + index, "M" + index, 1, "P" + index, 1);
+        model.link("d" + index, "M" + index, 2, "P" + index, 2);
+    }
+    for (std::size_t i = 0; i < count; i++) {
+        model.link("b" + std::to_string(i), "P" + std::to_string(i), 0,
+                   "M" + std::to_string((i + 1) % count), 0);
+    }
+    return model;
+}
+
+void routeToNextDestination(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+    CompiledModel compiled(ringModel(count));
+    Router router(compiled);
+
+    // Query a few destinations from up to 64 sections upstream
+    std::mt19937 random(0); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+    std::uniform_int_distribution<CompiledModel::Index> pickDest(0, 15);
+    std::uniform_int_distribution<CompiledModel::Index> pickDistance(1, 64);
+
+    for (auto _ : state) {
+        auto dest = pickDest(random);
+        auto position = std::stoul(compiled.destinationAddress(dest));
+        auto section = compiled.sectionIndex(
+            "s" + std::to_string((position + count - pickDistance(random)) %
+                                 count));
+        benchmark::DoNotOptimize(router.route({section, false}, dest));
+    }
+}
+
+void computeRouteTree(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+    CompiledModel compiled(ringModel(count));
+
+    for (auto _ : state) {
+        Router router(compiled);
+        benchmark::DoNotOptimize(router.route({0, false}, 0));
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void computeSwitchTable(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+    CompiledModel compiled(sidingModel(count));
+    Router router(compiled);
+    auto threads = static_cast<unsigned>(state.range(1));
+
+    for (auto _ : state) {
+        SwitchTable table(router, threads);
+        benchmark::DoNotOptimize(table);
+    }
+
+    state.SetItemsProcessed(state.iterations() * compiled.destinationCount());
+}
+
+/*
+ * The (node, slot of entry) pair reached at the end of every section of a
+ * generated network.
+ */
+std::vector<std::pair<NodeType, SlotId>>
+traversalSteps(const CompiledModel &compiled) {
+    std::vector<std::pair<NodeType, SlotId>> steps;
+    steps.reserve(compiled.sectionCount());
+    for (CompiledModel::Index s = 0; s < compiled.sectionCount(); s++) {
+        steps.emplace_back(compiled.nodeType(compiled.sectionNode(s, 1)),
+                           compiled.sectionSlot(s, 1));
+    }
+    return steps;
+}
+
+/*
+ * Enumerates successor slots by testing every slot with couldTraverse.
+ */
+void traversalStepScan(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+    auto steps = traversalSteps(CompiledModel(
+        bench::generateNetwork(count).build()));
+
+    for (auto _ : state) {
+        SlotId sum = 0;
+        for (auto [type, from] : steps) {
+            for (SlotId to = 0; to < type->slotCount; to++) {
+                if (type->couldTraverse(from, to)) {
+                    sum += to;
+                }
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() *
+                            static_cast<std::int64_t>(steps.size()));
+}
+
+/*
+ * Enumerates successor slots with bit scans over the successor mask.
+ */
+void traversalStepMask(benchmark::State &state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+    auto steps = traversalSteps(CompiledModel(
+        bench::generateNetwork(count).build()));
+
+    for (auto _ : state) {
+        SlotId sum = 0;
+        for (auto [type, from] : steps) {
+            for (unsigned mask = type->successors(from); mask != 0;
+                 mask &= mask - 1) {
+                sum += static_cast<SlotId>(std::countr_zero(mask));
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() *
+                            static_cast<std::int64_t>(steps.size()));
+}
+
+} // namespace
+
+BENCHMARK(routeToNextDestination)->Range(1 << 12, 1 << 18);
+
+BENCHMARK(computeRouteTree)
+    ->Range(1 << 12, 1 << 18)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(computeSwitchTable)
+    ->ArgsProduct({{1 << 10, 1 << 13}, {1, 0}})
+    ->ArgNames({"sidings", "threads"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK(traversalStepScan)->Range(1 << 12, 1 << 18);
+
+BENCHMARK(traversalStepMask)->Range(1 << 12, 1 << 18);
@@ -152,14 +152,21 @@
 #include "piwcsprwmodel/fwd.h"
 
 #include "piwcsprwmodel/util.h"
+#include "piwcsprwmodel/handle.h"
 
+#include "piwcsprwmodel/nodetraits.h"
 #include "piwcsprwmodel/nodes.h"
 
 #include "piwcsprwmodel/section.h"
 
 #include "piwcsprwmodel/model.h"
+#include "piwcsprwmodel/builder.h"
+
+#include "piwcsprwmodel/compiled.h"
+#include "piwcsprwmodel/store.h"
 
 #include "piwcsprwmodel/io.h"
+#include "piwcsprwmodel/journal.h"
 
 #include "piwcsprwmodel/algorithms.h"
 
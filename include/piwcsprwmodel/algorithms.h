@@ -1,8 +1,13 @@
 #ifndef PIWCS_PRW_MODEL_ALGORITHMS
 #define PIWCS_PRW_MODEL_ALGORITHMS
 
+#include "compiled.h"
 #include "fwd.h"
 #include "model.h"
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
 
 /**
  * @file
@@ -18,12 +23,226 @@ namespace piwcs::prw {
  * To be complete, all slots that exist in the model must be connected. This
  * includes both Node and Section slots.
  *
+ * This check runs in constant time. Use Model::openSlots to find the empty
+ * Node slots of an incomplete Model.
+ *
  * @param model the Model to examine
  *
  * @return `true` if and only if the model is _complete_.
  */
 bool isComplete(const Model &model);
 
+/**
+ * A position of a routed train: a section of a CompiledModel and the
+ * direction the train is travelling in.
+ */
+struct TrackState {
+    /**
+     * The index of the section the train is in.
+     */
+    CompiledModel::Index section = CompiledModel::NONE;
+
+    /**
+     * `false` if the train travels from start to end of the section, `true` if
+     * the train travels from end to start.
+     */
+    bool reversed = false;
+
+    /**
+     * Compares two TrackStates.
+     */
+    bool operator==(const TrackState &) const = default;
+};
+
+/**
+ * A sequence of TrackStates, each reachable from the previous one.
+ */
+using Route = std::vector<TrackState>;
+
+/**
+ * A routing engine that finds shortest routes to destinations.
+ *
+ * Routes are searched in the directed graph of TrackStates. A train may
+ * proceed from one section into another when the node that connects them
+ * permits travel between their slots (see Node::couldTraverse) and the section
+ * it enters permits travel away from that node (see Section::canTraverse).
+ * Trains never reverse inside a section. Routes are shortest by the number of
+ * sections traversed. Among routes of equal length, routes that leave nodes
+ * through lower-numbered slots are preferred; in particular, `MOTORIZED`
+ * switches prefer their straight track.
+ *
+ * For each destination, the Router computes a reverse search tree that
+ * covers all TrackStates on the first query to that destination. Later
+ * queries to the same destination only walk the route. The trees take two
+ * bytes per section per destination.
+ *
+ * A Router may be queried from multiple threads concurrently. It references
+ * the CompiledModel it was constructed with, which must outlive the Router.
+ */
+class Router {
+
+    const CompiledModel &m_model;
+
+    std::vector<CompiledModel::Index> m_predBegin;
+    std::vector<CompiledModel::Index> m_preds;
+
+    mutable std::unique_ptr<std::once_flag[]> m_treeFlags;
+    mutable std::vector<std::vector<std::uint8_t>> m_trees;
+
+  public:
+    /**
+     * Constructs a Router for the given CompiledModel.
+     *
+     * @param model the CompiledModel to route in
+     */
+    explicit Router(const CompiledModel &model);
+
+    /**
+     * Returns the CompiledModel this Router operates on.
+     *
+     * @return the CompiledModel of this Router
+     */
+    [[nodiscard]] const CompiledModel &model() const { return m_model; }
+
+    /**
+     * Finds a shortest route from the given TrackState to the destination
+     * with the given address.
+     *
+     * The returned route starts with `from` and ends with a TrackState in the
+     * destination section. If `from` is in the destination section, the route
+     * consists of `from` only.
+     *
+     * @param from the initial position of the train
+     * @param address the address of the destination
+     *
+     * @return a shortest route, or an empty Route if the destination is
+     * unknown or unreachable
+     */
+    [[nodiscard]] Route route(TrackState from, std::string_view address) const;
+
+    /**
+     * Finds a shortest route from the given TrackState to the destination
+     * with the given index.
+     *
+     * @param from the initial position of the train
+     * @param dest the index of the destination, must be valid
+     *
+     * @return a shortest route, or an empty Route if the destination is
+     * unreachable
+     *
+     * @see route(TrackState, std::string_view)
+     */
+    [[nodiscard]] Route route(TrackState from,
+                              CompiledModel::Index dest) const;
+
+    /**
+     * Lists TrackStates that a train can proceed to from the given TrackState.
+     *
+     * @param from the current position of the train
+     *
+     * @return all TrackStates directly reachable from `from`
+     */
+    [[nodiscard]] std::vector<TrackState> successors(TrackState from) const;
+
+    /**
+     * Computes the search trees of all destinations in advance so that no
+     * later query has to.
+     */
+    void precompute() const;
+
+  private:
+    struct SearchBuffers;
+
+    void search(CompiledModel::Index dest, SearchBuffers &buffers) const;
+
+    const std::vector<std::uint8_t> &tree(CompiledModel::Index dest) const;
+
+    friend class SwitchTable;
+};
+
+/**
+ * Routing decisions of all `MOTORIZED` nodes for all destinations.
+ *
+ * Trains enter `MOTORIZED` nodes through their common track, and the node
+ * decides whether to direct the train towards its straight or its diverging
+ * track. A SwitchTable holds this decision for every `MOTORIZED` node and
+ * every destination of a CompiledModel, following the shortest routes found
+ * by Router. Each decision takes two bits.
+ */
+class SwitchTable {
+
+  public:
+    /**
+     * A routing decision of a `MOTORIZED` node.
+     */
+    enum class Choice : std::uint8_t {
+        /**
+         * The destination cannot be reached through this node, or the train
+         * is already at the destination.
+         */
+        NONE,
+
+        /**
+         * Trains should proceed to the straight track.
+         */
+        STRAIGHT,
+
+        /**
+         * Trains should proceed to the diverging track.
+         */
+        DIVERGING
+    };
+
+  private:
+    std::vector<CompiledModel::Index> m_nodes;
+    std::vector<CompiledModel::Index> m_rows;
+    CompiledModel::Index m_destinationCount;
+    std::size_t m_stride;
+    std::vector<std::uint8_t> m_choices;
+
+  public:
+    /**
+     * Computes the SwitchTable for the CompiledModel of the given Router.
+     *
+     * Destinations are processed in parallel by `threads` threads. Route
+     * trees computed by this constructor are not retained by the Router.
+     *
+     * @param router the Router to compute routes with
+     * @param threads the number of threads to use, or 0 to use all hardware
+     * threads
+     */
+    explicit SwitchTable(const Router &router, unsigned threads = 0);
+
+    /**
+     * Returns the indices of all `MOTORIZED` nodes in ascending order.
+     *
+     * @return the nodes described by this table
+     */
+    [[nodiscard]] const std::vector<CompiledModel::Index> &nodes() const {
+        return m_nodes;
+    }
+
+    /**
+     * Returns the number of destinations.
+     *
+     * @return the number of destinations described by this table
+     */
+    [[nodiscard]] CompiledModel::Index destinationCount() const {
+        return m_destinationCount;
+    }
+
+    /**
+     * Returns the routing decision of a node for a destination.
+     *
+     * @param node the index of the node, must be valid
+     * @param dest the index of the destination, must be valid
+     *
+     * @return the routing decision, or `NONE` if the node is not `MOTORIZED`
+     */
+    [[nodiscard]] Choice choice(CompiledModel::Index node,
+                                CompiledModel::Index dest) const;
+};
+
 } // namespace piwcs::prw
 
 #endif // PIWCS_PRW_MODEL_ALGORITHMS
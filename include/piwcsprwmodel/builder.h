@@ -0,0 +1,212 @@
+#ifndef PIWCS_PRW_MODEL_BUILDER
+#define PIWCS_PRW_MODEL_BUILDER
+
+#include "fwd.h"
+#include "io.h"
+#include "model.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @file
+ *
+ * This header declares ModelBuilder, which constructs large Models in bulk.
+ */
+
+namespace piwcs::prw {
+
+/**
+ * Constructs a Model from Nodes, Sections and links in bulk.
+ *
+ * Adding entities to a Model one by one validates and indexes each of them
+ * immediately. A builder instead collects entities and links in any order,
+ * validates all of them in a single pass, and then moves them into a Model
+ * whose tables are allocated once at their final size.
+ *
+ * The resulting Model is identical to one obtained by adding all Nodes and
+ * Sections to an empty Model and then applying all links.
+ *
+ * ```cpp
+ * ModelBuilder builder;
+ * builder.reserve(2, 1);
+ * builder.link("s1", "n1", 1, "n2", 0);
+ * builder.addSection(Section("s1"));
+ * builder.addNode(Node(THRU, "n1"));
+ * builder.addNode(Node(THRU, "n2"));
+ * Model model = builder.build();
+ * ```
+ */
+class ModelBuilder {
+
+  public:
+    /**
+     * A problem that prevents the Model from being built.
+     */
+    struct Violation {
+        /**
+         * Kinds of problems.
+         */
+        enum class Kind {
+            /**
+             * A Node ID is null or invalid.
+             */
+            NODE_BAD_ID,
+
+            /**
+             * A Node ID is used by an earlier Node.
+             */
+            NODE_DUPLICATE,
+
+            /**
+             * A Node references Sections.
+             */
+            NODE_HAS_REF,
+
+            /**
+             * A Section ID is null or invalid.
+             */
+            SECTION_BAD_ID,
+
+            /**
+             * A Section ID is used by an earlier Section.
+             */
+            SECTION_DUPLICATE,
+
+            /**
+             * A Section references Nodes.
+             */
+            SECTION_HAS_REF,
+
+            /**
+             * A destination address is used by an earlier Section.
+             */
+            ADDRESS_DUPLICATE,
+
+            /**
+             * A link refers to a missing Section, Node or slot.
+             */
+            LINK_NOT_FOUND,
+
+            /**
+             * A link connects a Node to itself.
+             */
+            LINK_SAME_NODE,
+
+            /**
+             * A link uses a Node slot that an earlier link uses.
+             */
+            LINK_NODE_OCCUPIED,
+
+            /**
+             * A link uses a Section that an earlier link uses.
+             */
+            LINK_SECTION_OCCUPIED
+        };
+
+        /**
+         * The kind of this problem.
+         */
+        Kind kind;
+
+        /**
+         * The ID of the offending Node or Section. For links, this is the ID
+         * of the Section.
+         */
+        Identifier id;
+
+        /**
+         * Returns a human-readable description of this problem.
+         *
+         * @return a description that includes the offending ID
+         */
+        [[nodiscard]] std::string message() const;
+    };
+
+  private:
+    struct LinkDef {
+        Identifier section;
+        Identifier startNode;
+        SlotId startSlot;
+        Identifier endNode;
+        SlotId endSlot;
+    };
+
+    struct ResolvedLink {
+        std::uint32_t section;
+        std::uint32_t start;
+        SlotId startSlot;
+        std::uint32_t end;
+        SlotId endSlot;
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<Section> m_sections;
+    std::vector<LinkDef> m_links;
+
+    bool m_validated = false;
+    std::vector<Violation> m_violations;
+    std::vector<ResolvedLink> m_resolved;
+
+  public:
+    /**
+     * Reserves memory for the given numbers of entities.
+     *
+     * @param nodes the expected number of Nodes
+     * @param sections the expected number of Sections, which is also the
+     * maximum number of links
+     */
+    void reserve(std::size_t nodes, std::size_t sections);
+
+    /**
+     * Adds a Node. The Node is validated by `validate`.
+     *
+     * @param node the Node to add
+     */
+    void addNode(Node node);
+
+    /**
+     * Adds a Section. The Section is validated by `validate`.
+     *
+     * @param section the Section to add
+     */
+    void addSection(Section section);
+
+    /**
+     * Adds a link between two Nodes. The Section and Nodes may be added
+     * before or after the link. The link is validated by `validate`.
+     *
+     * @param sectionId ID of the section to use
+     * @param startNodeId ID of the Node to connect to the start of the section
+     * @param startSlotId SlotId of the start Node to connect to
+     * @param endNodeId ID of the Node to connect to the end of the section
+     * @param endSlotId SlotId of the end Node to connect to
+     */
+    void link(IdRef sectionId, IdRef startNodeId, SlotId startSlotId,
+              IdRef endNodeId, SlotId endSlotId);
+
+    /**
+     * Checks all entities and links added so far.
+     *
+     * Nodes are checked first, then Sections, then links, each in the order
+     * they were added. All problems are reported, not just the first one.
+     *
+     * @return all problems found; empty if the Model can be built
+     */
+    const std::vector<Violation> &validate();
+
+    /**
+     * Moves all entities and links into a new Model and clears this builder.
+     *
+     * @exception IllegalModelError if `validate` reports problems; the
+     * builder is left unchanged
+     *
+     * @return the built Model
+     */
+    Model build();
+};
+
+} // namespace piwcs::prw
+
+#endif // PIWCS_PRW_MODEL_BUILDER
@@ -0,0 +1,314 @@
+#ifndef PIWCS_PRW_MODEL_COMPILED
+#define PIWCS_PRW_MODEL_COMPILED
+
+#include "fwd.h"
+#include "idmap.h"
+#include "model.h"
+#include "util.h"
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * @file
+ *
+ * This header declares the CompiledModel class.
+ */
+
+namespace piwcs::prw {
+
+/**
+ * An immutable, index-based snapshot of the structure of a Model.
+ *
+ * Nodes, sections and destinations of the source Model are renumbered to dense
+ * 32-bit indices. Connections are stored in flat arrays: each node has a
+ * contiguous range of slots holding section indices, and each section holds
+ * the indices and slots of its start and end nodes. Graph algorithms can
+ * traverse a CompiledModel without hashing or comparing strings.
+ *
+ * Indices are assigned in lexicographic order of IDs (and addresses for
+ * destinations), so that a CompiledModel does not depend on the iteration
+ * order of the source Model.
+ *
+ * Section lengths and costs are stored in dense float arrays, so that weighted
+ * searches read them without touching the source Model.
+ *
+ * A CompiledModel does not reference its source Model. It does not reflect
+ * changes made to the source Model after construction, and metadata is not
+ * included.
+ */
+class CompiledModel {
+
+  public:
+    /**
+     * Type of node, section and destination indices.
+     */
+    using Index = std::uint32_t;
+
+    /**
+     * The Index value that expresses the lack of an entity, e.g. an empty
+     * slot.
+     */
+    static constexpr Index NONE = std::numeric_limits<Index>::max();
+
+  private:
+    std::vector<Identifier> m_nodeIds;
+    std::vector<NodeType> m_nodeTypes;
+    std::vector<Index> m_slotBegin;
+    std::vector<Index> m_slotSections;
+
+    std::vector<Identifier> m_sectionIds;
+    std::vector<Section::AllowedTravel> m_sectionDirs;
+    std::vector<float> m_sectionLengths;
+    std::vector<float> m_sectionCosts;
+    std::vector<Index> m_sectionNodes;
+    std::vector<std::uint8_t> m_sectionSlots;
+    std::vector<Index> m_sectionDests;
+
+    std::vector<Destination::Address> m_destAddresses;
+    std::vector<Index> m_destSections;
+
+    IdMap<Index> m_nodeIndex;
+    IdMap<Index> m_sectionIndex;
+    IdMap<Index> m_destIndex;
+
+    template <typename Source> void compile(const Source &source);
+
+  public:
+    /**
+     * Compiles the given Model.
+     *
+     * @exception std::length_error if the Model has too many entities to be
+     * indexed with Index
+     *
+     * @param model the Model to compile
+     */
+    explicit CompiledModel(const Model &model);
+
+    /**
+     * Compiles the given ModelSnapshot.
+     *
+     * @exception std::length_error if the snapshot has too many entities to
+     * be indexed with Index
+     *
+     * @param snapshot the snapshot to compile
+     */
+    explicit CompiledModel(const ModelSnapshot &snapshot);
+
+    /**
+     * Returns the number of nodes.
+     *
+     * @return the number of nodes
+     */
+    [[nodiscard]] Index nodeCount() const {
+        return static_cast<Index>(m_nodeIds.size());
+    }
+
+    /**
+     * Returns the number of sections.
+     *
+     * @return the number of sections
+     */
+    [[nodiscard]] Index sectionCount() const {
+        return static_cast<Index>(m_sectionIds.size());
+    }
+
+    /**
+     * Returns the number of destinations.
+     *
+     * @return the number of destinations
+     */
+    [[nodiscard]] Index destinationCount() const {
+        return static_cast<Index>(m_destAddresses.size());
+    }
+
+    /**
+     * Finds the index of the node with the given ID.
+     *
+     * @param id the ID of the node to find
+     *
+     * @return the index of the node or `NONE`
+     */
+    [[nodiscard]] Index nodeIndex(IdRef id) const;
+
+    /**
+     * Finds the index of the section with the given ID.
+     *
+     * @param id the ID of the section to find
+     *
+     * @return the index of the section or `NONE`
+     */
+    [[nodiscard]] Index sectionIndex(IdRef id) const;
+
+    /**
+     * Finds the index of the destination with the given address.
+     *
+     * @param address the address of the destination to find
+     *
+     * @return the index of the destination or `NONE`
+     */
+    [[nodiscard]] Index destinationIndex(std::string_view address) const;
+
+    /**
+     * Returns the ID of a node.
+     *
+     * @param node the index of the node, must be valid
+     *
+     * @return the ID of the node
+     */
+    [[nodiscard]] IdRef nodeId(Index node) const { return m_nodeIds[node]; }
+
+    /**
+     * Returns the type of a node.
+     *
+     * @param node the index of the node, must be valid
+     *
+     * @return the type of the node
+     */
+    [[nodiscard]] NodeType nodeType(Index node) const {
+        return m_nodeTypes[node];
+    }
+
+    /**
+     * Returns the number of slots of a node.
+     *
+     * @param node the index of the node, must be valid
+     *
+     * @return the number of slots of the node
+     */
+    [[nodiscard]] SlotId slotCount(Index node) const {
+        return m_slotBegin[node + 1] - m_slotBegin[node];
+    }
+
+    /**
+     * Returns the section connected to a slot of a node.
+     *
+     * @param node the index of the node, must be valid
+     * @param slot the slot of the node, must be less than `slotCount(node)`
+     *
+     * @return the index of the section or `NONE` if the slot is empty
+     */
+    [[nodiscard]] Index slotSection(Index node, SlotId slot) const {
+        return m_slotSections[m_slotBegin[node] + slot];
+    }
+
+    /**
+     * Returns the ID of a section.
+     *
+     * @param section the index of the section, must be valid
+     *
+     * @return the ID of the section
+     */
+    [[nodiscard]] IdRef sectionId(Index section) const {
+        return m_sectionIds[section];
+    }
+
+    /**
+     * Returns the directionality of a section.
+     *
+     * @param section the index of the section, must be valid
+     *
+     * @return allowed travel directions of the section
+     */
+    [[nodiscard]] Section::AllowedTravel sectionDir(Index section) const {
+        return m_sectionDirs[section];
+    }
+
+    /**
+     * Returns the length of a section.
+     *
+     * @param section the index of the section, must be valid
+     *
+     * @return the length of the section
+     */
+    [[nodiscard]] float sectionLength(Index section) const {
+        return m_sectionLengths[section];
+    }
+
+    /**
+     * Returns the cost of travel through a section, i.e. its length
+     * multiplied by its cost multiplier.
+     *
+     * @param section the index of the section, must be valid
+     *
+     * @return the cost of the section
+     */
+    [[nodiscard]] float sectionCost(Index section) const {
+        return m_sectionCosts[section];
+    }
+
+    /**
+     * Returns the costs of all sections, indexed by section.
+     *
+     * @return a contiguous array of `sectionCount()` costs
+     */
+    [[nodiscard]] const std::vector<float> &sectionCosts() const {
+        return m_sectionCosts;
+    }
+
+    /**
+     * Returns the node connected to the start (`index == 0`) or the end
+     * (`index == 1`) of a section.
+     *
+     * @param section the index of the section, must be valid
+     * @param index 0 for start, 1 for end
+     *
+     * @return the index of the node or `NONE` if the section is not connected
+     */
+    [[nodiscard]] Index sectionNode(Index section, SlotId index) const {
+        return m_sectionNodes[2 * section + index];
+    }
+
+    /**
+     * Returns the slot of the node connected to the start (`index == 0`) or
+     * the end (`index == 1`) of a section.
+     *
+     * @param section the index of the section, must be valid
+     * @param index 0 for start, 1 for end
+     *
+     * @return the slot of the node or `SLOT_INVALID` if the section is not
+     * connected
+     */
+    [[nodiscard]] SlotId sectionSlot(Index section, SlotId index) const {
+        return m_sectionSlots[2 * section + index];
+    }
+
+    /**
+     * Returns the destination of a section.
+     *
+     * @param section the index of the section, must be valid
+     *
+     * @return the index of the destination or `NONE` if the section is not a
+     * destination
+     */
+    [[nodiscard]] Index sectionDestination(Index section) const {
+        return m_sectionDests[section];
+    }
+
+    /**
+     * Returns the address of a destination.
+     *
+     * @param dest the index of the destination, must be valid
+     *
+     * @return the address of the destination
+     */
+    [[nodiscard]] const Destination::Address &
+    destinationAddress(Index dest) const {
+        return m_destAddresses[dest];
+    }
+
+    /**
+     * Returns the section of a destination.
+     *
+     * @param dest the index of the destination, must be valid
+     *
+     * @return the index of the section
+     */
+    [[nodiscard]] Index destinationSection(Index dest) const {
+        return m_destSections[dest];
+    }
+};
+
+} // namespace piwcs::prw
+
+#endif // PIWCS_PRW_MODEL_COMPILED
@@ -0,0 +1,749 @@
+#ifndef PIWCS_PRW_MODEL_FLATMAP
+#define PIWCS_PRW_MODEL_FLATMAP
+
+#include "fwd.h"
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * @file
+ *
+ * This header declares FlatMap, an open-addressing hash map.
+ */
+
+namespace piwcs::prw::detail {
+
+/**
+ * An open-addressing hash map that stores entries in a single flat array.
+ *
+ * The layout follows the "Swiss table" design: each slot has a control byte
+ * that is either empty, deleted, or holds 7 bits of the hash of the key in
+ * the slot. Lookups scan the control bytes of 16 slots at a time (using SSE2
+ * where available) and only compare keys whose hash bits match.
+ *
+ * The interface is a subset of the `std::unordered_map` interface. Lookup is
+ * heterogeneous: any type accepted by `Hash` and `KeyEqual` may be used to
+ * find entries. Unlike `std::unordered_map`, all references, pointers and
+ * iterators to entries are invalidated when an insertion causes the map to
+ * grow. Erasure only invalidates references to the erased entry.
+ *
+ * As with `std::unordered_map`, an insertion that throws has no effect,
+ * provided that moving values does not throw.
+ */
+template <typename K, typename V, typename Hash, typename KeyEqual>
+class FlatMap {
+
+  public:
+    /**
+     * Type of keys.
+     */
+    using key_type = K;
+
+    /**
+     * Type of mapped values.
+     */
+    using mapped_type = V;
+
+    /**
+     * Type of entries.
+     */
+    using value_type = std::pair<const K, V>;
+
+    /**
+     * Type of sizes.
+     */
+    using size_type = std::size_t;
+
+    /**
+     * Type of the hash function.
+     */
+    using hasher = Hash;
+
+    /**
+     * Type of the key equality predicate.
+     */
+    using key_equal = KeyEqual;
+
+  private:
+    using ctrl_t = std::int8_t;
+
+    static constexpr ctrl_t EMPTY = -128;
+    static constexpr ctrl_t DELETED = -2;
+    static constexpr size_type GROUP = 16;
+
+    /*
+     * Control bytes of the table followed by GROUP - 1 clones of the first
+     * control bytes so that groups can be loaded at any position.
+     */
+    ctrl_t *m_ctrl = nullptr;
+    value_type *m_slots = nullptr;
+    size_type m_capacity = 0;
+    size_type m_size = 0;
+    size_type m_growthLeft = 0;
+
+    [[no_unique_address]] Hash m_hash{};
+    [[no_unique_address]] KeyEqual m_eq{};
+
+    /*
+     * A bitmask of positions in a group.
+     */
+    using Mask = std::uint32_t;
+
+    static Mask matchByte(const ctrl_t *group, ctrl_t value) {
+#ifdef __SSE2__
+        __m128i ctrl = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(group)); // NOLINT
+        return static_cast<Mask>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value))));
+#else
+        Mask mask = 0;
+        for (size_type i = 0; i < GROUP; i++) {
+            mask |= static_cast<Mask>(group[i] == value) << i;
+        }
+        return mask;
+#endif
+    }
+
+    static Mask matchEmptyOrDeleted(const ctrl_t *group) {
+#ifdef __SSE2__
+        // Empty and deleted control bytes are the only ones less than -1
+        __m128i ctrl = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(group)); // NOLINT
+        return static_cast<Mask>(
+            _mm_movemask_epi8(_mm_cmplt_epi8(ctrl, _mm_set1_epi8(-1))));
+#else
+        Mask mask = 0;
+        for (size_type i = 0; i < GROUP; i++) {
+            mask |= static_cast<Mask>(group[i] < -1) << i;
+        }
+        return mask;
+#endif
+    }
+
+    static size_type h1(size_type hash) { return hash >> 7; }
+
+    static ctrl_t h2(size_type hash) {
+        return static_cast<ctrl_t>(hash & 0x7F);
+    }
+
+    static size_type growthFor(size_type capacity) {
+        return capacity - capacity / 8;
+    }
+
+    void setCtrl(size_type index, ctrl_t value) {
+        m_ctrl[index] = value;
+        if (index < GROUP - 1) {
+            m_ctrl[m_capacity + index] = value;
+        }
+    }
+
+    template <typename Q> size_type findIndex(const Q &key) const {
+        if (m_capacity == 0) {
+            return m_capacity;
+        }
+
+        size_type hash = m_hash(key);
+        ctrl_t tag = h2(hash);
+        size_type mask = m_capacity - 1;
+        size_type pos = h1(hash) & mask;
+
+        for (size_type step = GROUP;; step += GROUP) {
+            const ctrl_t *group = m_ctrl + pos;
+
+            for (Mask m = matchByte(group, tag); m != 0; m &= m - 1) {
+                size_type index = (pos + std::countr_zero(m)) & mask;
+                if (m_eq(m_slots[index].first, key)) {
+                    return index;
+                }
+            }
+
+            if (matchByte(group, EMPTY) != 0) {
+                return m_capacity;
+            }
+
+            pos = (pos + step) & mask;
+        }
+    }
+
+    size_type findFree(size_type hash) const {
+        size_type mask = m_capacity - 1;
+        size_type pos = h1(hash) & mask;
+
+        for (size_type step = GROUP;; step += GROUP) {
+            Mask m = matchEmptyOrDeleted(m_ctrl + pos);
+            if (m != 0) {
+                return (pos + std::countr_zero(m)) & mask;
+            }
+            pos = (pos + step) & mask;
+        }
+    }
+
+    /*
+     * Allocates control bytes and uninitialized slots for a table of the
+     * given capacity. Nothing is leaked if either allocation throws.
+     */
+    static std::pair<ctrl_t *, value_type *> allocate(size_type capacity) {
+        std::unique_ptr<ctrl_t[]> ctrl(new ctrl_t[capacity + GROUP - 1]);
+        value_type *slots = std::allocator<value_type>().allocate(capacity);
+        std::memset(ctrl.get(), EMPTY, capacity + GROUP - 1);
+        return {ctrl.release(), slots};
+    }
+
+    void release() {
+        if (m_capacity == 0) {
+            return;
+        }
+
+        for (size_type i = 0; i < m_capacity; i++) {
+            if (m_ctrl[i] >= 0) {
+                std::destroy_at(&m_slots[i]);
+            }
+        }
+
+        delete[] m_ctrl;
+        std::allocator<value_type>().deallocate(m_slots, m_capacity);
+        m_ctrl = nullptr;
+        m_slots = nullptr;
+        m_capacity = 0;
+        m_size = 0;
+        m_growthLeft = 0;
+    }
+
+    /*
+     * Moves all entries into a new table, leaving the map unchanged if an
+     * exception is thrown.
+     *
+     * The new table is allocated before the map is modified. Moving an entry
+     * copies its key, so old entries are only destroyed once all of them have
+     * been moved; if a copy throws, moved values are moved back.
+     */
+    void resize(size_type capacity) {
+        auto [ctrl, slots] = allocate(capacity);
+
+        ctrl_t *oldCtrl = std::exchange(m_ctrl, ctrl);
+        value_type *oldSlots = std::exchange(m_slots, slots);
+        size_type oldCapacity = std::exchange(m_capacity, capacity);
+
+        size_type moved = 0;
+        try {
+            for (; moved < oldCapacity; moved++) {
+                if (oldCtrl[moved] < 0) {
+                    continue;
+                }
+
+                size_type hash = m_hash(oldSlots[moved].first);
+                size_type index = findFree(hash);
+                std::construct_at(&m_slots[index], std::move(oldSlots[moved]));
+                setCtrl(index, h2(hash));
+            }
+        } catch (...) {
+            for (size_type i = 0; i < moved; i++) {
+                if (oldCtrl[i] < 0) {
+                    continue;
+                }
+
+                size_type index = findIndex(oldSlots[i].first);
+                oldSlots[i].second = std::move(m_slots[index].second);
+                std::destroy_at(&m_slots[index]);
+            }
+
+            delete[] m_ctrl;
+            std::allocator<value_type>().deallocate(m_slots, m_capacity);
+            m_ctrl = oldCtrl;
+            m_slots = oldSlots;
+            m_capacity = oldCapacity;
+            throw;
+        }
+
+        m_growthLeft = growthFor(capacity) - m_size;
+
+        if (oldCapacity != 0) {
+            for (size_type i = 0; i < oldCapacity; i++) {
+                if (oldCtrl[i] >= 0) {
+                    std::destroy_at(&oldSlots[i]);
+                }
+            }
+            delete[] oldCtrl;
+            std::allocator<value_type>().deallocate(oldSlots, oldCapacity);
+        }
+    }
+
+    static size_type capacityFor(size_type count) {
+        // Smallest power of two with enough growth for count entries
+        size_type capacity = GROUP;
+        while (growthFor(capacity) < count) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    void reserveOne() {
+        if (m_growthLeft > 0) {
+            return;
+        }
+
+        if (m_capacity != 0 && m_size < growthFor(m_capacity) / 2) {
+            // Mostly deleted entries: rehash in place to reclaim them
+            resize(m_capacity);
+        } else {
+            resize(m_capacity == 0 ? GROUP : m_capacity * 2);
+        }
+    }
+
+    template <bool Const> class Iterator {
+
+        using map_ptr = std::conditional_t<Const, const FlatMap *, FlatMap *>;
+
+        map_ptr m_map = nullptr;
+        size_type m_index = 0;
+
+        Iterator(map_ptr map, size_type index) : m_map(map), m_index(index) {}
+
+        void settle() {
+            while (m_index < m_map->m_capacity &&
+                   m_map->m_ctrl[m_index] < 0) {
+                m_index++;
+            }
+        }
+
+        friend class FlatMap;
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer =
+            std::conditional_t<Const, const value_type *, value_type *>;
+        using reference =
+            std::conditional_t<Const, const value_type &, value_type &>;
+
+        Iterator() = default;
+
+        // Allow conversion from iterator to const_iterator
+        // NOLINTNEXTLINE(google-explicit-constructor)
+        template <bool C = Const>
+            requires C
+        Iterator(const Iterator<false> &other)
+            : m_map(other.m_map), m_index(other.m_index) {}
+
+        reference operator*() const { return m_map->m_slots[m_index]; }
+
+        pointer operator->() const { return &m_map->m_slots[m_index]; }
+
+        Iterator &operator++() {
+            m_index++;
+            settle();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return m_index == other.m_index;
+        }
+
+        friend class Iterator<true>;
+    };
+
+  public:
+    /**
+     * Forward iterator over entries.
+     */
+    using iterator = Iterator<false>;
+
+    /**
+     * Forward iterator over entries that does not allow modification.
+     */
+    using const_iterator = Iterator<true>;
+
+    /**
+     * Constructs an empty map. No memory is allocated.
+     */
+    FlatMap() = default;
+
+    /**
+     * Constructs a map with the given entries.
+     *
+     * @param init the entries to insert
+     */
+    FlatMap(std::initializer_list<value_type> init) {
+        reserve(init.size());
+        for (const auto &entry : init) {
+            insert(entry);
+        }
+    }
+
+    /**
+     * Copies a map.
+     */
+    FlatMap(const FlatMap &other) : m_hash(other.m_hash), m_eq(other.m_eq) {
+        reserve(other.size());
+        for (const auto &entry : other) {
+            insert(entry);
+        }
+    }
+
+    /**
+     * Moves a map. `other` is left empty.
+     */
+    FlatMap(FlatMap &&other) noexcept
+        : m_ctrl(std::exchange(other.m_ctrl, nullptr)),
+          m_slots(std::exchange(other.m_slots, nullptr)),
+          m_capacity(std::exchange(other.m_capacity, 0)),
+          m_size(std::exchange(other.m_size, 0)),
+          m_growthLeft(std::exchange(other.m_growthLeft, 0)),
+          m_hash(std::move(other.m_hash)), m_eq(std::move(other.m_eq)) {}
+
+    /**
+     * Copies a map.
+     */
+    FlatMap &operator=(const FlatMap &other) {
+        if (this != &other) {
+            FlatMap copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    /**
+     * Moves a map. `other` is left empty.
+     */
+    FlatMap &operator=(FlatMap &&other) noexcept {
+        if (this != &other) {
+            FlatMap moved(std::move(other));
+            swap(moved);
+        }
+        return *this;
+    }
+
+    ~FlatMap() { release(); }
+
+    /**
+     * Swaps the contents of two maps.
+     */
+    void swap(FlatMap &other) noexcept {
+        std::swap(m_ctrl, other.m_ctrl);
+        std::swap(m_slots, other.m_slots);
+        std::swap(m_capacity, other.m_capacity);
+        std::swap(m_size, other.m_size);
+        std::swap(m_growthLeft, other.m_growthLeft);
+        std::swap(m_hash, other.m_hash);
+        std::swap(m_eq, other.m_eq);
+    }
+
+    /**
+     * Returns an iterator to the first entry.
+     */
+    iterator begin() {
+        iterator it(this, 0);
+        it.settle();
+        return it;
+    }
+
+    /**
+     * Returns an iterator to the first entry.
+     */
+    const_iterator begin() const {
+        const_iterator it(this, 0);
+        it.settle();
+        return it;
+    }
+
+    /**
+     * Returns an iterator to the first entry.
+     */
+    const_iterator cbegin() const { return begin(); }
+
+    /**
+     * Returns the past-the-end iterator.
+     */
+    iterator end() { return {this, m_capacity}; }
+
+    /**
+     * Returns the past-the-end iterator.
+     */
+    const_iterator end() const { return {this, m_capacity}; }
+
+    /**
+     * Returns the past-the-end iterator.
+     */
+    const_iterator cend() const { return end(); }
+
+    /**
+     * Checks whether the map has no entries.
+     */
+    [[nodiscard]] bool empty() const { return m_size == 0; }
+
+    /**
+     * Returns the number of entries.
+     */
+    [[nodiscard]] size_type size() const { return m_size; }
+
+    /**
+     * Returns the number of slots in the table.
+     */
+    [[nodiscard]] size_type bucket_count() const { return m_capacity; }
+
+    /**
+     * Returns the number of entries that can be inserted into empty slots
+     * before the table is rehashed. Existing entries keep their addresses
+     * until then.
+     */
+    [[nodiscard]] size_type growth_left() const { return m_growthLeft; }
+
+    /**
+     * Returns the size of the memory allocated for the table, in bytes.
+     * Memory owned by keys and values is not included.
+     */
+    [[nodiscard]] size_type allocated_bytes() const {
+        if (m_capacity == 0) {
+            return 0;
+        }
+        return m_capacity * sizeof(value_type) + m_capacity + GROUP - 1;
+    }
+
+    /**
+     * Removes all entries and releases memory.
+     */
+    void clear() { release(); }
+
+    /**
+     * Ensures that `count` entries can be stored without growing the table.
+     *
+     * @param count the number of entries to reserve space for
+     */
+    void reserve(size_type count) {
+        if (count > m_size + m_growthLeft) {
+            resize(capacityFor(count));
+        }
+    }
+
+    /**
+     * Finds the entry with the given key.
+     *
+     * @param key the key to look up
+     *
+     * @return an iterator to the entry or `end()`
+     */
+    template <typename Q> iterator find(const Q &key) {
+        return {this, findIndex(key)};
+    }
+
+    /**
+     * Finds the entry with the given key.
+     *
+     * @param key the key to look up
+     *
+     * @return an iterator to the entry or `end()`
+     */
+    template <typename Q> const_iterator find(const Q &key) const {
+        return {this, findIndex(key)};
+    }
+
+    /**
+     * Checks whether an entry with the given key exists.
+     *
+     * @param key the key to look up
+     *
+     * @return `true` if and only if the key is present
+     */
+    template <typename Q> [[nodiscard]] bool contains(const Q &key) const {
+        return findIndex(key) != m_capacity;
+    }
+
+    /**
+     * Counts entries with the given key.
+     *
+     * @param key the key to look up
+     *
+     * @return 1 if the key is present, 0 otherwise
+     */
+    template <typename Q> [[nodiscard]] size_type count(const Q &key) const {
+        return contains(key) ? 1 : 0;
+    }
+
+    /**
+     * Returns the value mapped to the given key.
+     *
+     * @exception std::out_of_range if the key is not present
+     *
+     * @param key the key to look up
+     *
+     * @return a reference to the mapped value
+     */
+    template <typename Q> V &at(const Q &key) {
+        size_type index = findIndex(key);
+        if (index == m_capacity) {
+            throw std::out_of_range("key not found");
+        }
+        return m_slots[index].second;
+    }
+
+    /**
+     * Returns the value mapped to the given key.
+     *
+     * @exception std::out_of_range if the key is not present
+     *
+     * @param key the key to look up
+     *
+     * @return a reference to the mapped value
+     */
+    template <typename Q> const V &at(const Q &key) const {
+        size_type index = findIndex(key);
+        if (index == m_capacity) {
+            throw std::out_of_range("key not found");
+        }
+        return m_slots[index].second;
+    }
+
+    /**
+     * Inserts an entry with the given key and a value constructed from
+     * `args` unless the key is already present.
+     *
+     * @param key the key of the entry
+     * @param args arguments for the constructor of the value
+     *
+     * @return an iterator to the entry with the key and `true` if the entry
+     * was inserted
+     */
+    template <typename Q, typename... Args>
+    std::pair<iterator, bool> try_emplace(Q &&key, Args &&...args) {
+        size_type index = findIndex(key);
+        if (index != m_capacity) {
+            return {{this, index}, false};
+        }
+
+        reserveOne();
+
+        size_type hash = m_hash(key);
+        index = findFree(hash);
+        std::construct_at(&m_slots[index], std::piecewise_construct,
+                          std::forward_as_tuple(K(std::forward<Q>(key))),
+                          std::forward_as_tuple(std::forward<Args>(args)...));
+
+        if (m_ctrl[index] == EMPTY) {
+            m_growthLeft--;
+        }
+        setCtrl(index, h2(hash));
+        m_size++;
+
+        return {{this, index}, true};
+    }
+
+    /**
+     * Inserts an entry with the given key and value unless the key is already
+     * present.
+     *
+     * @param key the key of the entry
+     * @param value the value of the entry
+     *
+     * @return an iterator to the entry with the key and `true` if the entry
+     * was inserted
+     */
+    template <typename Q, typename M>
+    std::pair<iterator, bool> emplace(Q &&key, M &&value) {
+        return try_emplace(std::forward<Q>(key), std::forward<M>(value));
+    }
+
+    /**
+     * Inserts a copy of the given entry unless its key is already present.
+     *
+     * @param entry the entry to insert
+     *
+     * @return an iterator to the entry with the key and `true` if the entry
+     * was inserted
+     */
+    std::pair<iterator, bool> insert(const value_type &entry) {
+        return try_emplace(entry.first, entry.second);
+    }
+
+    /**
+     * Returns the value mapped to the given key, inserting a
+     * value-initialized value if the key is not present.
+     *
+     * @param key the key to look up
+     *
+     * @return a reference to the mapped value
+     */
+    template <typename Q> V &operator[](Q &&key) {
+        return try_emplace(std::forward<Q>(key)).first->second;
+    }
+
+    /**
+     * Removes the entry at the given position.
+     *
+     * @param pos a valid dereferenceable iterator
+     *
+     * @return an iterator to the entry that followed the removed entry
+     */
+    iterator erase(const_iterator pos) {
+        size_type index = pos.m_index;
+        std::destroy_at(&m_slots[index]);
+        setCtrl(index, DELETED);
+        m_size--;
+
+        iterator next(this, index);
+        next.settle();
+        return next;
+    }
+
+    /**
+     * Removes the entry at the given position.
+     *
+     * @param pos a valid dereferenceable iterator
+     *
+     * @return an iterator to the entry that followed the removed entry
+     */
+    iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+    /**
+     * Removes the entry with the given key, if any.
+     *
+     * @param key the key of the entry to remove
+     *
+     * @return the number of removed entries
+     */
+    template <typename Q> size_type erase(const Q &key) {
+        size_type index = findIndex(key);
+        if (index == m_capacity) {
+            return 0;
+        }
+        erase(const_iterator(this, index));
+        return 1;
+    }
+
+    /**
+     * Compares two maps for equal contents.
+     */
+    friend bool operator==(const FlatMap &a, const FlatMap &b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (const auto &[key, value] : a) {
+            auto it = b.find(key);
+            if (it == b.end() || !(it->second == value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace piwcs::prw::detail
+
+#endif // PIWCS_PRW_MODEL_FLATMAP
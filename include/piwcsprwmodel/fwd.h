@@ -14,6 +14,14 @@ class Node;
 class Destination;
 class Section;
 class Model;
+class ModelBuilder;
+class CompiledModel;
+class ModelSnapshot;
+class ModelStore;
+
+namespace detail {
+class ModelShard;
+} // namespace detail
 
 } // namespace piwcs::prw
 
@@ -0,0 +1,189 @@
+#ifndef PIWCS_PRW_MODEL_HANDLE
+#define PIWCS_PRW_MODEL_HANDLE
+
+#include "fwd.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @file
+ *
+ * This header declares NodeHandle and SectionHandle, compact references to
+ * Model entities that resolve without hashing.
+ */
+
+namespace piwcs::prw {
+
+namespace detail {
+template <typename T> class HandleTable;
+} // namespace detail
+
+/**
+ * A compact reference to an entity of a Model.
+ *
+ * A handle consists of an index into a table of the Model and a generation
+ * counter. Resolving a handle is a single array access, which makes handles
+ * suitable for caching in hot loops instead of IDs.
+ *
+ * When an entity is removed, its table entry moves to a new generation, so
+ * handles to removed entities are detected and resolve to `nullptr` even if
+ * the entry is reused by a new entity.
+ *
+ * A default-constructed handle never resolves. Handles are only meaningful
+ * for the Model that issued them.
+ *
+ * @tparam T Node or Section
+ */
+template <typename T> class Handle {
+
+    std::uint32_t m_index = 0;
+    std::uint32_t m_generation = 0;
+
+    Handle(std::uint32_t index, std::uint32_t generation)
+        : m_index(index), m_generation(generation) {}
+
+    friend class detail::HandleTable<T>;
+
+  public:
+    /**
+     * Constructs a handle that does not refer to any entity.
+     */
+    Handle() = default;
+
+    /**
+     * Checks whether this handle was issued for an entity. The entity may
+     * since have been removed.
+     *
+     * @return `false` if and only if this handle is default-constructed
+     */
+    explicit operator bool() const { return m_generation != 0; }
+
+    /**
+     * Compares two handles.
+     */
+    bool operator==(const Handle &) const = default;
+};
+
+/**
+ * A compact reference to a Node of a Model.
+ */
+using NodeHandle = Handle<Node>;
+
+/**
+ * A compact reference to a Section of a Model.
+ */
+using SectionHandle = Handle<Section>;
+
+namespace detail {
+
+/**
+ * Maps Handle indices to the current locations of entities.
+ *
+ * Generations start at 1 so that default-constructed Handles never match.
+ */
+template <typename T> class HandleTable {
+
+    struct Entry {
+        T *object = nullptr;
+        std::uint32_t generation = 1;
+    };
+
+    std::vector<Entry> m_entries;
+    std::vector<std::uint32_t> m_free;
+
+  public:
+    /**
+     * Index stored by entities that have no table entry.
+     */
+    static constexpr std::uint32_t NONE = ~std::uint32_t{0};
+
+    /**
+     * Reserves memory for `count` entries.
+     *
+     * @param count the expected number of entries
+     */
+    void reserve(std::size_t count) { m_entries.reserve(count); }
+
+    /**
+     * Reserves an entry, reusing a released entry if possible.
+     *
+     * @return the index of the entry
+     */
+    std::uint32_t acquire() {
+        if (!m_free.empty()) {
+            std::uint32_t index = m_free.back();
+            m_free.pop_back();
+            return index;
+        }
+        m_entries.emplace_back();
+        return static_cast<std::uint32_t>(m_entries.size() - 1);
+    }
+
+    /**
+     * Releases an entry and invalidates all Handles to it.
+     *
+     * @param index the index of the entry
+     */
+    void release(std::uint32_t index) {
+        Entry &entry = m_entries[index];
+        entry.object = nullptr;
+        if (++entry.generation == 0) {
+            entry.generation = 1;
+        }
+        m_free.push_back(index);
+    }
+
+    /**
+     * Records the current location of an entity.
+     *
+     * @param index the index of the entry of the entity
+     * @param object the entity
+     */
+    void update(std::uint32_t index, T *object) {
+        m_entries[index].object = object;
+    }
+
+    /**
+     * Returns a Handle to the entry.
+     *
+     * @param index the index of the entry
+     *
+     * @return a Handle to the current entity of the entry
+     */
+    [[nodiscard]] Handle<T> handle(std::uint32_t index) const {
+        return {index, m_entries[index].generation};
+    }
+
+    /**
+     * Resolves a Handle.
+     *
+     * @param handle the Handle to resolve
+     *
+     * @return the entity, or `nullptr` if the Handle is stale or invalid
+     */
+    [[nodiscard]] T *get(Handle<T> handle) const {
+        if (handle.m_index >= m_entries.size()) {
+            return nullptr;
+        }
+        const Entry &entry = m_entries[handle.m_index];
+        return entry.generation == handle.m_generation ? entry.object
+                                                       : nullptr;
+    }
+
+    /**
+     * Returns the heap memory used by this table, in bytes.
+     *
+     * @return the size of the memory owned by this table
+     */
+    [[nodiscard]] std::size_t memoryUsage() const {
+        return m_entries.capacity() * sizeof(Entry) +
+               m_free.capacity() * sizeof(std::uint32_t);
+    }
+};
+
+} // namespace detail
+
+} // namespace piwcs::prw
+
+#endif // PIWCS_PRW_MODEL_HANDLE
@@ -1,6 +1,7 @@
 #ifndef PIWCS_PRW_MODEL_IDMAP
 #define PIWCS_PRW_MODEL_IDMAP
 
+#include "flatmap.h"
 #include "fwd.h"
 #include "util.h"
 #include <unordered_map>
@@ -8,17 +9,28 @@
 /**
  * @file
  *
- * This header declares IdMap, a type alias for `std::unordered_map` that uses
- * Identifier as keys and allows lookup with IdRef.
+ * This header declares IdMap and StableIdMap, hash maps that use Identifier as
+ * keys and allow lookup with IdRef.
  */
 
 namespace piwcs::prw {
 
 /**
- * An unordered map with Identifiers as keys.
+ * A hash map with Identifiers as keys.
+ *
+ * This is an open-addressing map that stores entries inline; see
+ * detail::FlatMap. References and iterators to entries are invalidated by
+ * insertions. Use StableIdMap when references must survive insertions.
+ */
+template <typename V>
+using IdMap = detail::FlatMap<Identifier, V, IdHash, std::equal_to<>>;
+
+/**
+ * An unordered map with Identifiers as keys that never invalidates references
+ * to entries on insertion.
  */
 template <typename V>
-using IdMap = std::unordered_map<Identifier, V, IdHash, std::equal_to<>>;
+using StableIdMap = std::unordered_map<Identifier, V, IdHash, std::equal_to<>>;
 
 } // namespace piwcs::prw
 
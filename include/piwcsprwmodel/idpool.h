@@ -0,0 +1,138 @@
+#ifndef PIWCS_PRW_MODEL_IDPOOL
+#define PIWCS_PRW_MODEL_IDPOOL
+
+#include "flatmap.h"
+#include "fwd.h"
+#include "util.h"
+#include <cstdint>
+#include <deque>
+
+/**
+ * @file
+ *
+ * This header declares internals for identifier interning.
+ */
+
+namespace piwcs::prw::detail {
+
+/**
+ * A pool of interned Identifiers.
+ *
+ * Each distinct Identifier added to the pool is stored once and assigned a
+ * compact Handle. Handles can be compared instead of Identifiers and resolved
+ * back to Identifiers in constant time.
+ *
+ * Identifiers are stored as InlineIds when they fit, and as heap strings
+ * otherwise.
+ *
+ * Identifiers are never removed from the pool, so Handles and the IdRefs they
+ * resolve to remain valid for the lifetime of the pool.
+ */
+class IdPool {
+
+  public:
+    /**
+     * Type of Identifier handles.
+     */
+    using Handle = std::uint32_t;
+
+    /**
+     * The Handle that resolves to `ID_NULL`.
+     */
+    static constexpr Handle NULL_HANDLE = 0;
+
+  private:
+    /**
+     * Handles of Identifiers that do not fit into InlineId have this bit set.
+     */
+    static constexpr Handle LONG_FLAG = Handle{1} << 31;
+
+    std::deque<InlineId> m_short;
+    std::deque<Identifier> m_long;
+    FlatMap<IdRef, Handle, IdHash, std::equal_to<>> m_index;
+
+  public:
+    /**
+     * Returns the Handle of the given Identifier, adding the Identifier to the
+     * pool if necessary.
+     *
+     * @param id the Identifier to intern; `ID_NULL` yields `NULL_HANDLE`
+     *
+     * @return the Handle of `id`
+     */
+    Handle intern(IdRef id);
+
+    /**
+     * Returns the Handle of the given Identifier if it is in the pool.
+     *
+     * @param id the Identifier to look up
+     *
+     * @return the Handle of `id` or `NULL_HANDLE` if `id` is not in the pool
+     */
+    [[nodiscard]] Handle find(IdRef id) const;
+
+    /**
+     * Resolves a Handle to its Identifier.
+     *
+     * @param handle a Handle returned by this pool or `NULL_HANDLE`
+     *
+     * @return the Identifier of `handle`
+     */
+    [[nodiscard]] IdRef get(Handle handle) const {
+        if (handle == NULL_HANDLE) {
+            return ID_NULL;
+        } else if ((handle & LONG_FLAG) != 0) {
+            return m_long[(handle & ~LONG_FLAG) - 1];
+        } else {
+            return m_short[handle - 1].view();
+        }
+    }
+
+    /**
+     * Checks whether a Handle resolves to the given Identifier.
+     *
+     * `NULL_HANDLE` matches an InlineId equal to `ID_NULL`. Handles of
+     * Identifiers that do not fit into InlineId match nothing.
+     *
+     * @param handle a Handle returned by this pool or `NULL_HANDLE`
+     * @param id the Identifier to compare with
+     *
+     * @return `true` if and only if `get(handle) == id.view()`
+     */
+    [[nodiscard]] bool matches(Handle handle, const InlineId &id) const {
+        if (handle == NULL_HANDLE) {
+            return id == InlineId();
+        } else if ((handle & LONG_FLAG) != 0) {
+            return false;
+        } else {
+            return m_short[handle - 1] == id;
+        }
+    }
+
+    /**
+     * Returns the number of Identifiers in the pool.
+     *
+     * @return the number of interned Identifiers
+     */
+    [[nodiscard]] std::size_t size() const {
+        return m_short.size() + m_long.size();
+    }
+
+    /**
+     * Reserves space in the index for `count` Identifiers.
+     *
+     * @param count the expected number of Identifiers
+     */
+    void reserve(std::size_t count) { m_index.reserve(count); }
+
+    /**
+     * Estimates the heap memory used by this pool, in bytes.
+     *
+     * @return the approximate size of the memory owned by this pool
+     */
+    [[nodiscard]] std::size_t memoryUsage() const;
+};
+
+} // namespace piwcs::prw::detail
+
+#endif // PIWCS_PRW_MODEL_IDPOOL
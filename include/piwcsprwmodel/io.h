@@ -3,9 +3,11 @@
 
 #include "fwd.h"
 #include "model.h"
+#include <cstddef>
 #include <iosfwd>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 
 /**
  * @file
@@ -59,6 +61,217 @@ class InvalidFormatError : public std::runtime_error {
     InvalidFormatError(const char *what_arg) : std::runtime_error(what_arg) {}
 };
 
+/**
+ * Receives the records of a PRW model definition as they are parsed by
+ * `visitModel`.
+ *
+ * Records are delivered in file order: all nodes first, then all sections.
+ * For each section, the destination record (if any) is delivered first, then
+ * the section record, then the link record (if any).
+ *
+ * Views and pointers in records are only valid for the duration of the
+ * callback. Visitors may move from the metadata they receive.
+ *
+ * The default implementations of all callbacks do nothing. Callbacks may
+ * throw exceptions to abort parsing; the exceptions are propagated to the
+ * caller of `visitModel`.
+ */
+class ModelVisitor {
+  public:
+    /**
+     * A node definition.
+     */
+    struct NodeRecord {
+        /**
+         * The ID of the node.
+         */
+        IdRef id;
+
+        /**
+         * The type of the node.
+         */
+        NodeType type;
+
+        /**
+         * The metadata of the node or `nullptr` if none was given.
+         */
+        Metadata *metadata;
+    };
+
+    /**
+     * A destination definition.
+     */
+    struct DestinationRecord {
+        /**
+         * The ID of the section that is the destination.
+         */
+        IdRef section;
+
+        /**
+         * The address of the destination.
+         */
+        std::string_view address;
+
+        /**
+         * The name of the destination.
+         */
+        std::string_view name;
+
+        /**
+         * The metadata of the destination or `nullptr` if none was given.
+         */
+        Metadata *metadata;
+    };
+
+    /**
+     * A section definition.
+     */
+    struct SectionRecord {
+        /**
+         * The ID of the section.
+         */
+        IdRef id;
+
+        /**
+         * The allowed travel directions of the section.
+         */
+        Section::AllowedTravel dir;
+
+        /**
+         * Whether a destination record was delivered for this section.
+         */
+        bool isDestination;
+
+        /**
+         * The metadata of the section or `nullptr` if none was given.
+         */
+        Metadata *metadata;
+
+        /**
+         * The length of the section as given, without validation.
+         */
+        float length = Section::DEFAULT_LENGTH;
+
+        /**
+         * The cost multiplier of the section as given, without validation.
+         */
+        float costMultiplier = Section::DEFAULT_COST_MULTIPLIER;
+    };
+
+    /**
+     * A link between a section and two nodes.
+     */
+    struct LinkRecord {
+        /**
+         * The ID of the linked section.
+         */
+        IdRef section;
+
+        /**
+         * The ID of the node at the start of the section.
+         */
+        IdRef startNode;
+
+        /**
+         * The slot of the start node that the section occupies.
+         */
+        SlotId startSlot;
+
+        /**
+         * The ID of the node at the end of the section.
+         */
+        IdRef endNode;
+
+        /**
+         * The slot of the end node that the section occupies.
+         */
+        SlotId endSlot;
+    };
+
+    ModelVisitor() = default;
+    ModelVisitor(const ModelVisitor &) = default;
+    ModelVisitor(ModelVisitor &&) = default;
+    ModelVisitor &operator=(const ModelVisitor &) = default;
+    ModelVisitor &operator=(ModelVisitor &&) = default;
+    virtual ~ModelVisitor() = default;
+
+    /**
+     * Called for each node.
+     *
+     * @param record the node definition
+     */
+    virtual void node(const NodeRecord & /*record*/) {}
+
+    /**
+     * Called for each destination, before the record of its section.
+     *
+     * @param record the destination definition
+     */
+    virtual void destination(const DestinationRecord & /*record*/) {}
+
+    /**
+     * Called for each section.
+     *
+     * @param record the section definition
+     */
+    virtual void section(const SectionRecord & /*record*/) {}
+
+    /**
+     * Called for each linked section, after the record of the section.
+     *
+     * @param record the link definition
+     */
+    virtual void link(const LinkRecord & /*record*/) {}
+};
+
+/**
+ * Parses a PRW model definition from the provided `istream` and reports its
+ * contents to `visitor` without constructing a Model.
+ *
+ * Memory use does not depend on the size of the input, only on the length of
+ * the longest string in it. No consistency checks beyond those needed to
+ * parse the input are made: for example, duplicate IDs and links to unknown
+ * nodes are reported as is.
+ *
+ * @exception std::ios_base::failure if an IO error occurs
+ * @exception InvalidFormatError if input could not be parsed
+ *
+ * @param in an input stream open in text mode to read the definition from
+ * @param visitor the visitor to report records to
+ */
+void visitModel(std::istream &in, ModelVisitor &visitor);
+
+/**
+ * Parses a PRW model definition from the file `filename` and reports its
+ * contents to `visitor` without constructing a Model.
+ *
+ * The file is read as a stream; see visitModel(std::istream &, ModelVisitor &)
+ * for details.
+ *
+ * @exception std::ios_base::failure if an IO error occurs
+ * @exception InvalidFormatError if input could not be parsed
+ *
+ * @param filename the relative path of the file to read
+ * @param visitor the visitor to report records to
+ */
+void visitModel(const std::string &filename, ModelVisitor &visitor);
+
+/**
+ * Parses a PRW model definition from the provided memory buffer and reports
+ * its contents to `visitor` without constructing a Model.
+ *
+ * Unlike visitModel(std::istream &, ModelVisitor &), this function allocates
+ * a scratch buffer as large as `buffer` to unescape strings into, so its
+ * memory use is proportional to the size of the input. See
+ * visitModel(std::istream &, ModelVisitor &) for other details.
+ *
+ * @exception InvalidFormatError if input could not be parsed
+ *
+ * @param buffer the definition to read
+ * @param visitor the visitor to report records to
+ */
+void visitModelBuffer(std::string_view buffer, ModelVisitor &visitor);
+
 /**
  * Reads a PRW model definition from the provided `istream`, constructs a new
  * Model object and returns it.
@@ -93,6 +306,101 @@ Model readModel(std::istream &in);
  */
 Model readModel(const std::string &filename);
 
+/**
+ * Reads a PRW model definition from the provided memory buffer, constructs a
+ * new Model object and returns it.
+ *
+ * This is considerably faster than reading from an `istream`. Keys and values
+ * are decoded directly from the buffer; apart from one scratch buffer of the
+ * same size as the input, memory is only allocated for data stored in the
+ * Model.
+ *
+ * Note that this function does not guarantee that the resulting Model is
+ * complete, only that it is consistent.
+ *
+ * @exception InvalidFormatError if input could not be parsed
+ * @exception IllegalModelError if the data describes an inconsistent Model
+ *
+ * @param buffer the definition to read
+ *
+ * @return the Model desribed by the data in `buffer`
+ */
+Model readModelBuffer(std::string_view buffer);
+
+/**
+ * Reads a PRW model definition from the provided memory buffer using multiple
+ * threads, constructs a new Model object and returns it.
+ *
+ * Nodes and sections are parsed concurrently, then added to the Model in
+ * order on the calling thread. The result and any errors are the same as for
+ * readModelBuffer. Parsing is only worthwhile for large inputs; definitions
+ * that use escape sequences in IDs are parsed sequentially.
+ *
+ * Note that this function does not guarantee that the resulting Model is
+ * complete, only that it is consistent.
+ *
+ * @exception InvalidFormatError if input could not be parsed
+ * @exception IllegalModelError if the data describes an inconsistent Model
+ *
+ * @param buffer the definition to read
+ * @param threads the number of threads to use, or 0 to use one thread per
+ * hardware thread
+ *
+ * @return the Model desribed by the data in `buffer`
+ */
+Model readModelParallel(std::string_view buffer, unsigned threads = 0);
+
+/**
+ * Reads a PRW model definition from the file `filename` by mapping it into
+ * memory, constructs a new Model object and returns it.
+ *
+ * This is considerably faster than readModel(const std::string &). The file is
+ * parsed in place through a private copy-on-write mapping and is never
+ * modified. Memory is only allocated for data stored in the Model.
+ *
+ * Note that this function does not guarantee that the resulting Model is
+ * complete, only that it is consistent.
+ *
+ * @exception std::ios_base::failure if an IO error occurs
+ * @exception InvalidFormatError if input could not be parsed
+ * @exception IllegalModelError if the data describes an inconsistent Model
+ *
+ * @param filename the relative path of the file to read
+ *
+ * @return the Model desribed by the data in the file
+ */
+Model readModelMapped(const std::string &filename);
+
+/**
+ * Options that control how `writeModel` formats output.
+ */
+struct WriterOptions {
+    /**
+     * Whether output is indented for human readers.
+     *
+     * Compact output contains no insignificant whitespace and is produced by a
+     * considerably faster writer.
+     */
+    bool pretty = true;
+
+    /**
+     * The amount of compact output in bytes that is collected before it is
+     * written to the destination.
+     */
+    std::size_t bufferSize = std::size_t{1} << 20;
+
+    /**
+     * The number of threads that produce compact output, or 0 to use one
+     * thread per hardware thread.
+     *
+     * With more than one thread, nodes and sections are serialized in chunks
+     * concurrently and the complete output is held in memory before it is
+     * written. The output is identical to that of a single thread. Pretty
+     * output is always produced on the calling thread.
+     */
+    unsigned threads = 1;
+};
+
 /**
  * Writes the PRW model definition of the provided Model into the output stream.
  *
@@ -100,8 +408,10 @@ Model readModel(const std::string &filename);
  *
  * @param out an output stream open in text mode to write the definition to
  * @param model the Model to serialize
+ * @param options output format options
  */
-void writeModel(std::ostream &out, const Model &model);
+void writeModel(std::ostream &out, const Model &model,
+                const WriterOptions &options = {});
 
 /**
  * Writes the PRW model definition of the provided Model into file `filename`.
@@ -112,8 +422,107 @@ void writeModel(std::ostream &out, const Model &model);
  *
  * @param filename the relative path of the file to write into
  * @param model the Model to serialize
+ * @param options output format options
+ */
+void writeModel(const std::string &filename, const Model &model,
+                const WriterOptions &options = {});
+
+/**
+ * Writes the PRW model definition of the provided Model into the file
+ * descriptor `fd`, bypassing `iostream`.
+ *
+ * The descriptor is neither closed nor synchronized.
+ *
+ * @exception std::ios_base::failure if an IO error occurs, or if the platform
+ * does not provide POSIX file descriptors
+ *
+ * @param fd an open file descriptor to write the definition to
+ * @param model the Model to serialize
+ * @param options output format options
+ */
+void writeModelFd(int fd, const Model &model,
+                  const WriterOptions &options = {});
+
+/**
+ * Appends the PRW model definition of the provided Model to `buffer`.
+ *
+ * `options.bufferSize` is ignored.
+ *
+ * @param buffer the string to append the definition to
+ * @param model the Model to serialize
+ * @param options output format options
+ */
+void writeModelBuffer(std::string &buffer, const Model &model,
+                      const WriterOptions &options = {});
+
+/**
+ * Reads a binary PRW model snapshot from the provided `istream`, constructs a
+ * new Model object and returns it.
+ *
+ * Snapshots are produced by `writeModelBinary`. They are only readable on
+ * machines with the same byte order and by the same snapshot format version.
+ *
+ * @exception std::ios_base::failure if an IO error occurs
+ * @exception InvalidFormatError if input is not a valid snapshot
+ * @exception IllegalModelError if the data describes an inconsistent Model
+ *
+ * @param in an input stream open in binary mode to read the snapshot from
+ *
+ * @return the Model described by the snapshot
+ */
+Model readModelBinary(std::istream &in);
+
+/**
+ * Reads a binary PRW model snapshot from the file `filename`, constructs a new
+ * Model object and returns it.
+ *
+ * The file is memory-mapped where supported, so no copy of its contents is
+ * made. The Model itself does not refer to the mapping: see
+ * `writeModelBinary`.
+ *
+ * @exception std::ios_base::failure if an IO error occurs
+ * @exception InvalidFormatError if input is not a valid snapshot
+ * @exception IllegalModelError if the data describes an inconsistent Model
+ *
+ * @param filename the relative path of the file to read
+ *
+ * @return the Model described by the snapshot
+ */
+Model readModelBinary(const std::string &filename);
+
+/**
+ * Writes a binary snapshot of the provided Model into the output stream.
+ *
+ * Snapshots are versioned and checksummed, and consist of a string table and
+ * fixed-width records for nodes, sections and metadata. They load faster than
+ * the JSON definition written by `writeModel`, but are not meant for
+ * interchange between machines.
+ *
+ * A snapshot is a fast serialization rather than an in-place view: readers
+ * decode records without parsing text, but still copy every ID and metadata
+ * string into a newly built Model. Most of the load time is spent building
+ * the Model's tables, as with `ModelBuilder`.
+ *
+ * @exception std::ios_base::failure if an IO error occurs
+ * @exception std::length_error if the Model is too large for the format
+ *
+ * @param out an output stream open in binary mode to write the snapshot to
+ * @param model the Model to serialize
+ */
+void writeModelBinary(std::ostream &out, const Model &model);
+
+/**
+ * Writes a binary snapshot of the provided Model into file `filename`.
+ *
+ * Existing files will be overwritten silently.
+ *
+ * @exception std::ios_base::failure if an IO error occurs
+ * @exception std::length_error if the Model is too large for the format
+ *
+ * @param filename the relative path of the file to write into
+ * @param model the Model to serialize
  */
-void writeModel(const std::string &filename, const Model &model);
+void writeModelBinary(const std::string &filename, const Model &model);
 
 } // namespace piwcs::prw
 
@@ -0,0 +1,282 @@
+#ifndef PIWCS_PRW_MODEL_JOURNAL
+#define PIWCS_PRW_MODEL_JOURNAL
+
+#include "fwd.h"
+#include "io.h"
+#include "model.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+/**
+ * @file
+ *
+ * This header declares the edit journal of piwcsprwmodel.
+ */
+
+namespace piwcs::prw {
+
+/**
+ * An append-only log of Model edits.
+ *
+ * A journal makes persisting small edits cheap: instead of rewriting the
+ * entire model, each edit appends a short binary record. The journal is
+ * replayed on top of the binary snapshot it was started from with
+ * `replayJournal`, and folded back into a new snapshot with `compactJournal`.
+ *
+ * Journal methods only record edits; they neither validate nor apply them.
+ * Record an edit after it has been applied to the Model successfully, so that
+ * the journal replays without errors.
+ *
+ * Records are buffered by the underlying stream. Call `flush` to hand them to
+ * the operating system.
+ *
+ * A typical editor session looks like this:
+ *
+ * ```cpp
+ * Model model = compactJournal("model.prwbin", "model.prwjnl");
+ * Journal journal("model.prwjnl");
+ *
+ * if (model.link("s1", "n1", 0, "n2", 1) == Model::LinkResult::OK) {
+ *     journal.link("s1", "n1", 0, "n2", 1);
+ *     journal.flush();
+ * }
+ * ```
+ */
+class Journal {
+
+  public:
+    /**
+     * Objects whose metadata may be edited.
+     *
+     * Destination metadata is recorded as part of `addSection`.
+     */
+    enum class Target {
+        /**
+         * A Node.
+         */
+        NODE,
+
+        /**
+         * A Section.
+         */
+        SECTION
+    };
+
+  private:
+    std::ofstream m_file;
+    std::ostream *m_out;
+    std::string m_record;
+
+    void begin(std::uint8_t op);
+    void put(std::uint8_t value);
+    void put(std::string_view str);
+    void put(float value);
+    void putMetadata(const detail::HasMetadata &obj);
+    void commit();
+
+  public:
+    /**
+     * Opens the existing journal file `filename` for appending.
+     *
+     * Journal files are created by `compactJournal`, which binds them to a
+     * snapshot.
+     *
+     * If the last record of the journal was only partially written, for
+     * example due to a crash, it is discarded.
+     *
+     * @exception std::ios_base::failure if an IO error occurs or the file does
+     * not exist
+     * @exception InvalidFormatError if the file is not a journal
+     *
+     * @param filename the path of the journal file
+     */
+    explicit Journal(const std::string &filename);
+
+    /**
+     * Starts a new journal in the output stream.
+     *
+     * The journal is not bound to a snapshot. It can be replayed with
+     * `replayJournal`, but `compactJournal` rejects it.
+     *
+     * @exception std::ios_base::failure if an IO error occurs
+     *
+     * @param out an output stream open in binary mode to write the journal to
+     */
+    explicit Journal(std::ostream &out);
+
+    Journal(const Journal &) = delete;
+    Journal &operator=(const Journal &) = delete;
+
+    /**
+     * Records the addition of a Node, including its metadata.
+     *
+     * @exception std::ios_base::failure if an IO error occurs
+     *
+     * @param node the Node that was added
+     */
+    void addNode(const Node &node);
+
+    /**
+     * Records the addition of a Section, including its metadata and
+     * Destination. Links are recorded separately with `link`.
+     *
+     * @exception std::ios_base::failure if an IO error occurs
+     *
+     * @param section the Section that was added
+     */
+    void addSection(const Section &section);
+
+    /**
+     * Records the removal of a Node.
+     *
+     * @exception std::ios_base::failure if an IO error occurs
+     *
+     * @param id the ID of the removed Node
+     */
+    void removeNode(IdRef id);
+
+    /**
+     * Records the removal of a Section.
+     *
+     * @exception std::ios_base::failure if an IO error occurs
+     *
+     * @param id the ID of the removed Section
+     */
+    void removeSection(IdRef id);
+
+    /**
+     * Records the linkage of two Nodes using a Section.
+     *
+     * @exception std::ios_base::failure if an IO error occurs
+     *
+     * @param sectionId ID of the section
+     * @param startNodeId ID of the Node at the start of the section
+     * @param startSlotId SlotId of the start Node
+     * @param endNodeId ID of the Node at the end of the section
+     * @param endSlotId SlotId of the end Node
+     */
+    void link(IdRef sectionId, IdRef startNodeId, SlotId startSlotId,
+              IdRef endNodeId, SlotId endSlotId);
+
+    /**
+     * Records the removal of the link of a Section.
+     *
+     * @exception std::ios_base::failure if an IO error occurs
+     *
+     * @param sectionId ID of the unlinked section
+     */
+    void unlink(IdRef sectionId);
+
+    /**
+     * Records that a metadata record was created or changed.
+     *
+     * @exception std::ios_base::failure if an IO error occurs
+     *
+     * @param target the kind of object that was changed
+     * @param id the ID of the object that was changed
+     * @param key the metadata key
+     * @param value the new metadata value
+     */
+    void setMetadata(Target target, IdRef id, IdRef key,
+                     std::string_view value);
+
+    /**
+     * Records that a metadata record was erased.
+     *
+     * @exception std::ios_base::failure if an IO error occurs
+     *
+     * @param target the kind of object that was changed
+     * @param id the ID of the object that was changed
+     * @param key the erased metadata key
+     */
+    void eraseMetadata(Target target, IdRef id, IdRef key);
+
+    /**
+     * Records that the length or cost multiplier of a Section changed.
+     *
+     * @exception std::ios_base::failure if an IO error occurs
+     *
+     * @param sectionId the ID of the changed Section
+     * @param length the new length
+     * @param costMultiplier the new cost multiplier
+     */
+    void setAttributes(IdRef sectionId, float length, float costMultiplier);
+
+    /**
+     * Passes all buffered records to the operating system.
+     *
+     * @exception std::ios_base::failure if an IO error occurs
+     */
+    void flush();
+};
+
+/**
+ * Applies all edits recorded in a journal to `model`.
+ *
+ * A trailing record that was only partially written is ignored. The journal is
+ * applied regardless of the snapshot it was started from.
+ *
+ * @exception std::ios_base::failure if an IO error occurs
+ * @exception InvalidFormatError if the journal is corrupted
+ * @exception IllegalModelError if an edit cannot be applied to `model`
+ *
+ * @param model the Model to edit
+ * @param in an input stream open in binary mode to read the journal from
+ *
+ * @return the number of edits applied
+ */
+std::size_t replayJournal(Model &model, std::istream &in);
+
+/**
+ * Applies all edits recorded in journal file `filename` to `model`.
+ *
+ * A trailing record that was only partially written is ignored. The journal is
+ * applied regardless of the snapshot it was started from.
+ *
+ * @exception std::ios_base::failure if an IO error occurs
+ * @exception InvalidFormatError if the journal is corrupted
+ * @exception IllegalModelError if an edit cannot be applied to `model`
+ *
+ * @param model the Model to edit
+ * @param filename the path of the journal file
+ *
+ * @return the number of edits applied
+ */
+std::size_t replayJournal(Model &model, const std::string &filename);
+
+/**
+ * Folds a journal into the binary snapshot it applies to.
+ *
+ * The snapshot in `snapshotFile` is loaded and the journal in `journalFile`,
+ * if it exists, is replayed on top of it. The result replaces the snapshot,
+ * and the journal is replaced by an empty journal bound to the new snapshot.
+ * Both files are replaced atomically where the file system allows it.
+ *
+ * If `journalFile` does not exist, a new journal bound to the snapshot is
+ * created. This is the only way to create a journal file.
+ *
+ * A journal remembers the snapshot it was started from. If compaction is
+ * interrupted after the new snapshot was written, the old journal is
+ * recognized as already folded in and is not replayed again. Journals that
+ * are not bound to a snapshot are rejected for the same reason.
+ *
+ * @exception std::ios_base::failure if an IO error occurs
+ * @exception InvalidFormatError if the snapshot or the journal are corrupted,
+ * or the journal is not bound to a snapshot
+ * @exception IllegalModelError if the journal cannot be applied
+ *
+ * @param snapshotFile the path of the binary snapshot
+ * @param journalFile the path of the journal file
+ *
+ * @return the compacted Model
+ */
+Model compactJournal(const std::string &snapshotFile,
+                     const std::string &journalFile);
+
+} // namespace piwcs::prw
+
+#endif // PIWCS_PRW_MODEL_JOURNAL
@@ -2,9 +2,17 @@
 #define PIWCS_PRW_MODEL_METADATA
 
 #include "fwd.h"
-#include "idmap.h"
 #include "util.h"
-#include <optional>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 /**
  * @file
@@ -15,21 +23,332 @@
 namespace piwcs::prw {
 
 /**
- * A container of metadata.
+ * A container of metadata: a map from keys to string values.
+ *
+ * Records are stored in a vector sorted by key. Keys are interned in a
+ * process-wide pool that is never cleared, so each record costs one pointer
+ * in addition to its value, and a key shared by many objects is stored once.
+ * The pool is safe to use from multiple threads.
+ *
+ * Lookups use binary search. Insertions and erasures invalidate iterators and
+ * references to values.
+ *
+ * Iterators yield pairs of references to the key and the value, so
+ * `for (auto &[key, value] : metadata)` works as with standard maps. Records
+ * are visited in order of their keys.
  */
-using Metadata = IdMap<std::string>;
+class Metadata {
+
+    struct Record {
+        const Identifier *key;
+        std::string value;
+    };
+
+    std::vector<Record> m_records;
+
+    template <bool Const> class Iterator {
+
+        using Base = std::conditional_t<Const,
+                                        std::vector<Record>::const_iterator,
+                                        std::vector<Record>::iterator>;
+        using Value = std::conditional_t<Const, const std::string, std::string>;
+
+        Base m_it{};
+
+        explicit Iterator(Base it) : m_it(it) {}
+
+        friend class Metadata;
+        friend class Iterator<!Const>;
+
+      public:
+        using value_type = std::pair<Identifier, std::string>;
+        using reference = std::pair<const Identifier &, Value &>;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::bidirectional_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+
+        /**
+         * Holds the record for `operator->`.
+         */
+        struct pointer {
+            reference record;
+            const reference *operator->() const { return &record; }
+        };
+
+        Iterator() = default;
+
+        /**
+         * Converts a mutable iterator to a const one.
+         */
+        operator Iterator<true>() const
+            requires(!Const)
+        {
+            return Iterator<true>(m_it);
+        }
+
+        reference operator*() const { return {*m_it->key, m_it->value}; }
+        pointer operator->() const { return {**this}; }
+
+        Iterator &operator++() {
+            ++m_it;
+            return *this;
+        }
+        Iterator operator++(int) { return Iterator(m_it++); }
+        Iterator &operator--() {
+            --m_it;
+            return *this;
+        }
+        Iterator operator--(int) { return Iterator(m_it--); }
+
+        bool operator==(const Iterator &) const = default;
+    };
+
+    std::vector<Record>::iterator lowerBound(IdRef key);
+    [[nodiscard]] std::vector<Record>::const_iterator
+    lowerBound(IdRef key) const;
+
+  public:
+    using key_type = Identifier;
+    using mapped_type = std::string;
+    using size_type = std::size_t;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    [[nodiscard]] iterator begin() { return iterator(m_records.begin()); }
+    [[nodiscard]] iterator end() { return iterator(m_records.end()); }
+    [[nodiscard]] const_iterator begin() const {
+        return const_iterator(m_records.begin());
+    }
+    [[nodiscard]] const_iterator end() const {
+        return const_iterator(m_records.end());
+    }
+    [[nodiscard]] const_iterator cbegin() const { return begin(); }
+    [[nodiscard]] const_iterator cend() const { return end(); }
+
+    /**
+     * Returns the number of records.
+     *
+     * @return the number of records
+     */
+    [[nodiscard]] size_type size() const { return m_records.size(); }
+
+    /**
+     * Checks whether there are no records.
+     *
+     * @return `true` if and only if `size() == 0`
+     */
+    [[nodiscard]] bool empty() const { return m_records.empty(); }
+
+    /**
+     * Reserves space for `count` records.
+     *
+     * @param count the expected number of records
+     */
+    void reserve(size_type count) { m_records.reserve(count); }
+
+    /**
+     * Erases all records.
+     */
+    void clear() { m_records.clear(); }
+
+    /**
+     * Finds the record with the given key.
+     *
+     * @param key the key to look up
+     *
+     * @return an iterator to the record or `end()` if there is none
+     */
+    [[nodiscard]] iterator find(IdRef key);
+
+    /**
+     * @copydoc find(IdRef)
+     */
+    [[nodiscard]] const_iterator find(IdRef key) const;
+
+    /**
+     * Checks whether a record with the given key exists.
+     *
+     * @param key the key to look up
+     *
+     * @return `true` if and only if a record with this key exists
+     */
+    [[nodiscard]] bool contains(IdRef key) const { return find(key) != end(); }
+
+    /**
+     * Returns the value of the record with the given key, creating a record
+     * with an empty value if necessary.
+     *
+     * @param key the key to look up
+     *
+     * @return a writable reference to the value
+     */
+    std::string &operator[](IdRef key) {
+        return try_emplace(key).first->second;
+    }
+
+    /**
+     * Creates a record with the given key and value unless a record with this
+     * key exists.
+     *
+     * @param key the key of the record
+     * @param value the value of a new record
+     *
+     * @return an iterator to the record with this key and whether it was
+     * created
+     */
+    std::pair<iterator, bool> try_emplace(IdRef key, std::string value = {});
+
+    /**
+     * Erases the record at the given position.
+     *
+     * @param pos an iterator to a record
+     *
+     * @return an iterator to the record that followed the erased one
+     */
+    iterator erase(const_iterator pos);
+
+    /**
+     * Erases the record with the given key, if any.
+     *
+     * @param key the key to erase
+     *
+     * @return the number of erased records
+     */
+    size_type erase(IdRef key);
+
+    /**
+     * Estimates the heap memory used by this container, in bytes. Interned
+     * keys are shared and not included.
+     *
+     * @return the approximate size of the memory owned by this container
+     */
+    [[nodiscard]] std::size_t memoryUsage() const;
+
+    /**
+     * Computes a hash of all records, consistent with `operator==`.
+     *
+     * @return the hash of this container
+     */
+    [[nodiscard]] std::size_t hash() const;
+
+    /**
+     * Checks whether two containers hold the same records.
+     */
+    bool operator==(const Metadata &other) const;
+};
+
+class MetadataTable;
 
 namespace detail {
 
+/**
+ * Metadata that may be shared by several objects.
+ */
+struct SharedMetadata {
+    /**
+     * The number of objects and tables that hold this metadata.
+     */
+    std::atomic<std::uint32_t> refs{1};
+
+    /**
+     * Whether a writable reference to `data` has been handed out. Such
+     * metadata belongs to a single object and is copied rather than shared.
+     */
+    bool exposed = false;
+
+    /**
+     * The records.
+     */
+    Metadata data;
+};
+
+class HasMetadata;
+
+template <typename T> class MetadataIndex;
+
+/**
+ * Receives notifications about metadata that may change.
+ */
+class MetadataObserver {
+
+  protected:
+    ~MetadataObserver() = default;
+
+  public:
+    /**
+     * Called before the metadata of `obj` is replaced and whenever a writable
+     * reference to it is handed out.
+     *
+     * @param obj the object whose metadata may change
+     */
+    virtual void touched(const HasMetadata &obj) = 0;
+};
+
 /**
  * A base class for objects that may have metadata.
+ *
+ * Copies of an object share its metadata until either of them modifies it;
+ * see also MetadataTable. Once a writable reference to the metadata of an
+ * object has been handed out, its metadata is no longer shared: assignments
+ * copy records into the existing storage so that the reference stays valid.
+ *
+ * An object may have a MetadataObserver. The observer is not copied or moved
+ * to other objects.
  */
 class HasMetadata {
 
   private:
-    std::optional<Metadata> m_meta{};
+    // Most objects have no metadata, so it is kept out of line
+    SharedMetadata *m_meta = nullptr;
+
+    MetadataObserver *m_observer = nullptr;
+
+    void release();
+    void assignData(const HasMetadata &source);
+
+    void touch() {
+        if (m_observer != nullptr) {
+            m_observer->touched(*this);
+        }
+    }
+
+    /*
+     * Whether a writable reference may be used to change the metadata of this
+     * object without notifying the observer.
+     */
+    [[nodiscard]] bool exposed() const {
+        return m_meta != nullptr && m_meta->exposed;
+    }
+
+    friend class piwcs::prw::Model;
+    friend class piwcs::prw::MetadataTable;
+    template <typename T> friend class MetadataIndex;
+    friend std::size_t heapBytes(const HasMetadata &obj);
 
   public:
+    HasMetadata() = default;
+    HasMetadata(const HasMetadata &other) { shareMetadata(other); }
+    HasMetadata(HasMetadata &&other) noexcept
+        : m_meta(std::exchange(other.m_meta, nullptr)) {}
+    HasMetadata &operator=(const HasMetadata &other) {
+        shareMetadata(other);
+        return *this;
+    }
+    HasMetadata &operator=(HasMetadata &&other);
+    ~HasMetadata() { release(); }
+
+    /**
+     * Replaces the metadata of this object with the metadata of another
+     * object.
+     *
+     * The records are stored once until either object modifies them, unless
+     * a writable reference to the metadata of either object has been
+     * obtained, in which case they are copied.
+     *
+     * @param source the object to take metadata from
+     */
+    void shareMetadata(const HasMetadata &source);
+
     /**
      * Checks whether there are any metadata records for this object.
      *
@@ -42,11 +361,12 @@ class HasMetadata {
      *
      * The lifetime of this reference matches the lifetime of this object. It
      * can be used to modify metadata, and all changes to metadata will be
-     * visible through it.
+     * visible through it, including replacement by assignment, shareMetadata()
+     * or a MetadataTable.
      *
-     * If this object did not have any existing metadata records, calling this
-     * method will likely result in memory allocation. Use hasMetadata() to
-     * avoid unneeded allocations.
+     * If this object did not have any existing metadata records or shares
+     * them with other objects, calling this method will likely result in
+     * memory allocation. Use hasMetadata() to avoid unneeded allocations.
      *
      * @return a live writable view of the metadata of this object
      */
@@ -55,10 +375,14 @@ class HasMetadata {
     /**
      * Returns the metadata of this object as a map.
      *
-     * The lifetime of this reference is at least the lifetime of this object.
-     * If no metadata records exist for this object, the returned map may not
-     * reflect future changes to metadata; if there is at least one metadata
-     * record, the returned map is guaranteed to reflect future changes.
+     * If a writable reference to the metadata of this object has been
+     * obtained with metadata(), the returned map is that same map: it lives
+     * as long as this object and reflects all future changes.
+     *
+     * Otherwise the records may be shared with other objects (see
+     * MetadataTable), and the returned map is only guaranteed to be valid
+     * until the metadata of this object is next modified or replaced. It may
+     * not reflect such changes.
      *
      * Unlike the non-const counterpart of this method, calls to this method
      * cannot result in memory allocation.
@@ -105,6 +429,69 @@ class HasMetadata {
 
 } // namespace detail
 
+/**
+ * A hash-consing table that stores identical metadata once.
+ *
+ * Objects whose metadata is assigned through the same table share a single
+ * copy of each distinct map. An object that later modifies its metadata
+ * receives a private copy, so sharing is never observable through the
+ * metadata API.
+ *
+ * The table keeps the maps it has seen alive until it is destroyed. It is not
+ * thread-safe.
+ */
+class MetadataTable {
+
+    struct Hash {
+        using is_transparent = void;
+        std::size_t operator()(const Metadata &m) const { return m.hash(); }
+        std::size_t operator()(const detail::SharedMetadata *m) const {
+            return m->data.hash();
+        }
+    };
+
+    struct Equal {
+        using is_transparent = void;
+        static const Metadata &data(const Metadata &m) { return m; }
+        static const Metadata &data(const detail::SharedMetadata *m) {
+            return m->data;
+        }
+        bool operator()(const auto &a, const auto &b) const {
+            return data(a) == data(b);
+        }
+    };
+
+    std::unordered_set<detail::SharedMetadata *, Hash, Equal> m_maps;
+
+  public:
+    MetadataTable() = default;
+    MetadataTable(const MetadataTable &) = delete;
+    MetadataTable(MetadataTable &&) noexcept = default;
+    MetadataTable &operator=(const MetadataTable &) = delete;
+    MetadataTable &operator=(MetadataTable &&other) noexcept {
+        // The maps of this table are released by `other`
+        m_maps.swap(other.m_maps);
+        return *this;
+    }
+    ~MetadataTable();
+
+    /**
+     * Replaces the metadata of an object, sharing the records with other
+     * objects that were assigned an identical map by this table.
+     *
+     * @param target the object to modify
+     * @param metadata the new metadata; empty metadata removes all records
+     */
+    void assign(detail::HasMetadata &target, Metadata &&metadata);
+
+    /**
+     * Returns the number of distinct non-empty maps stored by this table.
+     *
+     * @return the number of distinct maps
+     */
+    [[nodiscard]] std::size_t size() const { return m_maps.size(); }
+};
+
 } // namespace piwcs::prw
 
 #endif // PIWCS_PRW_MODEL_METADATA
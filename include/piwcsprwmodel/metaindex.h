@@ -0,0 +1,123 @@
+#ifndef PIWCS_PRW_MODEL_METAINDEX
+#define PIWCS_PRW_MODEL_METAINDEX
+
+#include "fwd.h"
+#include "idmap.h"
+#include "metadata.h"
+#include "util.h"
+#include <cstddef>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @file
+ *
+ * This header declares internals for indexing metadata.
+ */
+
+namespace piwcs::prw::detail {
+
+/**
+ * An inverted index from metadata records to the IDs of entities of type `T`
+ * that have them.
+ *
+ * Entities report possible changes through MetadataObserver. Reported
+ * entities are re-indexed lazily by `update`, so a burst of edits to the same
+ * entity costs a single update.
+ *
+ * Writes through a reference obtained from HasMetadata::metadata() are not
+ * reported. Entities that have handed out such a reference are therefore
+ * watched: `update` compares their metadata with the indexed copy every time.
+ *
+ * @tparam T Node or Section
+ */
+template <typename T> class MetadataIndex : public MetadataObserver {
+
+    using IdSet = std::unordered_set<Identifier, IdHash, std::equal_to<>>;
+
+    /**
+     * IDs of entities keyed by metadata key, then by value.
+     */
+    StableIdMap<StableIdMap<IdSet>> m_postings;
+
+    /**
+     * The metadata each entity was last indexed with.
+     */
+    IdMap<Metadata> m_indexed;
+
+    /**
+     * Entities that have to be re-indexed.
+     */
+    IdSet m_dirty;
+
+    /**
+     * Entities whose metadata may change without a report.
+     */
+    IdSet m_watched;
+
+    void unindex(IdRef id);
+
+  public:
+    void touched(const HasMetadata &obj) override {
+        m_dirty.emplace(static_cast<const T &>(obj).id());
+    }
+
+    /**
+     * Schedules an entity to be re-indexed.
+     *
+     * @param id the ID of the entity
+     */
+    void mark(IdRef id) { m_dirty.emplace(id); }
+
+    /**
+     * Removes an entity from the index.
+     *
+     * @param id the ID of the entity
+     */
+    void remove(IdRef id);
+
+    /**
+     * Re-indexes all entities reported since the last update and all watched
+     * entities whose metadata changed.
+     *
+     * @param entities the current entities, which may no longer contain some
+     * of the reported IDs
+     */
+    void update(const IdMap<T> &entities);
+
+    /**
+     * Returns the IDs of entities that have a record with the given key.
+     *
+     * The index must be up to date. The IDs remain valid until the next
+     * update.
+     *
+     * @param key the metadata key
+     *
+     * @return the IDs in no particular order
+     */
+    [[nodiscard]] std::vector<IdRef> find(IdRef key) const;
+
+    /**
+     * Returns the IDs of entities that have the given record.
+     *
+     * The index must be up to date. The IDs remain valid until the next
+     * update.
+     *
+     * @param key the metadata key
+     * @param value the metadata value
+     *
+     * @return the IDs in no particular order
+     */
+    [[nodiscard]] std::vector<IdRef> find(IdRef key, IdRef value) const;
+
+    /**
+     * Estimates the heap memory used by this index, in bytes.
+     *
+     * @return the approximate size of the memory owned by this index
+     */
+    [[nodiscard]] std::size_t memoryUsage() const;
+};
+
+} // namespace piwcs::prw::detail
+
+#endif // PIWCS_PRW_MODEL_METAINDEX
@@ -2,8 +2,14 @@
 #define PIWCS_PRW_MODEL_MODEL
 
 #include "fwd.h"
+#include "handle.h"
 #include "idmap.h"
+#include "idpool.h"
+#include "metaindex.h"
 #include "util.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
 
 // Both required by unordered_map
 #include "nodes.h"
@@ -37,10 +43,215 @@ namespace piwcs::prw {
  */
 class Model {
 
+    /**
+     * Pool of IDs referenced by Node slots and Section ends. It is allocated
+     * separately so that its address survives moves of the Model. Moved-from
+     * Models allocate a new pool when they need one; see `ids`.
+     */
+    std::unique_ptr<detail::IdPool> m_ids;
+
     IdMap<Node> m_nodes;
     IdMap<Section> m_sections;
 
+    /**
+     * Locations of Nodes and Sections for resolving handles. Entries are
+     * updated whenever the maps relocate their entries.
+     */
+    detail::HandleTable<Node> m_nodeHandles;
+    detail::HandleTable<Section> m_sectionHandles;
+
+    /**
+     * Index of destination sections keyed by destination address.
+     */
+    IdMap<Identifier> m_destinations;
+
+    /**
+     * Bitmasks of empty slots keyed by ID for Nodes with empty slots.
+     */
+    IdMap<std::uint8_t> m_openSlots;
+    std::size_t m_openSlotCount = 0;
+    std::size_t m_unlinkedSectionCount = 0;
+
+    /**
+     * Optional inverted indices of metadata. They are allocated separately so
+     * that entities can observe them across moves of the Model.
+     */
+    std::unique_ptr<detail::MetadataIndex<Node>> m_nodeMetadata;
+    std::unique_ptr<detail::MetadataIndex<Section>> m_sectionMetadata;
+
   public:
+    /**
+     * Constructs an empty Model.
+     */
+    Model();
+
+    /**
+     * Moves a Model. `other` is left empty and remains usable.
+     *
+     * @param other the Model to move from
+     */
+    Model(Model &&other) noexcept;
+
+    /**
+     * Moves a Model. `other` is left empty and remains usable.
+     *
+     * @param other the Model to move from
+     *
+     * @return this Model
+     */
+    Model &operator=(Model &&other) noexcept;
+
+    ~Model() = default;
+
+    /**
+     * A read-only view of all empty Node slots in a Model.
+     *
+     * Iteration yields `std::pair<IdRef, SlotId>` values that identify a Node
+     * and its empty slot. Iteration order is unspecified.
+     *
+     * The view is valid as long as the Model object exists, and its contents
+     * update dynamically as the Model object changes. Iterators are
+     * invalidated by any change to the Model.
+     */
+    class OpenSlots {
+
+        const IdMap<std::uint8_t> *m_masks;
+        const std::size_t *m_count;
+
+        OpenSlots(const IdMap<std::uint8_t> &masks, const std::size_t &count)
+            : m_masks(&masks), m_count(&count) {}
+
+        friend class Model;
+
+      public:
+        /**
+         * A forward iterator over empty Node slots.
+         */
+        class iterator {
+
+            using base = IdMap<std::uint8_t>::const_iterator;
+
+            base m_it;
+            base m_end;
+            SlotId m_slot = 0;
+
+            iterator(base it, base end) : m_it(it), m_end(end) { settle(); }
+
+            void settle() {
+                while (m_it != m_end) {
+                    for (; m_slot < Node::MAX_SLOTS; m_slot++) {
+                        if ((m_it->second & (1U << m_slot)) != 0) {
+                            return;
+                        }
+                    }
+                    ++m_it;
+                    m_slot = 0;
+                }
+            }
+
+            friend class OpenSlots;
+
+          public:
+            /**
+             * Type of iteration values.
+             */
+            using value_type = std::pair<IdRef, SlotId>;
+
+            /**
+             * Type of iterator differences.
+             */
+            using difference_type = std::ptrdiff_t;
+
+            /**
+             * Constructs an invalid iterator.
+             */
+            iterator() = default;
+
+            /**
+             * Returns the Node ID and the SlotId of the current empty slot.
+             *
+             * @return the current empty slot
+             */
+            value_type operator*() const { return {m_it->first, m_slot}; }
+
+            /**
+             * Advances to the next empty slot.
+             *
+             * @return this iterator
+             */
+            iterator &operator++() {
+                m_slot++;
+                settle();
+                return *this;
+            }
+
+            /**
+             * Advances to the next empty slot.
+             *
+             * @return a copy of this iterator before advancing
+             */
+            iterator operator++(int) {
+                iterator old = *this;
+                ++*this;
+                return old;
+            }
+
+            /**
+             * Compares two iterators.
+             */
+            bool operator==(const iterator &other) const {
+                return m_it == other.m_it && m_slot == other.m_slot;
+            }
+        };
+
+        /**
+         * Returns an iterator to the first empty slot.
+         *
+         * @return the begin iterator
+         */
+        [[nodiscard]] iterator begin() const {
+            return {m_masks->begin(), m_masks->end()};
+        }
+
+        /**
+         * Returns the past-the-end iterator.
+         *
+         * @return the end iterator
+         */
+        [[nodiscard]] iterator end() const {
+            return {m_masks->end(), m_masks->end()};
+        }
+
+        /**
+         * Returns the number of empty slots.
+         *
+         * @return the number of empty slots
+         */
+        [[nodiscard]] std::size_t size() const { return *m_count; }
+
+        /**
+         * Checks whether there are no empty slots.
+         *
+         * @return `true` if and only if all Node slots are connected
+         */
+        [[nodiscard]] bool empty() const { return *m_count == 0; }
+
+        /**
+         * Checks whether the given slot of the given Node is empty.
+         *
+         * @param node the ID of the Node
+         * @param slot the slot to check
+         *
+         * @return `true` if and only if the Node exists and its slot `slot`
+         * exists and is empty
+         */
+        [[nodiscard]] bool contains(IdRef node, SlotId slot) const {
+            auto it = m_masks->find(node);
+            return it != m_masks->end() && slot < Node::MAX_SLOTS &&
+                   (it->second & (1U << slot)) != 0;
+        }
+    };
+
     /**
      * Provides access to the internal mapping of IDs to all Nodes.
      *
@@ -328,6 +539,344 @@ class Model {
      * @return a raw pointer to the Section, or `nullptr` if none found
      */
     Section *section(IdRef id);
+
+    /**
+     * Returns a handle to the Node with the given ID.
+     *
+     * The handle remains valid until the Node is removed from this Model.
+     *
+     * @param id the ID of the Node
+     *
+     * @return a handle to the Node, or a default-constructed handle if none
+     * found
+     */
+    [[nodiscard]] NodeHandle nodeHandle(IdRef id) const;
+
+    /**
+     * Returns a handle to the Section with the given ID.
+     *
+     * The handle remains valid until the Section is removed from this Model.
+     *
+     * @param id the ID of the Section
+     *
+     * @return a handle to the Section, or a default-constructed handle if none
+     * found
+     */
+    [[nodiscard]] SectionHandle sectionHandle(IdRef id) const;
+
+    /**
+     * Resolves a Node handle in constant time without hashing.
+     *
+     * The returned pointer is valid until a change is made to this Model
+     * object.
+     *
+     * @param handle a handle issued by this Model
+     *
+     * @return a raw pointer to the Node, or `nullptr` if it has been removed
+     */
+    [[nodiscard]] const Node *node(NodeHandle handle) const {
+        return m_nodeHandles.get(handle);
+    }
+
+    /**
+     * Resolves a Section handle in constant time without hashing.
+     *
+     * The returned pointer is valid until a change is made to this Model
+     * object.
+     *
+     * @param handle a handle issued by this Model
+     *
+     * @return a raw pointer to the Section, or `nullptr` if it has been
+     * removed
+     */
+    [[nodiscard]] const Section *section(SectionHandle handle) const {
+        return m_sectionHandles.get(handle);
+    }
+
+    /**
+     * Resolves a Node handle in constant time without hashing.
+     *
+     * The returned pointer is valid until a change is made to this Model
+     * object.
+     *
+     * @param handle a handle issued by this Model
+     *
+     * @return a raw pointer to the Node, or `nullptr` if it has been removed
+     */
+    Node *node(NodeHandle handle) { return m_nodeHandles.get(handle); }
+
+    /**
+     * Resolves a Section handle in constant time without hashing.
+     *
+     * The returned pointer is valid until a change is made to this Model
+     * object.
+     *
+     * @param handle a handle issued by this Model
+     *
+     * @return a raw pointer to the Section, or `nullptr` if it has been
+     * removed
+     */
+    Section *section(SectionHandle handle) {
+        return m_sectionHandles.get(handle);
+    }
+
+    /**
+     * Searches for a Section that is a destination with the given address.
+     *
+     * This lookup runs in constant time on average.
+     *
+     * The returned pointer is valid until a change is made to this Model
+     * object.
+     *
+     * @param address the address of the Destination to find
+     *
+     * @return a raw pointer to the Section, or `nullptr` if none found
+     */
+    const Section *sectionByAddress(std::string_view address) const;
+
+    /**
+     * Searches for a Section that is a destination with the given address.
+     *
+     * This lookup runs in constant time on average.
+     *
+     * The returned pointer is valid until a change is made to this Model
+     * object.
+     *
+     * @param address the address of the Destination to find
+     *
+     * @return a raw pointer to the Section, or `nullptr` if none found
+     */
+    Section *sectionByAddress(std::string_view address);
+
+    /**
+     * Enables or disables the metadata index.
+     *
+     * The index maps metadata records of Nodes and Sections to their IDs so
+     * that `nodesWithMetadata` and `sectionsWithMetadata` run in time
+     * proportional to the size of their result. It follows all changes made
+     * through the metadata API of entities in this Model, including writes
+     * through references returned by `metadata()` and `metadata(IdRef)`;
+     * edits are picked up by the next query. Entities that have handed out
+     * such a reference are compared with the index on every query. Destination
+     * metadata is not indexed.
+     *
+     * Enabling the index is cheap; the index is built by the first query.
+     * Disabling it frees its memory.
+     *
+     * @param enabled whether the index should be maintained
+     */
+    void setMetadataIndexed(bool enabled);
+
+    /**
+     * Checks whether the metadata index is enabled.
+     *
+     * @return `true` if and only if the metadata index is maintained
+     */
+    [[nodiscard]] bool isMetadataIndexed() const {
+        return m_nodeMetadata != nullptr;
+    }
+
+    /**
+     * Finds Nodes that have a metadata record with the given key.
+     *
+     * If the metadata index is enabled, this runs in time proportional to the
+     * number of entities changed since the last query, plus the metadata of
+     * entities that have handed out writable metadata references, plus the
+     * size of the result. Otherwise, all Nodes are scanned.
+     *
+     * The returned IDs are valid until a change is made to this Model object.
+     *
+     * @param key the metadata key
+     *
+     * @return the IDs of matching Nodes in no particular order
+     */
+    [[nodiscard]] std::vector<IdRef> nodesWithMetadata(IdRef key);
+
+    /**
+     * Finds Nodes that have the given metadata record.
+     *
+     * The complexity and the validity of the result are the same as for
+     * `nodesWithMetadata(IdRef)`.
+     *
+     * @param key the metadata key
+     * @param value the metadata value
+     *
+     * @return the IDs of matching Nodes in no particular order
+     */
+    [[nodiscard]] std::vector<IdRef> nodesWithMetadata(IdRef key,
+                                                       IdRef value);
+
+    /**
+     * Finds Sections that have a metadata record with the given key.
+     *
+     * If the metadata index is enabled, this runs in time proportional to the
+     * number of entities changed since the last query, plus the metadata of
+     * entities that have handed out writable metadata references, plus the
+     * size of the result. Otherwise, all Sections are scanned.
+     *
+     * The returned IDs are valid until a change is made to this Model object.
+     *
+     * @param key the metadata key
+     *
+     * @return the IDs of matching Sections in no particular order
+     */
+    [[nodiscard]] std::vector<IdRef> sectionsWithMetadata(IdRef key);
+
+    /**
+     * Finds Sections that have the given metadata record.
+     *
+     * The complexity and the validity of the result are the same as for
+     * `sectionsWithMetadata(IdRef)`.
+     *
+     * @param key the metadata key
+     * @param value the metadata value
+     *
+     * @return the IDs of matching Sections in no particular order
+     */
+    [[nodiscard]] std::vector<IdRef> sectionsWithMetadata(IdRef key,
+                                                          IdRef value);
+
+    /**
+     * Provides access to all empty Node slots.
+     *
+     * The set of empty slots is maintained as the Model changes, so this
+     * method and the returned view do not scan the Model.
+     *
+     * @return a live view of empty Node slots
+     */
+    [[nodiscard]] OpenSlots openSlots() const {
+        return {m_openSlots, m_openSlotCount};
+    }
+
+    /**
+     * Returns the number of Sections that are not linked to Nodes.
+     *
+     * This count is maintained as the Model changes, so this method does not
+     * scan the Model.
+     *
+     * @return the number of unlinked Sections
+     */
+    [[nodiscard]] std::size_t unlinkedSectionCount() const {
+        return m_unlinkedSectionCount;
+    }
+
+    /**
+     * A breakdown of the heap memory used by a Model, in bytes.
+     */
+    struct MemoryUsage {
+        /**
+         * Node objects and the map entries that hold them.
+         */
+        std::size_t nodes = 0;
+
+        /**
+         * Section objects and the map entries that hold them.
+         */
+        std::size_t sections = 0;
+
+        /**
+         * Identifier strings of entities that are not stored inline, and the
+         * identifier pool that backs Node slots and Section ends.
+         */
+        std::size_t identifiers = 0;
+
+        /**
+         * Unused capacity and control bytes of hash maps, the destination
+         * address index, the empty slot index, handle tables and the metadata
+         * index.
+         */
+        std::size_t indices = 0;
+
+        /**
+         * Metadata of Nodes, Sections and Destinations, including values but
+         * not the interned keys shared by all objects.
+         */
+        std::size_t metadata = 0;
+
+        /**
+         * Destination objects with their addresses and names.
+         */
+        std::size_t destinations = 0;
+
+        /**
+         * Returns the sum of all categories.
+         *
+         * @return the total heap memory used
+         */
+        [[nodiscard]] std::size_t total() const {
+            return nodes + sections + identifiers + indices + metadata +
+                   destinations;
+        }
+    };
+
+    /**
+     * Estimates the heap memory used by this Model.
+     *
+     * The estimate covers all memory allocated by this Model, but not the
+     * Model object itself or allocator overhead. Memory of node-based
+     * standard containers is estimated from their sizes.
+     *
+     * This method runs in linear time in the number of entities and does not
+     * allocate memory, so it is cheap enough to export as a metric.
+     *
+     * @return a breakdown of memory usage by category
+     */
+    [[nodiscard]] MemoryUsage memoryUsage() const;
+
+    /**
+     * Statistics of metadata sharing in a Model.
+     */
+    struct MetadataStats {
+        /**
+         * Nodes, Sections and Destinations that have metadata.
+         */
+        std::size_t objects = 0;
+
+        /**
+         * Distinct metadata maps stored for these objects.
+         */
+        std::size_t stored = 0;
+
+        /**
+         * Returns the average number of objects per stored map. A ratio of 1
+         * means that no metadata is shared.
+         *
+         * @return `objects / stored`, or 1 if there is no metadata
+         */
+        [[nodiscard]] double ratio() const {
+            return stored == 0 ? 1.0
+                               : static_cast<double>(objects) /
+                                     static_cast<double>(stored);
+        }
+    };
+
+    /**
+     * Reports how much metadata is shared between entities; see
+     * MetadataTable.
+     *
+     * This method runs in linear time in the number of entities.
+     *
+     * @return the numbers of objects with metadata and of distinct maps
+     */
+    [[nodiscard]] MetadataStats metadataStats() const;
+
+  private:
+    detail::IdPool &ids();
+    void swap(Model &other) noexcept;
+
+    template <typename T>
+    static T &insert(IdMap<T> &map, detail::HandleTable<T> &handles,
+                     detail::MetadataIndex<T> *index, T &&entity);
+
+    Node &place(Node &&node);
+    Section &place(Section &&section);
+    void connect(Section &section, Node &start, SlotId startSlot, Node &end,
+                 SlotId endSlot);
+
+    void openSlot(IdRef nodeId, SlotId slot);
+    void closeSlot(IdRef nodeId, SlotId slot);
+
+    friend class ModelBuilder;
 };
 
 /**
@@ -361,6 +910,17 @@ inline bool operator!(Model::LinkResult r) {
     return r != Model::LinkResult::OK;
 }
 
+/**
+ * Checks for a non-OK result.
+ *
+ * @param r the result value to check
+ *
+ * @return true when r is not OK
+ */
+inline bool operator!(Model::UnlinkResult r) {
+    return r != Model::UnlinkResult::OK;
+}
+
 } // namespace piwcs::prw
 
 #endif // PIWCS_PRW_MODEL_MODEL
@@ -2,7 +2,10 @@
 #define PIWCS_PRW_MODEL_NODES
 
 #include "fwd.h"
+#include "handle.h"
+#include "idpool.h"
 #include "metadata.h"
+#include "nodetraits.h"
 #include "util.h"
 #include <iosfwd>
 
@@ -14,8 +17,6 @@
 
 namespace piwcs::prw {
 
-struct NodeTypeInfo;
-
 /**
  * A kind of Node reflecting its role, structure and function.
  *
@@ -76,17 +77,17 @@ using NodeType = const NodeTypeInfo *;
 /**
  * A node connecting two sections of a single track.
  */
-extern const NodeType THRU;
+inline constexpr NodeType THRU = &detail::THRU_INFO;
 
 /**
  * A motorized switch operated by a routing table.
  */
-extern const NodeType MOTORIZED;
+inline constexpr NodeType MOTORIZED = &detail::MOTORIZED_INFO;
 
 /**
  * A switch that cannot be entered from the common track.
  */
-extern const NodeType PASSIVE;
+inline constexpr NodeType PASSIVE = &detail::PASSIVE_INFO;
 
 /**
  * A switch that is fixed in a single position that can be entered from
@@ -94,7 +95,7 @@ extern const NodeType PASSIVE;
  *
  * These nodes are typically found at the edges of bidirectional regions.
  */
-extern const NodeType FIXED;
+inline constexpr NodeType FIXED = &detail::FIXED_INFO;
 
 /**
  * A switch that is fixed in a single position such that for the purposes of
@@ -103,22 +104,26 @@ extern const NodeType FIXED;
  *
  * These nodes are typically found at the edges of forbidden regions.
  */
-extern const NodeType MANUAL;
+inline constexpr NodeType MANUAL = &detail::MANUAL_INFO;
 
 /**
  * A level crossing of two tracks.
  */
-extern const NodeType CROSSING;
+inline constexpr NodeType CROSSING = &detail::CROSSING_INFO;
 
 /**
  * A dead end connected to a bidirectional section.
  */
-extern const NodeType END;
+inline constexpr NodeType END = &detail::END_INFO;
 
 /**
  * A Node at the joint or intersection of Sections.
  *
  * Nodes, as all Model entities, are mutable objects.
+ *
+ * Nodes that belong to a Model store the IDs of connected Sections in the
+ * identifier pool of that Model. Copies of such Nodes must not outlive the
+ * Model.
  */
 class Node : public detail::HasMetadata {
 
@@ -126,12 +131,14 @@ class Node : public detail::HasMetadata {
     /**
      * Maximum slot count.
      */
-    static constexpr std::size_t MAX_SLOTS = 4;
+    static constexpr std::size_t MAX_SLOTS = NodeTypeInfo::MAX_SLOTS;
 
   private:
     NodeType m_type;
     Identifier m_id;
-    Identifier m_slots[MAX_SLOTS];
+    const detail::IdPool *m_pool = nullptr;
+    detail::IdPool::Handle m_slots[MAX_SLOTS];
+    std::uint32_t m_handle = detail::HandleTable<Node>::NONE;
 
   public:
     /**
@@ -165,7 +172,7 @@ class Node : public detail::HasMetadata {
      *
      * @return the number of Sections Nodes of this Type connect
      */
-    [[nodiscard]] SlotId sectionCount() const;
+    [[nodiscard]] SlotId sectionCount() const { return m_type->slotCount; }
 
     /**
      * Returns the ID of the section in the requested slot, `ID_NULL` if the
@@ -176,7 +183,10 @@ class Node : public detail::HasMetadata {
      * @return the ID of the requested section, `ID_NULL` or `ID_INVALID`
      */
     [[nodiscard]] IdRef section(SlotId slot) const {
-        return slot > sectionCount() ? ID_INVALID : m_slots[slot];
+        if (slot >= sectionCount()) {
+            return ID_INVALID;
+        }
+        return m_pool == nullptr ? IdRef(ID_NULL) : m_pool->get(m_slots[slot]);
     }
 
     /**
@@ -205,7 +215,23 @@ class Node : public detail::HasMetadata {
      * that would permit travel from the Section at slot `from` to the Section
      * at slot `to`
      */
-    [[nodiscard]] bool couldTraverse(SlotId from, SlotId to) const;
+    [[nodiscard]] bool couldTraverse(SlotId from, SlotId to) const {
+        return m_type->couldTraverse(from, to);
+    }
+
+    /**
+     * Returns the slots `to` for which `couldTraverse(from, to)` is `true`.
+     *
+     * This value is constant for a given (Type, `from`) pair.
+     *
+     * @param from the slot of entry
+     *
+     * @return a mask with bit `to` set for each such slot; empty for invalid
+     * slots
+     */
+    [[nodiscard]] NodeTypeInfo::SlotMask successors(SlotId from) const {
+        return m_type->successors(from);
+    }
 
     /**
      * Outputs a textual representation of this Node to the `ostream`.
@@ -213,6 +239,7 @@ class Node : public detail::HasMetadata {
     friend std::ostream &operator<<(std::ostream &, const Node &);
 
     friend class Model;
+    friend class detail::ModelShard;
 };
 
 /**
@@ -0,0 +1,163 @@
+#ifndef PIWCS_PRW_MODEL_NODETRAITS
+#define PIWCS_PRW_MODEL_NODETRAITS
+
+#include "util.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @file
+ *
+ * This header declares NodeTypeInfo, the constant description of each node
+ * type.
+ */
+
+namespace piwcs::prw {
+
+/**
+ * The structure of a node type: its name, its slots and the transitions
+ * between slots that it permits.
+ *
+ * All node types are constant expressions, so that traits of a known type can
+ * be evaluated at compile time and queries of any type compile to a few
+ * loads and bit operations.
+ *
+ * Transitions are stored as bitmasks. The successors of a slot are the slots
+ * a train entering through it may exit through; they can be iterated with bit
+ * scans:
+ *
+ * ```cpp
+ * for (auto mask = type->successors(from); mask != 0; mask &= mask - 1) {
+ *     SlotId to = std::countr_zero(mask);
+ *     // ...
+ * }
+ * ```
+ */
+struct NodeTypeInfo {
+
+    /**
+     * Maximum slot count of any node type.
+     */
+    static constexpr std::size_t MAX_SLOTS = 4;
+
+    /**
+     * A set of slots with bit `i` standing for slot `i`.
+     */
+    using SlotMask = std::uint8_t;
+
+    /**
+     * A set of transitions with bit `MAX_SLOTS * from + to` standing for the
+     * transition from slot `from` to slot `to`.
+     */
+    using RouteMask = std::uint16_t;
+
+    static_assert(MAX_SLOTS * MAX_SLOTS <= 16, "RouteMask is too narrow");
+
+    /**
+     * Returns the RouteMask of a single transition.
+     *
+     * @param from the slot of entry, less than `MAX_SLOTS`
+     * @param to the slot of exit, less than `MAX_SLOTS`
+     *
+     * @return a mask with only the bit of the transition set
+     */
+    static constexpr RouteMask route(SlotId from, SlotId to) {
+        return static_cast<RouteMask>(1U << (MAX_SLOTS * from + to));
+    }
+
+    /**
+     * The name of this type, as used in model definitions.
+     */
+    const char *name = {};
+
+    /**
+     * The number of slots of nodes of this type.
+     */
+    SlotId slotCount = {};
+
+    /**
+     * All transitions permitted by this type.
+     */
+    RouteMask routes = {};
+
+    /**
+     * Successors of each slot, precomputed from `routes`.
+     */
+    SlotMask successorMasks[MAX_SLOTS] = {};
+
+    /**
+     * Constructs a node type.
+     *
+     * @param name the name of the type
+     * @param slotCount the number of slots, at most `MAX_SLOTS`
+     * @param routes the permitted transitions between those slots
+     */
+    constexpr NodeTypeInfo(const char *name, SlotId slotCount,
+                           RouteMask routes)
+        : name(name), slotCount(slotCount), routes(routes) {
+        for (SlotId from = 0; from < MAX_SLOTS; from++) {
+            successorMasks[from] = static_cast<SlotMask>(
+                (routes >> (MAX_SLOTS * from)) & ((1U << MAX_SLOTS) - 1));
+        }
+    }
+
+    NodeTypeInfo(const NodeTypeInfo &) = delete;
+    NodeTypeInfo &operator=(const NodeTypeInfo &) = delete;
+
+    /**
+     * Returns the slots that a train entering through slot `from` could exit
+     * through.
+     *
+     * @param from the slot of entry
+     *
+     * @return the successor slots, or an empty mask for invalid slots
+     */
+    [[nodiscard]] constexpr SlotMask successors(SlotId from) const {
+        return from < slotCount ? successorMasks[from] : SlotMask{0};
+    }
+
+    /**
+     * Checks whether this type permits travel from slot `from` to slot `to`.
+     *
+     * See Node::couldTraverse.
+     *
+     * @param from the slot of entry
+     * @param to the slot of exit
+     *
+     * @return `true` if and only if the transition is permitted; `false` for
+     * invalid slots
+     */
+    [[nodiscard]] constexpr bool couldTraverse(SlotId from, SlotId to) const {
+        return to < slotCount && ((successors(from) >> to) & 1U) != 0;
+    }
+};
+
+namespace detail {
+
+inline constexpr NodeTypeInfo THRU_INFO{
+    "THRU", 2, NodeTypeInfo::route(0, 1) | NodeTypeInfo::route(1, 0)};
+
+inline constexpr NodeTypeInfo MOTORIZED_INFO{
+    "MOTORIZED", 3, NodeTypeInfo::route(0, 1) | NodeTypeInfo::route(0, 2)};
+
+inline constexpr NodeTypeInfo PASSIVE_INFO{
+    "PASSIVE", 3, NodeTypeInfo::route(1, 0) | NodeTypeInfo::route(2, 0)};
+
+inline constexpr NodeTypeInfo FIXED_INFO{
+    "FIXED", 3, NodeTypeInfo::route(0, 1) | NodeTypeInfo::route(2, 0)};
+
+inline constexpr NodeTypeInfo MANUAL_INFO{
+    "MANUAL", 3, NodeTypeInfo::route(0, 1) | NodeTypeInfo::route(1, 0)};
+
+inline constexpr NodeTypeInfo CROSSING_INFO{
+    "CROSSING", 4,
+    NodeTypeInfo::route(0, 1) | NodeTypeInfo::route(1, 0) |
+        NodeTypeInfo::route(2, 3) | NodeTypeInfo::route(3, 2)};
+
+inline constexpr NodeTypeInfo END_INFO{"END", 1, 0};
+
+} // namespace detail
+
+} // namespace piwcs::prw
+
+#endif // PIWCS_PRW_MODEL_NODETRAITS
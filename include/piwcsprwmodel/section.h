@@ -2,6 +2,8 @@
 #define PIWCS_PRW_MODEL_SECTION
 
 #include "fwd.h"
+#include "handle.h"
+#include "idpool.h"
 #include "metadata.h"
 #include "util.h"
 #include <iosfwd>
@@ -24,7 +26,15 @@ namespace piwcs::prw {
  *
  * Some Sections are destinations and own a Destination object.
  *
+ * Each Section has a length and a cost multiplier, which routing and
+ * simulation code use to weigh Sections against each other. Both are plain
+ * numbers in arbitrary units and default to 1, so that the cost of a route
+ * counts its Sections unless attributes are given.
+ *
  * Sections, as all Model entities, are mutable objects.
+ *
+ * Sections that belong to a Model store the IDs of connected Nodes in the
+ * identifier pool of that Model.
  */
 class Section : public detail::HasMetadata {
 
@@ -49,12 +59,28 @@ class Section : public detail::HasMetadata {
         BIDIR
     };
 
+    /**
+     * The length of a Section that was not given one.
+     */
+    static constexpr float DEFAULT_LENGTH = 1;
+
+    /**
+     * The cost multiplier of a Section that was not given one.
+     */
+    static constexpr float DEFAULT_COST_MULTIPLIER = 1;
+
   private:
     Identifier m_id;
 
-    Identifier m_start;
-    Identifier m_end;
+    const detail::IdPool *m_pool = nullptr;
+    detail::IdPool::Handle m_start = detail::IdPool::NULL_HANDLE;
+    detail::IdPool::Handle m_end = detail::IdPool::NULL_HANDLE;
+    SlotId m_startSlot = SLOT_INVALID;
+    SlotId m_endSlot = SLOT_INVALID;
     AllowedTravel m_dir;
+    std::uint32_t m_handle = detail::HandleTable<Section>::NONE;
+    float m_length = DEFAULT_LENGTH;
+    float m_costMultiplier = DEFAULT_COST_MULTIPLIER;
 
     std::unique_ptr<Destination> m_dest;
 
@@ -94,7 +120,7 @@ class Section : public detail::HasMetadata {
      *
      * @return the ID of the start Node or `ID_NULL`
      */
-    [[nodiscard]] IdRef start() const { return m_start; }
+    [[nodiscard]] IdRef start() const { return resolve(m_start); }
 
     /**
      * Returns the ID of the Node at the end of this Section.
@@ -103,7 +129,21 @@ class Section : public detail::HasMetadata {
      *
      * @return the ID of the end Node or `ID_NULL`
      */
-    [[nodiscard]] IdRef end() const { return m_end; }
+    [[nodiscard]] IdRef end() const { return resolve(m_end); }
+
+    /**
+     * Returns the slot of the start Node that this Section is connected to.
+     *
+     * @return the SlotId of this Section in the start Node or `SLOT_INVALID`
+     */
+    [[nodiscard]] SlotId startSlot() const { return m_startSlot; }
+
+    /**
+     * Returns the slot of the end Node that this Section is connected to.
+     *
+     * @return the SlotId of this Section in the end Node or `SLOT_INVALID`
+     */
+    [[nodiscard]] SlotId endSlot() const { return m_endSlot; }
 
     /**
      * Returns the directionality of this Section for routed trains.
@@ -139,6 +179,49 @@ class Section : public detail::HasMetadata {
         return m_dir != AllowedTravel::NONE;
     }
 
+    /**
+     * Returns the length of this Section.
+     *
+     * @return the length, a finite non-negative number
+     */
+    [[nodiscard]] float length() const { return m_length; }
+
+    /**
+     * Returns the cost multiplier of this Section. Routing may use it to
+     * discourage or favor travel through this Section regardless of its
+     * length.
+     *
+     * @return the cost multiplier, a finite non-negative number
+     */
+    [[nodiscard]] float costMultiplier() const { return m_costMultiplier; }
+
+    /**
+     * Returns the cost of travel through this Section.
+     *
+     * @return the product of length and cost multiplier
+     */
+    [[nodiscard]] float cost() const { return m_length * m_costMultiplier; }
+
+    /**
+     * Changes the length of this Section.
+     *
+     * @param length the new length
+     *
+     * @return `false` if `length` is negative or not finite, in which case the
+     * length is not changed
+     */
+    bool setLength(float length);
+
+    /**
+     * Changes the cost multiplier of this Section.
+     *
+     * @param multiplier the new cost multiplier
+     *
+     * @return `false` if `multiplier` is negative or not finite, in which case
+     * the cost multiplier is not changed
+     */
+    bool setCostMultiplier(float multiplier);
+
     /**
      * Returns the ID of the node at the given index. This is a convenience
      * method to generalize `start()` and `end()`.
@@ -167,7 +250,9 @@ class Section : public detail::HasMetadata {
      *
      * @return `true` if this section is connected to nodes
      */
-    [[nodiscard]] bool isConnected() const { return m_start != ID_NULL; }
+    [[nodiscard]] bool isConnected() const {
+        return m_start != detail::IdPool::NULL_HANDLE;
+    }
 
     /**
      * Checks whether travel is allowed from Node in slot with index `from` to
@@ -211,6 +296,12 @@ class Section : public detail::HasMetadata {
     friend std::ostream &operator<<(std::ostream &, const Section &);
 
     friend class Model;
+    friend class detail::ModelShard;
+
+  private:
+    [[nodiscard]] IdRef resolve(detail::IdPool::Handle handle) const {
+        return m_pool == nullptr ? IdRef(ID_NULL) : m_pool->get(handle);
+    }
 };
 
 /**
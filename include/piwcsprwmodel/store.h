@@ -0,0 +1,343 @@
+#ifndef PIWCS_PRW_MODEL_STORE
+#define PIWCS_PRW_MODEL_STORE
+
+#include "compiled.h"
+#include "fwd.h"
+#include "idmap.h"
+#include "model.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @file
+ *
+ * This header declares ModelStore and ModelSnapshot, which share a Model
+ * between a writer and concurrent readers.
+ */
+
+namespace piwcs::prw {
+
+namespace detail {
+
+/**
+ * An immutable part of a ModelSnapshot.
+ *
+ * Entities are distributed among shards by the hash of their ID, and
+ * destination addresses by the hash of the address. Entities in a shard
+ * resolve IDs through the shard's own identifier pool.
+ */
+class ModelShard {
+
+    IdPool m_ids;
+    IdMap<Node> m_nodes;
+    IdMap<Section> m_sections;
+    IdMap<Identifier> m_destinations;
+
+    friend class piwcs::prw::ModelSnapshot;
+    friend class piwcs::prw::ModelStore;
+
+  public:
+    ModelShard() = default;
+    ModelShard(const ModelShard &) = delete;
+    ModelShard &operator=(const ModelShard &) = delete;
+
+    /**
+     * Adds a copy of `node` that resolves IDs through this shard.
+     */
+    void copy(const Node &node);
+
+    /**
+     * Adds a copy of `section` that resolves IDs through this shard.
+     */
+    void copy(const Section &section);
+};
+
+} // namespace detail
+
+/**
+ * An immutable version of a Model published by a ModelStore.
+ *
+ * Snapshots may be used from any number of threads concurrently. Each
+ * snapshot keeps the data it references alive, so readers may keep using a
+ * snapshot for as long as they hold it, regardless of later edits.
+ *
+ * Consecutive snapshots share the storage of all entities that did not change
+ * between them.
+ */
+class ModelSnapshot {
+
+  public:
+    /**
+     * The number of shards the entities are distributed among.
+     */
+    static constexpr std::size_t SHARD_COUNT = 256;
+
+  private:
+    using Shards =
+        std::array<std::shared_ptr<const detail::ModelShard>, SHARD_COUNT>;
+
+    Shards m_shards;
+    std::uint64_t m_version;
+    std::size_t m_nodeCount;
+    std::size_t m_sectionCount;
+
+    mutable std::once_flag m_compileOnce;
+    mutable std::unique_ptr<CompiledModel> m_compiled;
+
+    ModelSnapshot(Shards shards, std::uint64_t version, std::size_t nodeCount,
+                  std::size_t sectionCount);
+
+    friend class ModelStore;
+
+  public:
+    /**
+     * Returns the index of the shard that stores `key`.
+     *
+     * @param key an entity ID or a destination address
+     *
+     * @return the shard index
+     */
+    static std::size_t shardOf(std::string_view key);
+
+    ModelSnapshot(const ModelSnapshot &) = delete;
+    ModelSnapshot &operator=(const ModelSnapshot &) = delete;
+
+    /**
+     * Returns the version of this snapshot. The first snapshot of a store has
+     * version 1, and versions increase by one with each publication.
+     *
+     * @return the version of this snapshot
+     */
+    [[nodiscard]] std::uint64_t version() const { return m_version; }
+
+    /**
+     * Returns the number of Nodes in this snapshot.
+     *
+     * @return the number of Nodes
+     */
+    [[nodiscard]] std::size_t nodeCount() const { return m_nodeCount; }
+
+    /**
+     * Returns the number of Sections in this snapshot.
+     *
+     * @return the number of Sections
+     */
+    [[nodiscard]] std::size_t sectionCount() const { return m_sectionCount; }
+
+    /**
+     * Searches for a Node with the given ID.
+     *
+     * The returned pointer is valid for the lifetime of this snapshot.
+     *
+     * @param id the ID of the Node to find
+     *
+     * @return a raw pointer to the Node, or `nullptr` if none found
+     */
+    [[nodiscard]] const Node *node(IdRef id) const;
+
+    /**
+     * Searches for a Section with the given ID.
+     *
+     * The returned pointer is valid for the lifetime of this snapshot.
+     *
+     * @param id the ID of the Section to find
+     *
+     * @return a raw pointer to the Section, or `nullptr` if none found
+     */
+    [[nodiscard]] const Section *section(IdRef id) const;
+
+    /**
+     * Searches for a Section that is a destination with the given address.
+     *
+     * The returned pointer is valid for the lifetime of this snapshot.
+     *
+     * @param address the address of the Destination to find
+     *
+     * @return a raw pointer to the Section, or `nullptr` if none found
+     */
+    [[nodiscard]] const Section *
+    sectionByAddress(std::string_view address) const;
+
+    /**
+     * Calls `f(const Node &)` for every Node in this snapshot in an
+     * unspecified order.
+     *
+     * @param f the function to call
+     */
+    template <typename F> void forEachNode(F &&f) const {
+        for (const auto &shard : m_shards) {
+            for (const auto &[id, node] : shard->m_nodes) {
+                f(node);
+            }
+        }
+    }
+
+    /**
+     * Calls `f(const Section &)` for every Section in this snapshot in an
+     * unspecified order.
+     *
+     * @param f the function to call
+     */
+    template <typename F> void forEachSection(F &&f) const {
+        for (const auto &shard : m_shards) {
+            for (const auto &[id, section] : shard->m_sections) {
+                f(section);
+            }
+        }
+    }
+
+    /**
+     * Returns the CompiledModel of this snapshot, suitable for routing.
+     *
+     * The CompiledModel is built on first use; concurrent first calls build
+     * it once.
+     *
+     * @return the CompiledModel of this snapshot
+     */
+    [[nodiscard]] const CompiledModel &compiled() const;
+};
+
+/**
+ * A Model that is edited by one writer and read concurrently through
+ * immutable snapshots.
+ *
+ * The store owns a working Model. Edits are made through the store, which
+ * forwards them to the working Model and remembers which entities changed.
+ * `publish` then makes the changes visible to readers as a new ModelSnapshot.
+ * Publishing copies only the shards that contain changed entities; all other
+ * shards are shared with the previous snapshot.
+ *
+ * Readers obtain the latest snapshot with `snapshot`, which only swaps a
+ * reference count and never waits for edits or publication to complete.
+ *
+ * All methods except `snapshot` must be called by one writer thread at a
+ * time.
+ */
+class ModelStore {
+
+    Model m_model;
+    std::atomic<std::shared_ptr<const ModelSnapshot>> m_published;
+
+    std::vector<Identifier> m_dirtyNodes;
+    std::vector<Identifier> m_dirtySections;
+    std::vector<Identifier> m_dirtyAddresses;
+
+    std::vector<Identifier> m_heldNodes;
+    std::vector<Identifier> m_heldSections;
+
+    void touchNode(IdRef id);
+    void touchSection(const Section &section);
+    void touchHeld(const ModelSnapshot &published);
+    std::shared_ptr<const ModelSnapshot> rebuild(const ModelSnapshot *previous);
+
+  public:
+    /**
+     * Constructs a store that contains `model` and publishes its first
+     * snapshot.
+     *
+     * @param model the initial contents of the store
+     */
+    explicit ModelStore(Model model = {});
+
+    ModelStore(const ModelStore &) = delete;
+    ModelStore &operator=(const ModelStore &) = delete;
+
+    /**
+     * Returns the latest published snapshot. May be called from any thread.
+     *
+     * @return the latest snapshot
+     */
+    [[nodiscard]] std::shared_ptr<const ModelSnapshot> snapshot() const {
+        return m_published.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Publishes all edits made since the last publication as a new snapshot.
+     *
+     * If nothing changed, the current snapshot is returned.
+     *
+     * Every Node and Section ever returned by `node` or `section` is compared
+     * with its published copy, so this takes time linear in their number in
+     * addition to the cost of copying changed shards.
+     *
+     * @return the new snapshot
+     */
+    std::shared_ptr<const ModelSnapshot> publish();
+
+    /**
+     * Provides read access to the working Model, which includes unpublished
+     * edits.
+     *
+     * @return the working Model
+     */
+    [[nodiscard]] const Model &model() const { return m_model; }
+
+    /**
+     * Adds a Node to the working Model. See Model::addNode.
+     */
+    Model::AddResult addNode(Node node);
+
+    /**
+     * Adds a Section to the working Model. See Model::addSection.
+     */
+    Model::AddResult addSection(Section section);
+
+    /**
+     * Removes a Node from the working Model. See Model::removeNode.
+     */
+    Model::RemoveResult removeNode(IdRef id);
+
+    /**
+     * Removes a Section from the working Model. See Model::removeSection.
+     */
+    Model::RemoveResult removeSection(IdRef id);
+
+    /**
+     * Links two Nodes in the working Model. See Model::link.
+     */
+    Model::LinkResult link(IdRef sectionId, IdRef startNodeId,
+                           SlotId startSlotId, IdRef endNodeId,
+                           SlotId endSlotId);
+
+    /**
+     * Unlinks a Section in the working Model. See Model::unlink.
+     */
+    Model::UnlinkResult unlink(IdRef sectionId);
+
+    /**
+     * Provides write access to a Node of the working Model, e.g. to edit its
+     * metadata. The Node will be included in the next publication.
+     *
+     * The returned pointer is valid until the next edit. Changes made through
+     * it, or through metadata references obtained from it, are included in
+     * every later publication, including ones made after `publish` returns.
+     *
+     * @param id the ID of the Node to find
+     *
+     * @return a raw pointer to the Node, or `nullptr` if none found
+     */
+    Node *node(IdRef id);
+
+    /**
+     * Provides write access to a Section of the working Model, e.g. to edit
+     * its metadata. The Section will be included in the next publication.
+     *
+     * The returned pointer is valid until the next edit. Changes made through
+     * it, or through metadata references obtained from it, are included in
+     * every later publication, including ones made after `publish` returns.
+     *
+     * @param id the ID of the Section to find
+     *
+     * @return a raw pointer to the Section, or `nullptr` if none found
+     */
+    Section *section(IdRef id);
+};
+
+} // namespace piwcs::prw
+
+#endif // PIWCS_PRW_MODEL_STORE
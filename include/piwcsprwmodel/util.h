@@ -2,8 +2,14 @@
 #define PIWCS_PRW_MODEL_UTIL
 
 #include "fwd.h"
+#include <cstdint>
+#include <cstring>
 #include <string>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 /**
  * @file
  *
@@ -59,16 +65,118 @@ bool isIdOrNull(IdRef);
 bool isId(IdRef);
 
 /**
- * Allow Identifiers to be hash-transparent with IdRef and `const char *`.
+ * A fixed-size Identifier value for internal storage.
+ *
+ * InlineIds store up to `IDENT_LENGTH` bytes inline, padded with NUL bytes to
+ * 16 bytes, and never allocate memory. They can be compared and hashed with a
+ * few fixed-width operations.
  *
- * This hash uses `std::hash&lt;std::string_view&gt;` internally.
+ * Identifiers that are longer than `IDENT_LENGTH` or contain NUL bytes cannot
+ * be represented; use `fits` to check.
  */
-struct IdHash {
+class InlineId {
+
+    alignas(16) char m_data[IDENT_LENGTH + 1] = {};
+
+  public:
+    /**
+     * Constructs an InlineId equal to `ID_NULL`.
+     */
+    constexpr InlineId() = default;
+
+    /**
+     * Constructs an InlineId equal to the given Identifier.
+     *
+     * @param id the Identifier, `fits(id)` must be true
+     */
+    explicit InlineId(IdRef id) { id.copy(m_data, id.size()); }
+
+    /**
+     * Determines whether the given Identifier can be stored in an InlineId.
+     *
+     * @param id the Identifier to check
+     *
+     * @return `true` if and only if `id` is at most `IDENT_LENGTH` bytes long
+     * and contains no NUL bytes
+     */
+    static bool fits(IdRef id) {
+        return id.size() <= IDENT_LENGTH && id.find('\0') == IdRef::npos;
+    }
+
+    /**
+     * Returns the length of this Identifier.
+     *
+     * @return the length in bytes
+     */
+    [[nodiscard]] std::size_t size() const {
+        // There is at least one NUL byte
+        return static_cast<const char *>(
+                   std::memchr(m_data, '\0', sizeof(m_data))) -
+               m_data;
+    }
+
+    /**
+     * Returns a view of this Identifier.
+     *
+     * @return a view that is valid as long as this object exists
+     */
+    [[nodiscard]] IdRef view() const { return {m_data, size()}; }
+
     /**
-     * Hash type used internally.
+     * Computes a hash of this Identifier.
+     *
+     * The result equals `IdHash{}(view())`.
+     *
+     * @return the hash
      */
-    using hash_type = std::hash<std::string_view>;
+    [[nodiscard]] std::size_t hash() const { return hashBlock(m_data); }
+
+    /**
+     * Compares two InlineIds with a single 128-bit comparison.
+     */
+    bool operator==(const InlineId &other) const {
+#ifdef __SSE2__
+        // NOLINTBEGIN(*-reinterpret-cast)
+        __m128i a = _mm_load_si128(reinterpret_cast<const __m128i *>(m_data));
+        __m128i b =
+            _mm_load_si128(reinterpret_cast<const __m128i *>(other.m_data));
+        // NOLINTEND(*-reinterpret-cast)
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) == 0xFFFF;
+#else
+        return std::memcmp(m_data, other.m_data, sizeof(m_data)) == 0;
+#endif
+    }
 
+    /**
+     * Hashes a 16-byte block of NUL-padded identifier data.
+     *
+     * @param data pointer to 16 bytes
+     *
+     * @return the hash
+     */
+    static std::size_t hashBlock(const char *data) {
+        std::uint64_t lo{};
+        std::uint64_t hi{};
+        std::memcpy(&lo, data, sizeof(lo));
+        std::memcpy(&hi, data + sizeof(lo), sizeof(hi));
+
+        std::uint64_t h = (lo ^ 0x9E3779B97F4A7C15ULL) * 0xBF58476D1CE4E5B9ULL;
+        h ^= (hi + (h >> 29)) * 0x94D049BB133111EBULL;
+        h ^= h >> 32;
+        h *= 0xD6E8FEB86659FD93ULL;
+        h ^= h >> 32;
+        return static_cast<std::size_t>(h);
+    }
+};
+
+/**
+ * Allow Identifiers to be hash-transparent with IdRef, `const char *` and
+ * InlineId.
+ *
+ * Identifiers that fit into InlineId are hashed as a single fixed-width block.
+ * Longer Identifiers are hashed with `std::hash&lt;std::string_view&gt;`.
+ */
+struct IdHash {
     /**
      * This hash is transparent and so makes heterogeneous lookup possible.
      */
@@ -81,7 +189,9 @@ struct IdHash {
      *
      * @return the hash
      */
-    std::size_t operator()(const char *str) const { return hash_type{}(str); }
+    std::size_t operator()(const char *str) const {
+        return (*this)(IdRef(str));
+    }
 
     /**
      * Computes the hash of an identifier (an std::string).
@@ -91,9 +201,18 @@ struct IdHash {
      * @return the hash
      */
     std::size_t operator()(const Identifier &str) const {
-        return hash_type{}(str);
+        return (*this)(IdRef(str));
     }
 
+    /**
+     * Computes the hash of an InlineId.
+     *
+     * @param id the identifier to hash
+     *
+     * @return the hash
+     */
+    std::size_t operator()(const InlineId &id) const { return id.hash(); }
+
     /**
      * Computes the hash of an identifier reference (an std::string_view).
      *
@@ -101,7 +220,15 @@ struct IdHash {
      *
      * @return the hash
      */
-    std::size_t operator()(IdRef str) const { return hash_type{}(str); }
+    std::size_t operator()(IdRef str) const {
+        if (str.size() > IDENT_LENGTH) {
+            return std::hash<std::string_view>{}(str);
+        }
+
+        char block[IDENT_LENGTH + 1] = {};
+        str.copy(block, str.size());
+        return InlineId::hashBlock(block);
+    }
 };
 
 /**
@@ -1,25 +1,337 @@
 #include <piwcsprwmodel/algorithms.h>
 
+#include "debug.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <exception>
+#include <thread>
+
 namespace piwcs::prw {
 
 bool isComplete(const Model &model) {
-    // Check nodes
-    for (const auto &[id, node] : model.nodes()) {
-        for (SlotId slot = 0; slot < node.sectionCount(); slot++) {
-            if (node.section(slot) == ID_NULL) {
-                return false;
+    return model.openSlots().empty() && model.unlinkedSectionCount() == 0;
+}
+
+namespace {
+
+using Index = CompiledModel::Index;
+
+/*
+ * TrackStates are numbered 2 * section + reversed internally.
+ */
+Index toState(TrackState s) { return 2 * s.section + (s.reversed ? 1 : 0); }
+
+TrackState fromState(Index s) { return {s / 2, s % 2 != 0}; }
+
+/*
+ * Route tree entries. Values from TREE_SUCCESSOR on encode the position of
+ * the next TrackState among the successors of a TrackState.
+ */
+constexpr std::uint8_t TREE_UNREACHABLE = 0;
+constexpr std::uint8_t TREE_DESTINATION = 1;
+constexpr std::uint8_t TREE_SUCCESSOR = 2;
+
+bool canEnter(Section::AllowedTravel dir, SlotId from) {
+    switch (dir) {
+    case Section::AllowedTravel::NONE:
+        return false;
+    case Section::AllowedTravel::UNIDIR:
+        return from == 0;
+    case Section::AllowedTravel::BIDIR:
+        return true;
+    }
+    _FAIL("Unhandled AllowedTravel case");
+    return false; // Unreachable
+}
+
+/*
+ * Calls action(next) for each state that can be reached from state, in slot
+ * order.
+ */
+template <typename F>
+void forEachSuccessor(const CompiledModel &model, Index state, F action) {
+    Index section = state / 2;
+    SlotId exit = state % 2 == 0 ? 1 : 0;
+
+    Index node = model.sectionNode(section, exit);
+    if (node == CompiledModel::NONE) {
+        return;
+    }
+
+    SlotId from = model.sectionSlot(section, exit);
+    unsigned routes = model.nodeType(node)->successors(from);
+
+    for (; routes != 0; routes &= routes - 1) {
+        auto to = static_cast<SlotId>(std::countr_zero(routes));
+
+        Index next = model.slotSection(node, to);
+        if (next == CompiledModel::NONE) {
+            continue;
+        }
+
+        SlotId entry = model.sectionNode(next, 0) == node &&
+                               model.sectionSlot(next, 0) == to
+                           ? 0
+                           : 1;
+
+        if (canEnter(model.sectionDir(next), entry)) {
+            action(2 * next + entry);
+        }
+    }
+}
+
+} // namespace
+
+Router::Router(const CompiledModel &model)
+    : m_model(model),
+      m_treeFlags(new std::once_flag[model.destinationCount()]),
+      m_trees(model.destinationCount()) {
+
+    Index stateCount = 2 * model.sectionCount();
+
+    // Build reverse adjacency in CSR form
+    m_predBegin.assign(std::size_t{stateCount} + 1, 0);
+    for (Index s = 0; s < stateCount; s++) {
+        forEachSuccessor(model, s,
+                         [&](Index next) { m_predBegin[next + 1]++; });
+    }
+    for (Index s = 0; s < stateCount; s++) {
+        m_predBegin[s + 1] += m_predBegin[s];
+    }
+
+    m_preds.resize(m_predBegin[stateCount]);
+    std::vector<Index> fill(m_predBegin.begin(), m_predBegin.end() - 1);
+    for (Index s = 0; s < stateCount; s++) {
+        forEachSuccessor(model, s,
+                         [&](Index next) { m_preds[fill[next]++] = s; });
+    }
+}
+
+struct Router::SearchBuffers {
+    std::vector<std::uint8_t> tree;
+    std::vector<Index> distance;
+    std::vector<Index> queue;
+};
+
+void Router::search(Index dest, SearchBuffers &buffers) const {
+    Index stateCount = 2 * m_model.sectionCount();
+    auto &[tree, distance, queue] = buffers;
+
+    tree.assign(stateCount, TREE_UNREACHABLE);
+    distance.assign(stateCount, CompiledModel::NONE);
+    queue.clear();
+
+    // Breadth-first search backwards from the destination
+    Index section = m_model.destinationSection(dest);
+    for (Index s : {2 * section, 2 * section + 1}) {
+        tree[s] = TREE_DESTINATION;
+        distance[s] = 0;
+        queue.push_back(s);
+    }
+
+    for (std::size_t head = 0; head < queue.size(); head++) {
+        Index state = queue[head];
+
+        for (Index i = m_predBegin[state]; i < m_predBegin[state + 1]; i++) {
+            Index pred = m_preds[i];
+            if (distance[pred] != CompiledModel::NONE) {
+                continue;
             }
+            distance[pred] = distance[state] + 1;
+
+            // All states at distance[state] have been discovered by now, so
+            // the first successor in slot order on a shortest route is chosen
+            std::uint8_t position = TREE_SUCCESSOR;
+            forEachSuccessor(m_model, pred, [&](Index next) {
+                if (tree[pred] == TREE_UNREACHABLE &&
+                    distance[next] == distance[state]) {
+                    tree[pred] = position;
+                }
+                position++;
+            });
+
+            _ASSERT(tree[pred] != TREE_UNREACHABLE,
+                    "predecessor does not lead to state");
+            queue.push_back(pred);
         }
     }
+}
+
+const std::vector<std::uint8_t> &Router::tree(Index dest) const {
+    std::call_once(m_treeFlags[dest], [&]() {
+        SearchBuffers buffers;
+        search(dest, buffers);
+        m_trees[dest] = std::move(buffers.tree);
+    });
+
+    return m_trees[dest];
+}
+
+Route Router::route(TrackState from, std::string_view address) const {
+    Index dest = m_model.destinationIndex(address);
+    if (dest == CompiledModel::NONE) {
+        return {};
+    }
+    return route(from, dest);
+}
 
-    // Check sections
-    for (const auto &[id, section] : model.sections()) {
-        if (!section.isConnected()) {
-            return false;
+Route Router::route(TrackState from, Index dest) const {
+    if (from.section >= m_model.sectionCount()) {
+        return {};
+    }
+
+    const auto &tree = this->tree(dest);
+    Index state = toState(from);
+
+    if (tree[state] == TREE_UNREACHABLE) {
+        return {};
+    }
+
+    Route result;
+    result.push_back(from);
+
+    while (tree[state] != TREE_DESTINATION) {
+        std::uint8_t position = TREE_SUCCESSOR;
+        Index chosen = CompiledModel::NONE;
+        forEachSuccessor(m_model, state, [&](Index next) {
+            if (position++ == tree[state]) {
+                chosen = next;
+            }
+        });
+
+        _ASSERT(chosen != CompiledModel::NONE, "route tree is corrupt");
+        state = chosen;
+        result.push_back(fromState(state));
+    }
+
+    return result;
+}
+
+std::vector<TrackState> Router::successors(TrackState from) const {
+    std::vector<TrackState> result;
+    if (from.section < m_model.sectionCount()) {
+        forEachSuccessor(m_model, toState(from), [&](Index next) {
+            result.push_back(fromState(next));
+        });
+    }
+    return result;
+}
+
+void Router::precompute() const {
+    for (Index dest = 0; dest < m_model.destinationCount(); dest++) {
+        (void)tree(dest);
+    }
+}
+
+namespace {
+
+/*
+ * Determines the choice of MOTORIZED node for the route tree.
+ */
+SwitchTable::Choice decide(const CompiledModel &model,
+                           const std::vector<std::uint8_t> &tree, Index node) {
+    Index common = model.slotSection(node, COMMON);
+    if (common == CompiledModel::NONE) {
+        return SwitchTable::Choice::NONE;
+    }
+
+    // The state of a train approaching node through its common track
+    bool reversed = model.sectionNode(common, 1) != node ||
+                    model.sectionSlot(common, 1) != COMMON;
+    Index state = 2 * common + (reversed ? 1 : 0);
+
+    if (tree[state] < TREE_SUCCESSOR) {
+        return SwitchTable::Choice::NONE;
+    }
+
+    std::uint8_t position = TREE_SUCCESSOR;
+    Index chosen = CompiledModel::NONE;
+    forEachSuccessor(model, state, [&](Index next) {
+        if (position++ == tree[state]) {
+            chosen = next / 2;
         }
+    });
+
+    return chosen == model.slotSection(node, STRAIGHT)
+               ? SwitchTable::Choice::STRAIGHT
+               : SwitchTable::Choice::DIVERGING;
+}
+
+} // namespace
+
+SwitchTable::SwitchTable(const Router &router, unsigned threads)
+    : m_destinationCount(router.model().destinationCount()) {
+
+    const auto &model = router.model();
+
+    m_rows.assign(model.nodeCount(), CompiledModel::NONE);
+    for (Index node = 0; node < model.nodeCount(); node++) {
+        if (model.nodeType(node) == MOTORIZED) {
+            m_rows[node] = static_cast<Index>(m_nodes.size());
+            m_nodes.push_back(node);
+        }
+    }
+
+    // Choices are stored by destination, four per byte, so that destinations
+    // can be filled in concurrently
+    m_stride = (m_nodes.size() + 3) / 4;
+    m_choices.assign(m_stride * m_destinationCount, 0);
+
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    threads = std::min(threads, m_destinationCount);
+
+    std::atomic<Index> nextDest = 0;
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto work = [&]() {
+        try {
+            Router::SearchBuffers buffers;
+            for (Index dest = nextDest++; dest < m_destinationCount;
+                 dest = nextDest++) {
+                router.search(dest, buffers);
+
+                std::uint8_t *column = &m_choices[m_stride * dest];
+                for (std::size_t row = 0; row < m_nodes.size(); row++) {
+                    auto choice = decide(model, buffers.tree, m_nodes[row]);
+                    column[row / 4] |= static_cast<std::uint8_t>(
+                        static_cast<unsigned>(choice) << (2 * (row % 4)));
+                }
+            }
+        } catch (...) {
+            std::lock_guard lock(errorMutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            nextDest = m_destinationCount;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+SwitchTable::Choice SwitchTable::choice(Index node, Index dest) const {
+    Index row = m_rows[node];
+    if (row == CompiledModel::NONE) {
+        return Choice::NONE;
     }
 
-    return true;
+    auto bits = m_choices[m_stride * dest + row / 4] >> (2 * (row % 4));
+    return static_cast<Choice>(bits & 0b11U);
 }
 
 } // namespace piwcs::prw
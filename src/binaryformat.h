@@ -0,0 +1,84 @@
+#ifndef PIWCS_PRW_MODEL_BINARYFORMAT
+#define PIWCS_PRW_MODEL_BINARYFORMAT
+
+#include <piwcsprwmodel/nodes.h>
+
+#include "debug.h"
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+/*
+ * Encoding details shared by the binary snapshot and journal formats.
+ */
+
+namespace piwcs::prw::detail {
+
+/**
+ * Marks the byte order of the writing machine in binary headers.
+ */
+constexpr std::uint32_t ENDIAN_MARK = 0x01020304;
+
+/**
+ * Node types in the order of their binary codes. Never reorder.
+ */
+inline const NodeType *nodeTypes() {
+    static const NodeType types[] = {
+        THRU, MOTORIZED, PASSIVE, FIXED, MANUAL, CROSSING, END,
+    };
+    return types;
+}
+
+constexpr std::uint32_t NODE_TYPE_COUNT = 7;
+
+/**
+ * Returns the binary code of a node type.
+ */
+inline std::uint32_t nodeTypeCode(NodeType type) {
+    for (std::uint32_t i = 0; i < NODE_TYPE_COUNT; i++) {
+        if (nodeTypes()[i] == type) {
+            return i;
+        }
+    }
+    _FAIL("unknown node type");
+    return 0;
+}
+
+/**
+ * Computes a fast non-cryptographic checksum of `data` that detects
+ * truncation and accidental corruption.
+ *
+ * Passing the checksum of a preceding block whose size is a multiple of 8 as
+ * `seed` yields the checksum of both blocks together.
+ */
+inline std::uint64_t checksum(std::string_view data,
+                              std::uint64_t seed = 0xCBF29CE484222325) {
+    constexpr std::uint64_t PRIME = 0x100000001B3;
+    std::uint64_t hash = seed;
+
+    std::size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data.data() + i, 8);
+        hash = std::rotl((hash ^ word) * PRIME, 31);
+    }
+    for (; i < data.size(); i++) {
+        hash = (hash ^ static_cast<std::uint8_t>(data[i])) * PRIME;
+    }
+
+    return hash;
+}
+
+/**
+ * Appends the object representation of `value` to `out`.
+ */
+template <typename T> void append(std::string &out, const T &value) {
+    out.append(reinterpret_cast<const char *>(&value), // NOLINT
+               sizeof(T));
+}
+
+} // namespace piwcs::prw::detail
+
+#endif // PIWCS_PRW_MODEL_BINARYFORMAT
@@ -0,0 +1,269 @@
+#include <piwcsprwmodel/builder.h>
+
+#include "debug.h"
+#include <bit>
+#include <limits>
+
+namespace piwcs::prw {
+
+namespace {
+
+using Kind = ModelBuilder::Violation::Kind;
+
+/*
+ * Maps IDs to positions in the builder's vectors. Keys refer to IDs stored
+ * in those vectors.
+ */
+using IndexMap =
+    detail::FlatMap<IdRef, std::uint32_t, IdHash, std::equal_to<>>;
+
+constexpr std::uint32_t NOT_FOUND = std::numeric_limits<std::uint32_t>::max();
+
+std::uint32_t lookup(const IndexMap &index, IdRef id) {
+    auto it = index.find(id);
+    return it == index.end() ? NOT_FOUND : it->second;
+}
+
+} // namespace
+
+std::string ModelBuilder::Violation::message() const {
+    const char *what = "";
+    switch (kind) {
+    case Kind::NODE_BAD_ID:
+        what = "invalid node ID";
+        break;
+    case Kind::NODE_DUPLICATE:
+        what = "duplicate node ID";
+        break;
+    case Kind::NODE_HAS_REF:
+        what = "node references sections";
+        break;
+    case Kind::SECTION_BAD_ID:
+        what = "invalid section ID";
+        break;
+    case Kind::SECTION_DUPLICATE:
+        what = "duplicate section ID";
+        break;
+    case Kind::SECTION_HAS_REF:
+        what = "section references nodes";
+        break;
+    case Kind::ADDRESS_DUPLICATE:
+        what = "duplicate destination address in section";
+        break;
+    case Kind::LINK_NOT_FOUND:
+        what = "link refers to missing entities or slots in section";
+        break;
+    case Kind::LINK_SAME_NODE:
+        what = "link connects a node to itself in section";
+        break;
+    case Kind::LINK_NODE_OCCUPIED:
+        what = "link uses an occupied slot in section";
+        break;
+    case Kind::LINK_SECTION_OCCUPIED:
+        what = "section is linked more than once";
+        break;
+    }
+    return std::string(what) + " '" + id + "'";
+}
+
+void ModelBuilder::reserve(std::size_t nodes, std::size_t sections) {
+    m_nodes.reserve(nodes);
+    m_sections.reserve(sections);
+    m_links.reserve(sections);
+}
+
+void ModelBuilder::addNode(Node node) {
+    m_nodes.push_back(std::move(node));
+    m_validated = false;
+}
+
+void ModelBuilder::addSection(Section section) {
+    m_sections.push_back(std::move(section));
+    m_validated = false;
+}
+
+void ModelBuilder::link(IdRef sectionId, IdRef startNodeId,
+                        SlotId startSlotId, IdRef endNodeId,
+                        SlotId endSlotId) {
+    m_links.push_back({Identifier(sectionId), Identifier(startNodeId),
+                       startSlotId, Identifier(endNodeId), endSlotId});
+    m_validated = false;
+}
+
+const std::vector<ModelBuilder::Violation> &ModelBuilder::validate() {
+    if (m_validated) {
+        return m_violations;
+    }
+
+    m_violations.clear();
+    m_resolved.clear();
+    m_resolved.reserve(m_links.size());
+
+    auto report = [&](Kind kind, IdRef id) {
+        m_violations.push_back({kind, Identifier(id)});
+    };
+
+    // Node slots used by links, one bit per slot
+    std::vector<std::uint8_t> usedSlots(m_nodes.size());
+
+    IndexMap nodes;
+    nodes.reserve(m_nodes.size());
+    for (std::uint32_t i = 0; i < m_nodes.size(); i++) {
+        const Node &node = m_nodes[i];
+        if (!isId(node.id())) {
+            report(Kind::NODE_BAD_ID, node.id());
+            continue;
+        }
+        if (!nodes.try_emplace(node.id(), i).second) {
+            report(Kind::NODE_DUPLICATE, node.id());
+            continue;
+        }
+        for (SlotId slot = 0; slot < node.sectionCount(); slot++) {
+            if (isId(node.section(slot))) {
+                report(Kind::NODE_HAS_REF, node.id());
+                break;
+            }
+        }
+    }
+
+    // Whether each Section is used by a link
+    std::vector<bool> linked(m_sections.size());
+
+    IndexMap sections;
+    IndexMap addresses;
+    sections.reserve(m_sections.size());
+    for (std::uint32_t i = 0; i < m_sections.size(); i++) {
+        const Section &section = m_sections[i];
+        if (!isId(section.id())) {
+            report(Kind::SECTION_BAD_ID, section.id());
+            continue;
+        }
+        if (sections.contains(section.id())) {
+            report(Kind::SECTION_DUPLICATE, section.id());
+            continue;
+        }
+        if (const Destination *dest = section.destination()) {
+            if (!addresses.try_emplace(dest->address(), i).second) {
+                report(Kind::ADDRESS_DUPLICATE, section.id());
+                continue;
+            }
+        }
+        sections.emplace(section.id(), i);
+        if (isId(section.start()) || isId(section.end())) {
+            report(Kind::SECTION_HAS_REF, section.id());
+        }
+    }
+
+    for (const auto &l : m_links) {
+        std::uint32_t section = lookup(sections, l.section);
+        std::uint32_t start = lookup(nodes, l.startNode);
+        std::uint32_t end = lookup(nodes, l.endNode);
+
+        if (section == NOT_FOUND || start == NOT_FOUND || end == NOT_FOUND ||
+            l.startSlot >= m_nodes[start].sectionCount() ||
+            l.endSlot >= m_nodes[end].sectionCount()) {
+            report(Kind::LINK_NOT_FOUND, l.section);
+            continue;
+        }
+        if (start == end) {
+            report(Kind::LINK_SAME_NODE, l.section);
+            continue;
+        }
+
+        auto startBit = static_cast<std::uint8_t>(1U << l.startSlot);
+        auto endBit = static_cast<std::uint8_t>(1U << l.endSlot);
+        if ((usedSlots[start] & startBit) != 0 ||
+            (usedSlots[end] & endBit) != 0) {
+            report(Kind::LINK_NODE_OCCUPIED, l.section);
+            continue;
+        }
+        if (linked[section]) {
+            report(Kind::LINK_SECTION_OCCUPIED, l.section);
+            continue;
+        }
+
+        usedSlots[start] |= startBit;
+        usedSlots[end] |= endBit;
+        linked[section] = true;
+        m_resolved.push_back({section, start, l.startSlot, end, l.endSlot});
+    }
+
+    m_validated = true;
+    return m_violations;
+}
+
+Model ModelBuilder::build() {
+    const auto &violations = validate();
+    if (!violations.empty()) {
+        std::string message = violations.front().message();
+        if (violations.size() > 1) {
+            message += " and " + std::to_string(violations.size() - 1) +
+                       " more problems";
+        }
+        throw IllegalModelError(message);
+    }
+
+    Model model;
+
+    // Every table is allocated at its final size, so entities never move
+    // once placed
+    model.m_nodes.reserve(m_nodes.size());
+    model.m_sections.reserve(m_sections.size());
+    model.m_nodeHandles.reserve(m_nodes.size());
+    model.m_sectionHandles.reserve(m_sections.size());
+    model.ids().reserve(m_sections.size() + 2 * m_resolved.size());
+
+    std::vector<Node *> nodes;
+    nodes.reserve(m_nodes.size());
+    for (auto &node : m_nodes) {
+        nodes.push_back(&model.place(std::move(node)));
+    }
+
+    std::size_t destinations = 0;
+    std::vector<Section *> sections;
+    sections.reserve(m_sections.size());
+    for (auto &section : m_sections) {
+        destinations += section.isDestination() ? 1 : 0;
+        sections.push_back(&model.place(std::move(section)));
+    }
+
+    model.m_destinations.reserve(destinations);
+    for (const Section *section : sections) {
+        if (const Destination *dest = section->destination()) {
+            model.m_destinations.emplace(dest->address(),
+                                         Identifier(section->id()));
+        }
+    }
+
+    std::vector<std::uint8_t> usedSlots(nodes.size());
+    for (const auto &l : m_resolved) {
+        model.connect(*sections[l.section], *nodes[l.start], l.startSlot,
+                      *nodes[l.end], l.endSlot);
+        usedSlots[l.start] |= static_cast<std::uint8_t>(1U << l.startSlot);
+        usedSlots[l.end] |= static_cast<std::uint8_t>(1U << l.endSlot);
+    }
+
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+        unsigned all = (1U << nodes[i]->sectionCount()) - 1;
+        auto open = static_cast<std::uint8_t>(all & ~usedSlots[i]);
+        if (open != 0) {
+            model.m_openSlots.emplace(nodes[i]->id(), open);
+            model.m_openSlotCount += std::popcount(open);
+        }
+    }
+    model.m_unlinkedSectionCount = sections.size() - m_resolved.size();
+
+    _ASSERT(model.m_nodes.size() == nodes.size(), "node lost while building");
+    _ASSERT(model.m_sections.size() == sections.size(),
+            "section lost while building");
+
+    m_nodes.clear();
+    m_sections.clear();
+    m_links.clear();
+    m_resolved.clear();
+    m_validated = false;
+
+    return model;
+}
+
+} // namespace piwcs::prw
@@ -0,0 +1,170 @@
+#include <piwcsprwmodel/compiled.h>
+#include <piwcsprwmodel/store.h>
+
+#include "debug.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace piwcs::prw {
+
+namespace {
+
+using Index = CompiledModel::Index;
+
+/*
+ * Collects the IDs of all Nodes or Sections in lexicographic order.
+ */
+template <typename ForEach>
+std::vector<Identifier> sortedIds(std::size_t count, const ForEach &forEach) {
+    if (count >= CompiledModel::NONE) {
+        throw std::length_error("too many entities to compile");
+    }
+
+    std::vector<Identifier> ids;
+    ids.reserve(count);
+    forEach([&](const auto &entity) { ids.emplace_back(entity.id()); });
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+/*
+ * Uniform access to the entities of a Model and of a ModelSnapshot.
+ */
+std::vector<Identifier> sortedNodeIds(const Model &model) {
+    return sortedIds(model.nodes().size(), [&](const auto &f) {
+        for (const auto &[id, node] : model.nodes()) {
+            f(node);
+        }
+    });
+}
+
+std::vector<Identifier> sortedSectionIds(const Model &model) {
+    return sortedIds(model.sections().size(), [&](const auto &f) {
+        for (const auto &[id, section] : model.sections()) {
+            f(section);
+        }
+    });
+}
+
+std::vector<Identifier> sortedNodeIds(const ModelSnapshot &snapshot) {
+    return sortedIds(snapshot.nodeCount(),
+                     [&](const auto &f) { snapshot.forEachNode(f); });
+}
+
+std::vector<Identifier> sortedSectionIds(const ModelSnapshot &snapshot) {
+    return sortedIds(snapshot.sectionCount(),
+                     [&](const auto &f) { snapshot.forEachSection(f); });
+}
+
+/*
+ * Maps each ID to its position in ids.
+ */
+IdMap<Index> indexOf(const std::vector<Identifier> &ids) {
+    IdMap<Index> index;
+    index.reserve(ids.size());
+    for (Index i = 0; i < ids.size(); i++) {
+        index.emplace(ids[i], i);
+    }
+    return index;
+}
+
+Index find(const IdMap<Index> &index, std::string_view key) {
+    auto it = index.find(key);
+    return it == index.end() ? CompiledModel::NONE : it->second;
+}
+
+} // namespace
+
+CompiledModel::CompiledModel(const Model &model) { compile(model); }
+
+CompiledModel::CompiledModel(const ModelSnapshot &snapshot) {
+    compile(snapshot);
+}
+
+template <typename Source> void CompiledModel::compile(const Source &model) {
+    m_nodeIds = sortedNodeIds(model);
+    m_sectionIds = sortedSectionIds(model);
+    m_nodeIndex = indexOf(m_nodeIds);
+    m_sectionIndex = indexOf(m_sectionIds);
+
+    // Sections
+    m_sectionDirs.reserve(sectionCount());
+    m_sectionLengths.reserve(sectionCount());
+    m_sectionCosts.reserve(sectionCount());
+    m_sectionNodes.assign(2 * std::size_t{sectionCount()}, NONE);
+    m_sectionSlots.assign(2 * std::size_t{sectionCount()}, SLOT_INVALID);
+    m_sectionDests.assign(sectionCount(), NONE);
+
+    for (Index s = 0; s < sectionCount(); s++) {
+        const Section *section = model.section(m_sectionIds[s]);
+        _ASSERT(section != nullptr, "section not found");
+
+        m_sectionDirs.push_back(section->dir());
+        m_sectionLengths.push_back(section->length());
+        m_sectionCosts.push_back(section->cost());
+
+        if (section->isDestination()) {
+            m_destAddresses.push_back(section->destination()->address());
+        }
+    }
+
+    // Destinations
+    std::sort(m_destAddresses.begin(), m_destAddresses.end());
+    m_destIndex = indexOf(m_destAddresses);
+    m_destSections.resize(m_destAddresses.size());
+
+    for (Index d = 0; d < destinationCount(); d++) {
+        const Section *section = model.sectionByAddress(m_destAddresses[d]);
+        _ASSERT(section != nullptr, "destination section not found");
+
+        Index s = find(m_sectionIndex, section->id());
+        m_destSections[d] = s;
+        m_sectionDests[s] = d;
+    }
+
+    // Nodes and links
+    m_nodeTypes.reserve(nodeCount());
+    m_slotBegin.reserve(std::size_t{nodeCount()} + 1);
+    m_slotBegin.push_back(0);
+
+    for (Index n = 0; n < nodeCount(); n++) {
+        const Node *node = model.node(m_nodeIds[n]);
+        _ASSERT(node != nullptr, "node not found");
+
+        m_nodeTypes.push_back(node->type());
+
+        for (SlotId slot = 0; slot < node->sectionCount(); slot++) {
+            IdRef sectionId = node->section(slot);
+            if (sectionId == ID_NULL) {
+                m_slotSections.push_back(NONE);
+                continue;
+            }
+
+            Index s = find(m_sectionIndex, sectionId);
+            _ASSERT(s != NONE, "linked section not found");
+            m_slotSections.push_back(s);
+
+            const Section *section = model.section(sectionId);
+            SlotId index = section->start() == node->id() ? 0 : 1;
+            m_sectionNodes[2 * s + index] = n;
+            m_sectionSlots[2 * s + index] = static_cast<std::uint8_t>(slot);
+        }
+
+        if (m_slotSections.size() >= NONE) {
+            throw std::length_error("too many slots to compile");
+        }
+        m_slotBegin.push_back(static_cast<Index>(m_slotSections.size()));
+    }
+}
+
+Index CompiledModel::nodeIndex(IdRef id) const { return find(m_nodeIndex, id); }
+
+Index CompiledModel::sectionIndex(IdRef id) const {
+    return find(m_sectionIndex, id);
+}
+
+Index CompiledModel::destinationIndex(std::string_view address) const {
+    return find(m_destIndex, address);
+}
+
+} // namespace piwcs::prw
@@ -0,0 +1,53 @@
+#include <piwcsprwmodel/idpool.h>
+
+#include "memory.h"
+#include <stdexcept>
+
+namespace piwcs::prw::detail {
+
+IdPool::Handle IdPool::intern(IdRef id) {
+    if (id == ID_NULL) {
+        return NULL_HANDLE;
+    }
+
+    auto it = m_index.find(id);
+    if (it != m_index.end()) {
+        return it->second;
+    }
+
+    Handle handle{};
+    IdRef stored;
+
+    if (InlineId::fits(id)) {
+        if (m_short.size() >= LONG_FLAG - 1) {
+            throw std::length_error("too many identifiers");
+        }
+        stored = m_short.emplace_back(id).view();
+        handle = static_cast<Handle>(m_short.size());
+    } else {
+        if (m_long.size() >= LONG_FLAG - 1) {
+            throw std::length_error("too many identifiers");
+        }
+        stored = m_long.emplace_back(id);
+        handle = static_cast<Handle>(m_long.size()) | LONG_FLAG;
+    }
+
+    m_index.emplace(stored, handle);
+    return handle;
+}
+
+IdPool::Handle IdPool::find(IdRef id) const {
+    auto it = m_index.find(id);
+    return it == m_index.end() ? NULL_HANDLE : it->second;
+}
+
+std::size_t IdPool::memoryUsage() const {
+    std::size_t result = heapBytes(m_short) + heapBytes(m_long) +
+                         m_index.allocated_bytes();
+    for (const auto &id : m_long) {
+        result += heapBytes(id);
+    }
+    return result;
+}
+
+} // namespace piwcs::prw::detail
@@ -0,0 +1,451 @@
+#include <piwcsprwmodel/io.h>
+#include <piwcsprwmodel/builder.h>
+
+#include "binaryformat.h"
+#include "debug.h"
+#include "mappedfile.h"
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Snapshot layout. All integers use the byte order of the writing machine,
+ * which is recorded in the header; readers reject foreign byte orders.
+ *
+ *   Header
+ *   StringRecord[stringCount]    offsets into the character data
+ *   NodeRecord[nodeCount]
+ *   SectionRecord[sectionCount]
+ *   MetadataRecord[metadataCount]
+ *   char[]                       character data, up to the end of the file
+ *
+ * Every record size is a multiple of 8, so all records are naturally aligned
+ * when the snapshot starts at an aligned address, such as a memory mapping.
+ * Strings are referenced by index into the string table and are deduplicated.
+ * Metadata of each object is a contiguous run of MetadataRecords.
+ *
+ * Records are decoded in place, but the reader copies all strings into the
+ * Model it builds: Nodes and Sections own their IDs, so the Model cannot
+ * refer to the snapshot.
+ */
+
+namespace piwcs::prw {
+
+namespace {
+
+constexpr std::string_view MAGIC = "PIWCSPRW";
+constexpr std::uint32_t FORMAT_VERSION = 3;
+
+struct Header {
+    char magic[8];
+    std::uint32_t byteOrder;
+    std::uint32_t version;
+    std::uint64_t fileSize;
+
+    /*
+     * Checksum of the entire file with this field set to zero.
+     */
+    std::uint64_t checksum;
+
+    std::uint32_t stringCount;
+    std::uint32_t nodeCount;
+    std::uint32_t sectionCount;
+    std::uint32_t metadataCount;
+
+    std::uint64_t stringsOffset;
+    std::uint64_t nodesOffset;
+    std::uint64_t sectionsOffset;
+    std::uint64_t metadataOffset;
+    std::uint64_t charsOffset;
+};
+
+struct StringRecord {
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+
+struct MetadataRange {
+    std::uint32_t begin;
+    std::uint32_t count;
+};
+
+struct NodeRecord {
+    std::uint32_t id;
+    std::uint32_t type;
+    MetadataRange metadata;
+};
+
+struct SectionRecord {
+    static constexpr std::uint8_t LINKED = 1;
+    static constexpr std::uint8_t DESTINATION = 2;
+
+    std::uint32_t id;
+    std::uint8_t dir;
+    std::uint8_t flags;
+    std::uint8_t startSlot;
+    std::uint8_t endSlot;
+    std::uint32_t startNode;
+    std::uint32_t endNode;
+    MetadataRange metadata;
+    std::uint32_t destAddress;
+    std::uint32_t destName;
+    MetadataRange destMetadata;
+
+    /*
+     * Bit patterns of the float attributes; floats themselves may have
+     * several representations of the same value.
+     */
+    std::uint32_t length;
+    std::uint32_t costMultiplier;
+};
+
+struct MetadataRecord {
+    std::uint32_t key;
+    std::uint32_t value;
+};
+
+template <typename T> constexpr bool isRecord() {
+    // Records must not have padding bytes that would be written uninitialized
+    return std::is_trivially_copyable_v<T> &&
+           std::has_unique_object_representations_v<T> && sizeof(T) % 8 == 0;
+}
+
+static_assert(isRecord<Header>());
+
+/*
+ * Computes the checksum of a snapshot as if its checksum field were zero. The
+ * header size is a multiple of 8, so the checksum of the header seeds the
+ * checksum of the rest.
+ */
+std::uint64_t snapshotChecksum(std::string_view data) {
+    Header h{};
+    std::memcpy(&h, data.data(), sizeof(Header));
+    h.checksum = 0;
+
+    std::string_view header(reinterpret_cast<const char *>(&h), // NOLINT
+                            sizeof(Header));
+    return detail::checksum(data.substr(sizeof(Header)),
+                            detail::checksum(header));
+}
+static_assert(isRecord<StringRecord>());
+static_assert(isRecord<NodeRecord>());
+static_assert(isRecord<SectionRecord>());
+static_assert(isRecord<MetadataRecord>());
+
+template <typename T>
+void appendAll(std::string &out, const std::vector<T> &values) {
+    out.append(reinterpret_cast<const char *>(values.data()), // NOLINT
+               values.size() * sizeof(T));
+}
+
+template <typename T> std::uint32_t narrow(T count) {
+    if (count > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::length_error("model too large for a binary snapshot");
+    }
+    return static_cast<std::uint32_t>(count);
+}
+
+class SnapshotWriter {
+
+    detail::FlatMap<IdRef, std::uint32_t, IdHash, std::equal_to<>>
+        m_stringIndex;
+    std::vector<StringRecord> m_strings;
+    std::string m_chars;
+    std::vector<NodeRecord> m_nodes;
+    std::vector<SectionRecord> m_sections;
+    std::vector<MetadataRecord> m_metadata;
+
+    /*
+     * Returns the index of the string, adding it to the table if necessary.
+     * The string must outlive the writer.
+     */
+    std::uint32_t string(std::string_view str) {
+        auto [it, inserted] = m_stringIndex.try_emplace(
+            str, narrow(m_strings.size()));
+        if (inserted) {
+            m_strings.push_back({narrow(m_chars.size()), narrow(str.size())});
+            m_chars.append(str);
+        }
+        return it->second;
+    }
+
+    MetadataRange metadata(const detail::HasMetadata &obj) {
+        MetadataRange range{narrow(m_metadata.size()), 0};
+        if (!obj.hasMetadata()) {
+            return range;
+        }
+
+        for (const auto &[key, value] : obj.metadata()) {
+            m_metadata.push_back({string(key), string(value)});
+        }
+        range.count = narrow(m_metadata.size() - range.begin);
+        return range;
+    }
+
+    void addNode(const Node &node) {
+        m_nodes.push_back({string(node.id()),
+                           detail::nodeTypeCode(node.type()), metadata(node)});
+    }
+
+    void addSection(const Section &section) {
+        SectionRecord r{};
+        r.id = string(section.id());
+        r.dir = static_cast<std::uint8_t>(section.dir());
+        r.metadata = metadata(section);
+        r.length = std::bit_cast<std::uint32_t>(section.length());
+        r.costMultiplier =
+            std::bit_cast<std::uint32_t>(section.costMultiplier());
+
+        if (section.isConnected()) {
+            r.flags |= SectionRecord::LINKED;
+            r.startNode = string(section.start());
+            r.endNode = string(section.end());
+            r.startSlot = static_cast<std::uint8_t>(section.startSlot());
+            r.endSlot = static_cast<std::uint8_t>(section.endSlot());
+        }
+
+        if (section.isDestination()) {
+            const auto &dest = *section.destination();
+            r.flags |= SectionRecord::DESTINATION;
+            r.destAddress = string(dest.address());
+            r.destName = string(dest.name());
+            r.destMetadata = metadata(dest);
+        }
+
+        m_sections.push_back(r);
+    }
+
+  public:
+    explicit SnapshotWriter(const Model &model) {
+        m_nodes.reserve(model.nodes().size());
+        m_sections.reserve(model.sections().size());
+        m_stringIndex.reserve(model.nodes().size() + model.sections().size());
+
+        for (const auto &[id, node] : model.nodes()) {
+            addNode(node);
+        }
+        for (const auto &[id, section] : model.sections()) {
+            addSection(section);
+        }
+    }
+
+    std::string finish() const {
+        Header h{};
+        std::memcpy(h.magic, MAGIC.data(), sizeof(h.magic));
+        h.byteOrder = detail::ENDIAN_MARK;
+        h.version = FORMAT_VERSION;
+
+        h.stringCount = narrow(m_strings.size());
+        h.nodeCount = narrow(m_nodes.size());
+        h.sectionCount = narrow(m_sections.size());
+        h.metadataCount = narrow(m_metadata.size());
+
+        h.stringsOffset = sizeof(Header);
+        h.nodesOffset = h.stringsOffset + sizeof(StringRecord) * h.stringCount;
+        h.sectionsOffset = h.nodesOffset + sizeof(NodeRecord) * h.nodeCount;
+        h.metadataOffset =
+            h.sectionsOffset + sizeof(SectionRecord) * h.sectionCount;
+        h.charsOffset =
+            h.metadataOffset + sizeof(MetadataRecord) * h.metadataCount;
+        h.fileSize = h.charsOffset + m_chars.size();
+
+        std::string out;
+        out.reserve(h.fileSize);
+        detail::append(out, h);
+        appendAll(out, m_strings);
+        appendAll(out, m_nodes);
+        appendAll(out, m_sections);
+        appendAll(out, m_metadata);
+        out.append(m_chars);
+        _ASSERT(out.size() == h.fileSize, "size mismatch");
+
+        h.checksum = snapshotChecksum(out);
+        std::memcpy(out.data() + offsetof(Header, checksum), &h.checksum,
+                    sizeof(h.checksum));
+
+        return out;
+    }
+};
+
+class SnapshotReader {
+
+    std::string_view m_data;
+    Header m_header{};
+
+    // Identical metadata is stored once
+    MetadataTable m_metadata;
+
+    template <typename T>
+    T record(std::uint64_t offset, std::uint32_t index) const {
+        T result;
+        std::memcpy(&result, m_data.data() + offset + index * sizeof(T),
+                    sizeof(T));
+        return result;
+    }
+
+    void checkRegion(std::uint64_t offset, std::uint64_t count,
+                     std::size_t size) const {
+        // count < 2^32 and size is small, so this cannot overflow
+        if (offset % 8 != 0 || offset > m_data.size() ||
+            count * size > m_data.size() - offset) {
+            throw InvalidFormatError("snapshot region out of bounds");
+        }
+    }
+
+    std::string_view string(std::uint32_t index) const {
+        if (index >= m_header.stringCount) {
+            throw InvalidFormatError("snapshot string index out of bounds");
+        }
+
+        auto r = record<StringRecord>(m_header.stringsOffset, index);
+        std::string_view chars = m_data.substr(m_header.charsOffset);
+        if (r.offset > chars.size() || r.length > chars.size() - r.offset) {
+            throw InvalidFormatError("snapshot string out of bounds");
+        }
+        return chars.substr(r.offset, r.length);
+    }
+
+    void installMetadata(detail::HasMetadata &target, MetadataRange range) {
+        if (range.count == 0) {
+            return;
+        }
+        if (range.begin > m_header.metadataCount ||
+            range.count > m_header.metadataCount - range.begin) {
+            throw InvalidFormatError("snapshot metadata out of bounds");
+        }
+
+        Metadata metadata;
+        metadata.reserve(range.count);
+        for (std::uint32_t i = 0; i < range.count; i++) {
+            auto r = record<MetadataRecord>(m_header.metadataOffset,
+                                            range.begin + i);
+            metadata[string(r.key)] = string(r.value);
+        }
+        m_metadata.assign(target, std::move(metadata));
+    }
+
+    void readNode(ModelBuilder &builder, std::uint32_t index) {
+        auto r = record<NodeRecord>(m_header.nodesOffset, index);
+        if (r.type >= detail::NODE_TYPE_COUNT) {
+            throw InvalidFormatError("unknown node type in snapshot");
+        }
+
+        Node node(detail::nodeTypes()[r.type], Identifier(string(r.id)));
+        installMetadata(node, r.metadata);
+        builder.addNode(std::move(node));
+    }
+
+    void readSection(ModelBuilder &builder, std::uint32_t index) {
+        auto r = record<SectionRecord>(m_header.sectionsOffset, index);
+        if (r.dir > static_cast<std::uint8_t>(Section::AllowedTravel::BIDIR)) {
+            throw InvalidFormatError("unknown directionality in snapshot");
+        }
+
+        std::unique_ptr<Destination> dest;
+        if ((r.flags & SectionRecord::DESTINATION) != 0) {
+            dest = std::make_unique<Destination>(
+                Destination::Address(string(r.destAddress)),
+                Destination::Name(string(r.destName)));
+            installMetadata(*dest, r.destMetadata);
+        }
+
+        IdRef id = string(r.id);
+        Section section(Identifier(id),
+                        static_cast<Section::AllowedTravel>(r.dir),
+                        std::move(dest));
+        float length = std::bit_cast<float>(r.length);
+        float costMultiplier = std::bit_cast<float>(r.costMultiplier);
+        if (!section.setLength(length) ||
+            !section.setCostMultiplier(costMultiplier)) {
+            throw InvalidFormatError("invalid section length or cost");
+        }
+        installMetadata(section, r.metadata);
+        builder.addSection(std::move(section));
+
+        if ((r.flags & SectionRecord::LINKED) != 0) {
+            builder.link(id, string(r.startNode), r.startSlot,
+                         string(r.endNode), r.endSlot);
+        }
+    }
+
+  public:
+    explicit SnapshotReader(std::string_view data) : m_data(data) {
+        if (data.size() < sizeof(Header)) {
+            throw InvalidFormatError("snapshot too short");
+        }
+        std::memcpy(&m_header, data.data(), sizeof(Header));
+        const Header &h = m_header;
+
+        if (MAGIC != std::string_view(h.magic, sizeof(h.magic))) {
+            throw InvalidFormatError("not a PRW model snapshot");
+        }
+        if (h.byteOrder != detail::ENDIAN_MARK) {
+            throw InvalidFormatError("snapshot byte order mismatch");
+        }
+        if (h.version != FORMAT_VERSION) {
+            throw InvalidFormatError("unsupported snapshot version");
+        }
+        if (h.fileSize != data.size()) {
+            throw InvalidFormatError("snapshot size mismatch");
+        }
+        if (h.checksum != snapshotChecksum(data)) {
+            throw InvalidFormatError("snapshot checksum mismatch");
+        }
+
+        checkRegion(h.stringsOffset, h.stringCount, sizeof(StringRecord));
+        checkRegion(h.nodesOffset, h.nodeCount, sizeof(NodeRecord));
+        checkRegion(h.sectionsOffset, h.sectionCount, sizeof(SectionRecord));
+        checkRegion(h.metadataOffset, h.metadataCount,
+                    sizeof(MetadataRecord));
+        checkRegion(h.charsOffset, 0, 1);
+    }
+
+    Model read() {
+        ModelBuilder builder;
+        builder.reserve(m_header.nodeCount, m_header.sectionCount);
+
+        for (std::uint32_t i = 0; i < m_header.nodeCount; i++) {
+            readNode(builder, i);
+        }
+        for (std::uint32_t i = 0; i < m_header.sectionCount; i++) {
+            readSection(builder, i);
+        }
+
+        return builder.build();
+    }
+};
+
+} // namespace
+
+Model readModelBinary(std::istream &in) {
+    std::string data(std::istreambuf_iterator<char>(in), {});
+    if (in.bad()) {
+        throw std::ios_base::failure("could not read snapshot");
+    }
+    return SnapshotReader(data).read();
+}
+
+Model readModelBinary(const std::string &filename) {
+    detail::MappedFile file(filename);
+    return SnapshotReader(file.view()).read();
+}
+
+void writeModelBinary(std::ostream &out, const Model &model) {
+    std::string data = SnapshotWriter(model).finish();
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+void writeModelBinary(const std::string &filename, const Model &model) {
+    std::ofstream out(filename, std::ios_base::binary);
+    out.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+    writeModelBinary(out, model);
+}
+
+} // namespace piwcs::prw
@@ -1,11 +1,16 @@
 #include <piwcsprwmodel/io.h>
+#include <piwcsprwmodel/builder.h>
 
-#include "nodetypeinfo.h"
+#include "mappedfile.h"
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <minijson_reader/minijson_reader.hpp>
 #include <optional>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 namespace piwcs::prw {
 
@@ -22,19 +27,23 @@ struct MetadataData {
     std::optional<Metadata> metadata;
 };
 
-void parseMetadata(MetadataData &md, value, minijson::istream_context &ctx) {
+/*
+ * Handlers that consume nested values take the parse context as their last
+ * argument. They are generic lambdas so that the same dispatchers serve every
+ * minijson context type.
+ */
+
+const auto parseMetadata = [](MetadataData &md, value, auto &ctx) {
     minijson::parse_object(ctx, [&](std::string_view key, value v) {
         if (!md.metadata) {
             md.metadata.emplace();
         }
-        (*md.metadata)[Identifier(key)] = v.as<std::string_view>();
+        (*md.metadata)[key] = v.as<std::string_view>();
     });
-}
+};
 
-void installMetadata(detail::HasMetadata &target, MetadataData &source) {
-    if (source.metadata) {
-        target.metadata() = std::move(*source.metadata);
-    }
+Metadata *metadataOf(MetadataData &data) {
+    return data.metadata ? &*data.metadata : nullptr;
 }
 
 struct NodeData : public MetadataData {
@@ -68,18 +77,13 @@ const minijson::dispatcher nodeDispatcher{
     optional_handler("metadata", parseMetadata),
 };
 
-void parseNode(minijson::istream_context &ctx, Model &model,
-               Identifier nodeId) {
+template <typename Context>
+void parseNode(Context &ctx, ModelVisitor &visitor, IdRef nodeId) {
     NodeData data;
 
     nodeDispatcher.run(ctx, data);
 
-    Node node(data.type, std::move(nodeId));
-    installMetadata(node, data);
-
-    if (!model.addNode(std::move(node))) {
-        throw IllegalModelError("duplicate node ID");
-    }
+    visitor.node({nodeId, data.type, metadataOf(data)});
 }
 
 struct Link {
@@ -97,7 +101,9 @@ struct DestData : public MetadataData {
 struct SectionData : public MetadataData {
     Link link{};
     Section::AllowedTravel dir = Section::AllowedTravel::UNIDIR;
-    std::unique_ptr<Destination> dest{};
+    std::optional<DestData> dest{};
+    float length = Section::DEFAULT_LENGTH;
+    float costMultiplier = Section::DEFAULT_COST_MULTIPLIER;
 };
 
 const minijson::dispatcher linkDispatcher{
@@ -107,9 +113,9 @@ const minijson::dispatcher linkDispatcher{
     handler("endSlot", into(&Link::endSlot)),
 };
 
-void parseLink(SectionData &s, value, minijson::istream_context &ctx) {
+const auto parseLink = [](SectionData &s, value, auto &ctx) {
     linkDispatcher.run(ctx, s.link);
-}
+};
 
 const minijson::dispatcher destDispatcher{
     handler("address", into(&DestData::address)),
@@ -117,57 +123,55 @@ const minijson::dispatcher destDispatcher{
     optional_handler("metadata", parseMetadata),
 };
 
-void parseDest(SectionData &s, value, minijson::istream_context &ctx) {
-    DestData data;
-    destDispatcher.run(ctx, data);
-    auto d = std::make_unique<Destination>(Destination::Address(data.address),
-                                           Destination::Name(data.name));
-    installMetadata(*d, data);
-    s.dest = std::move(d);
-}
+const auto parseDest = [](SectionData &s, value, auto &ctx) {
+    destDispatcher.run(ctx, s.dest.emplace());
+};
 
 const minijson::dispatcher sectionDispatcher{
     optional_handler("link", parseLink),
     optional_handler("dir", into(&SectionData::dir)),
     optional_handler("dest", parseDest),
     optional_handler("metadata", parseMetadata),
+    optional_handler("length", into(&SectionData::length)),
+    optional_handler("costMultiplier", into(&SectionData::costMultiplier)),
 };
 
-void parseSection(minijson::istream_context &ctx, Model &model,
-                  const Identifier &sectionId) {
+template <typename Context>
+void parseSection(Context &ctx, ModelVisitor &visitor, IdRef sectionId) {
     SectionData data;
 
     sectionDispatcher.run(ctx, data);
 
-    Section section(sectionId, data.dir, std::move(data.dest));
-    installMetadata(section, data);
-
-    if (!model.addSection(std::move(section))) {
-        throw IllegalModelError("duplicate section ID or destination address");
+    if (data.dest) {
+        auto &d = *data.dest;
+        visitor.destination({sectionId, d.address, d.name, metadataOf(d)});
     }
 
+    visitor.section({sectionId, data.dir, data.dest.has_value(),
+                     metadataOf(data), data.length, data.costMultiplier});
+
     if (data.link.startNode) {
         const auto &l = data.link;
-        if (!model.link(sectionId, *l.startNode, *l.startSlot, *l.endNode,
-                        *l.endSlot)) {
-            throw IllegalModelError("linkage inconsistency found");
-        }
+        visitor.link(
+            {sectionId, *l.startNode, *l.startSlot, *l.endNode, *l.endSlot});
     }
 }
 
-void parseMain(minijson::istream_context &ctx, Model &model) {
+template <typename Context>
+void parseMain(Context &ctx, ModelVisitor &visitor) {
     int part = 0;
 
     minijson::parse_array(ctx, [&](value) {
         switch (part) {
         case 0:
             minijson::parse_object(ctx, [&](std::string_view name, value) {
-                parseNode(ctx, model, Identifier(name));
+                // Keep the ID, the context may reuse its storage
+                parseNode(ctx, visitor, Identifier(name));
             });
             break;
         case 1:
             minijson::parse_object(ctx, [&](std::string_view name, value) {
-                parseSection(ctx, model, Identifier(name));
+                parseSection(ctx, visitor, Identifier(name));
             });
             break;
         default:
@@ -189,14 +193,9 @@ template <typename S> [[noreturn]] void wrap_exception(const char *lhs, S rhs) {
     throw InvalidFormatError(msg.str());
 }
 
-} // namespace
-
-Model readModel(std::istream &in) {
-    Model model;
-    minijson::istream_context ctx(in);
-
+template <typename Context> void parse(Context &ctx, ModelVisitor &visitor) {
     try {
-        parseMain(ctx, model);
+        parseMain(ctx, visitor);
     } catch (const minijson::parse_error &e) {
         wrap_exception("JSON parse error", e.what());
     } catch (const minijson::bad_value_cast &e) {
@@ -206,8 +205,393 @@ Model readModel(std::istream &in) {
     } catch (const minijson::missing_field_error &e) {
         wrap_exception("field not found", e.field_name_truncated());
     }
+}
+
+/*
+ * Turns parsed records into Nodes and Sections. Subclasses decide what happens
+ * to them and to links.
+ */
+class EntityBuilder : public ModelVisitor {
+
+    std::unique_ptr<Destination> m_dest;
+
+    // Identical metadata is stored once
+    MetadataTable m_metadata;
+
+    void installMetadata(detail::HasMetadata &target, Metadata *source) {
+        if (source != nullptr) {
+            m_metadata.assign(target, std::move(*source));
+        }
+    }
+
+  protected:
+    virtual void add(Node &&node) = 0;
+    virtual void add(Section &&section) = 0;
+
+  public:
+    void node(const NodeRecord &r) final {
+        Node node(r.type, Identifier(r.id));
+        installMetadata(node, r.metadata);
+        add(std::move(node));
+    }
+
+    void destination(const DestinationRecord &r) final {
+        m_dest = std::make_unique<Destination>(Destination::Address(r.address),
+                                               Destination::Name(r.name));
+        installMetadata(*m_dest, r.metadata);
+    }
+
+    void section(const SectionRecord &r) final {
+        Section section(Identifier(r.id), r.dir, std::move(m_dest));
+        if (!section.setLength(r.length) ||
+            !section.setCostMultiplier(r.costMultiplier)) {
+            throw InvalidFormatError("invalid section length or cost");
+        }
+        installMetadata(section, r.metadata);
+        add(std::move(section));
+    }
+};
+
+/*
+ * Builds a Model from parsed records. The Model is validated once the entire
+ * definition has been parsed.
+ */
+class ModelReader : public EntityBuilder {
+
+    ModelBuilder m_builder;
+
+  protected:
+    void add(Node &&node) override { m_builder.addNode(std::move(node)); }
+
+    void add(Section &&section) override {
+        m_builder.addSection(std::move(section));
+    }
+
+  public:
+    void link(const LinkRecord &r) override {
+        m_builder.link(r.section, r.startNode, r.startSlot, r.endNode,
+                       r.endSlot);
+    }
+
+    Model finish() { return m_builder.build(); }
+};
+
+template <typename Context> Model parseModel(Context &ctx) {
+    ModelReader reader;
+    parse(ctx, reader);
+    return reader.finish();
+}
+
+/*
+ * Parallel parsing.
+ *
+ * A structural scan locates the key and value of every node and section
+ * without decoding them. Runs of consecutive entities are then parsed
+ * concurrently into Nodes and Sections, which are finally added to the Model
+ * in file order on the calling thread. Any problem makes the reader fall back
+ * to the sequential parser so that errors are reported identically.
+ */
+
+/*
+ * A member of the node or section object of a definition.
+ */
+struct Entity {
+    std::string_view key;
+    std::string_view value;
+};
+
+/*
+ * Checks the overall shape of a definition and collects its entities. Only
+ * structure is checked; values are validated when they are parsed.
+ */
+class StructureScanner {
+
+    std::string_view m_data;
+    std::size_t m_pos = 0;
+
+    void skipSpace() {
+        while (m_pos < m_data.size() &&
+               (m_data[m_pos] == ' ' || m_data[m_pos] == '\n' ||
+                m_data[m_pos] == '\r' || m_data[m_pos] == '\t')) {
+            m_pos++;
+        }
+    }
+
+    bool expect(char c) {
+        skipSpace();
+        if (m_pos < m_data.size() && m_data[m_pos] == c) {
+            m_pos++;
+            return true;
+        }
+        return false;
+    }
+
+    /*
+     * Skips a string whose opening quote has been consumed. Sets escaped if
+     * the string contains escape sequences.
+     */
+    bool skipString(bool &escaped) {
+        while (m_pos < m_data.size()) {
+            char c = m_data[m_pos++];
+            if (c == '"') {
+                return true;
+            }
+            if (c == '\\') {
+                escaped = true;
+                m_pos++;
+            }
+        }
+        return false;
+    }
+
+    bool skipValue() {
+        skipSpace();
+        if (m_pos >= m_data.size()) {
+            return false;
+        }
+
+        bool escaped = false;
+        char first = m_data[m_pos];
+
+        if (first == '"') {
+            m_pos++;
+            return skipString(escaped);
+        }
+
+        if (first != '{' && first != '[') {
+            while (m_pos < m_data.size() && m_data[m_pos] != ',' &&
+                   m_data[m_pos] != '}' && m_data[m_pos] != ']') {
+                m_pos++;
+            }
+            return true;
+        }
+
+        std::size_t depth = 0;
+        while (m_pos < m_data.size()) {
+            char c = m_data[m_pos++];
+            if (c == '"') {
+                if (!skipString(escaped)) {
+                    return false;
+                }
+            } else if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool scanObject(std::vector<Entity> &entities) {
+        if (!expect('{')) {
+            return false;
+        }
+        if (expect('}')) {
+            return true;
+        }
+
+        do {
+            if (!expect('"')) {
+                return false;
+            }
+            std::size_t keyBegin = m_pos;
+            bool escaped = false;
+            if (!skipString(escaped) || escaped) {
+                // Keys with escapes are left to the sequential parser
+                return false;
+            }
+            auto key = m_data.substr(keyBegin, m_pos - 1 - keyBegin);
+
+            if (!expect(':')) {
+                return false;
+            }
+            skipSpace();
+            std::size_t valueBegin = m_pos;
+            if (!skipValue()) {
+                return false;
+            }
+            entities.push_back(
+                {key, m_data.substr(valueBegin, m_pos - valueBegin)});
+        } while (expect(','));
+
+        return expect('}');
+    }
+
+  public:
+    explicit StructureScanner(std::string_view data) : m_data(data) {}
+
+    bool scan(std::vector<Entity> &nodes, std::vector<Entity> &sections) {
+        if (!expect('[') || !scanObject(nodes) || !expect(',') ||
+            !scanObject(sections) || !expect(']')) {
+            return false;
+        }
+        skipSpace();
+        return m_pos == m_data.size();
+    }
+};
+
+/*
+ * Collects the Nodes, Sections and links of a run of entities.
+ */
+class ChunkReader : public EntityBuilder {
+
+    struct LinkData {
+        Identifier section;
+        Identifier startNode;
+        SlotId startSlot;
+        Identifier endNode;
+        SlotId endSlot;
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<Section> m_sections;
+
+    /*
+     * The link of each Section in m_sections, if any.
+     */
+    std::vector<std::optional<LinkData>> m_links;
+
+  protected:
+    void add(Node &&node) override { m_nodes.push_back(std::move(node)); }
+
+    void add(Section &&section) override {
+        m_sections.push_back(std::move(section));
+        m_links.emplace_back();
+    }
+
+  public:
+    void link(const LinkRecord &r) override {
+        m_links.back() = {Identifier(r.section), Identifier(r.startNode),
+                          r.startSlot, Identifier(r.endNode), r.endSlot};
+    }
+
+    /*
+     * Parses a run of entities. Values are copied into scratch so that they
+     * can be unescaped in place.
+     */
+    void read(const std::vector<Entity> &entities, std::size_t begin,
+              std::size_t end, bool sections) {
+        const char *base = entities[begin].value.data();
+        const char *last = entities[end - 1].value.data();
+        std::string scratch(base, last + entities[end - 1].value.size());
+
+        for (std::size_t i = begin; i < end; i++) {
+            const Entity &e = entities[i];
+            char *value = scratch.data() + (e.value.data() - base);
+            minijson::buffer_context ctx(value, e.value.size());
+            if (sections) {
+                parseSection(ctx, *this, e.key);
+            } else {
+                parseNode(ctx, *this, e.key);
+            }
+        }
+    }
+
+    void mergeInto(ModelBuilder &builder) {
+        for (auto &node : m_nodes) {
+            builder.addNode(std::move(node));
+        }
+
+        for (std::size_t i = 0; i < m_sections.size(); i++) {
+            builder.addSection(std::move(m_sections[i]));
+            if (const auto &l = m_links[i]) {
+                builder.link(l->section, l->startNode, l->startSlot,
+                             l->endNode, l->endSlot);
+            }
+        }
+    }
+};
+
+/*
+ * Smallest number of entities worth handing to a thread.
+ */
+constexpr std::size_t MIN_CHUNK = 256;
+
+Model parseParallel(const std::vector<Entity> &nodes,
+                    const std::vector<Entity> &sections, unsigned threads) {
+    struct Chunk {
+        const std::vector<Entity> *entities;
+        std::size_t begin;
+        std::size_t end;
+        ChunkReader reader;
+    };
+
+    std::size_t total = nodes.size() + sections.size();
+    std::size_t chunkSize = std::max(MIN_CHUNK, total / (threads * 8) + 1);
+
+    std::vector<Chunk> chunks;
+    for (const auto *entities : {&nodes, &sections}) {
+        for (std::size_t i = 0; i < entities->size(); i += chunkSize) {
+            chunks.push_back(
+                {entities, i, std::min(i + chunkSize, entities->size()), {}});
+        }
+    }
+
+    threads = static_cast<unsigned>(
+        std::min(static_cast<std::size_t>(threads), chunks.size()));
+
+    std::atomic<std::size_t> nextChunk = 0;
+    std::atomic<bool> failed = false;
+
+    auto work = [&]() {
+        try {
+            for (std::size_t i = nextChunk++; i < chunks.size();
+                 i = nextChunk++) {
+                Chunk &c = chunks[i];
+                c.reader.read(*c.entities, c.begin, c.end,
+                              c.entities == &sections);
+            }
+        } catch (...) {
+            failed = true;
+            nextChunk = chunks.size();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    if (failed) {
+        throw InvalidFormatError("parallel parse failed");
+    }
+
+    ModelBuilder builder;
+    builder.reserve(nodes.size(), sections.size());
+    for (auto &chunk : chunks) {
+        chunk.reader.mergeInto(builder);
+    }
+    return builder.build();
+}
+
+} // namespace
+
+void visitModel(std::istream &in, ModelVisitor &visitor) {
+    minijson::istream_context ctx(in);
+    parse(ctx, visitor);
+}
+
+void visitModel(const std::string &filename, ModelVisitor &visitor) {
+    std::ifstream in(filename);
+    in.exceptions(std::ios_base::failbit); // throws if the file failed to open
+    visitModel(in, visitor);
+}
+
+void visitModelBuffer(std::string_view buffer, ModelVisitor &visitor) {
+    // The context allocates a single scratch buffer for unescaped strings
+    minijson::const_buffer_context ctx(buffer.data(), buffer.size());
+    parse(ctx, visitor);
+}
 
-    return std::move(model);
+Model readModel(std::istream &in) {
+    minijson::istream_context ctx(in);
+    return parseModel(ctx);
 }
 
 Model readModel(const std::string &filename) {
@@ -216,6 +600,40 @@ Model readModel(const std::string &filename) {
     return readModel(in);
 }
 
+Model readModelBuffer(std::string_view buffer) {
+    // The context allocates a single scratch buffer for unescaped strings
+    minijson::const_buffer_context ctx(buffer.data(), buffer.size());
+    return parseModel(ctx);
+}
+
+Model readModelParallel(std::string_view buffer, unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+
+    std::vector<Entity> nodes;
+    std::vector<Entity> sections;
+    if (StructureScanner(buffer).scan(nodes, sections)) {
+        try {
+            return parseParallel(nodes, sections, threads);
+        } catch (const std::bad_alloc &) {
+            throw;
+        } catch (...) {
+            // Report the error exactly like the sequential parser would
+        }
+    }
+
+    return readModelBuffer(buffer);
+}
+
+Model readModelMapped(const std::string &filename) {
+    // Strings are unescaped in place; modified pages stay private
+    using Access = detail::MappedFile::Access;
+    detail::MappedFile file(filename, Access::COPY_ON_WRITE);
+    minijson::buffer_context ctx(file.data(), file.size());
+    return parseModel(ctx);
+}
+
 } // namespace piwcs::prw
 
 namespace minijson {
@@ -1,15 +1,45 @@
 #include <piwcsprwmodel/io.h>
 
 #include "debug.h"
-#include "nodetypeinfo.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <minijson_writer/minijson_writer.hpp>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if __has_include(<unistd.h>)
+#define PIWCS_PRW_HAVE_UNISTD
+#include <unistd.h>
+#endif
 
 namespace piwcs::prw {
 
 namespace {
 
+const char *dirName(Section::AllowedTravel dir) {
+    switch (dir) {
+    case Section::AllowedTravel::NONE:
+        return "NONE";
+    case Section::AllowedTravel::UNIDIR:
+        return "UNIDIR";
+    case Section::AllowedTravel::BIDIR:
+        return "BIDIR";
+    }
+    _FAIL("unknown directionality");
+    return nullptr;
+}
+
 void writeMetadata(minijson::object_writer &pw,
                    const detail::HasMetadata &obj) {
     if (!obj.hasMetadata()) {
@@ -35,28 +65,16 @@ void writeNodes(minijson::array_writer &pw, const Model &model) {
     }
 }
 
-void writeLink(minijson::object_writer &pw, const Section &section,
-               const Model &model) {
+void writeLink(minijson::object_writer &pw, const Section &section) {
     if (!section.isConnected()) {
         return;
     }
 
     auto w = pw.nested_object("link");
-
-    const Node *start = model.node(section.start());
-    const Node *end = model.node(section.end());
-    _ASSERT(start != nullptr, "start not found");
-    _ASSERT(end != nullptr, "end not found");
-
-    SlotId startSlot = start->slotOf(section.id());
-    SlotId endSlot = end->slotOf(section.id());
-    _ASSERT(startSlot != SLOT_INVALID, "start slot not found");
-    _ASSERT(endSlot != SLOT_INVALID, "end slot not found");
-
     w.write("startNode", section.start());
-    w.write("startSlot", startSlot);
+    w.write("startSlot", section.startSlot());
     w.write("endNode", section.end());
-    w.write("endSlot", endSlot);
+    w.write("endSlot", section.endSlot());
 }
 
 void writeDestination(minijson::object_writer &pw, const Section &section) {
@@ -73,24 +91,20 @@ void writeDestination(minijson::object_writer &pw, const Section &section) {
 }
 
 void writeSection(minijson::object_writer &pw, const Section &section,
-                  const char *id, const Model &model) {
+                  const char *id) {
     auto w = pw.nested_object(id); // TODO s/id/section.id()/
 
-    writeLink(w, section, model);
+    writeLink(w, section);
 
-    const char *dirName{};
-    switch (section.dir()) {
-    case Section::AllowedTravel::NONE:
-        dirName = "NONE";
-        break;
-    case Section::AllowedTravel::UNIDIR:
-        dirName = "UNIDIR";
-        break;
-    case Section::AllowedTravel::BIDIR:
-        dirName = "BIDIR";
-        break;
+    w.write("dir", dirName(section.dir()));
+
+    // Default attributes are omitted to keep existing documents unchanged
+    if (section.length() != Section::DEFAULT_LENGTH) {
+        w.write("length", section.length());
+    }
+    if (section.costMultiplier() != Section::DEFAULT_COST_MULTIPLIER) {
+        w.write("costMultiplier", section.costMultiplier());
     }
-    w.write("dir", dirName);
 
     writeDestination(w, section);
     writeMetadata(w, section);
@@ -99,13 +113,383 @@ void writeSection(minijson::object_writer &pw, const Section &section,
 void writeSections(minijson::array_writer &pw, const Model &model) {
     auto w = pw.nested_object();
     for (const auto &[sectionId, section] : model.sections()) {
-        writeSection(w, section, sectionId.c_str(), model);
+        writeSection(w, section, sectionId.c_str());
     }
 }
 
-} // namespace
+/*
+ * Compact output.
+ *
+ * The compact writer produces the same documents as the pretty writer, minus
+ * all insignificant whitespace. It formats text straight into a std::string
+ * through a raw cursor, without going through iostreams.
+ */
+
+/*
+ * A write cursor over the unused capacity of a string.
+ */
+class CompactBuffer {
+
+    std::string &m_out;
+    char *m_pos = nullptr;
+    char *m_end = nullptr;
+
+    void grow(std::size_t needed) {
+        std::size_t used = size();
+        m_out.resize(std::max(used + needed, 2 * m_out.size() + 256));
+        m_pos = m_out.data() + used;
+        m_end = m_out.data() + m_out.size();
+    }
+
+    void ensure(std::size_t needed) {
+        if (static_cast<std::size_t>(m_end - m_pos) < needed) {
+            grow(needed);
+        }
+    }
+
+    /*
+     * Characters that must be escaped in JSON strings.
+     */
+    static constexpr auto ESCAPED = []() {
+        std::array<bool, 256> table{};
+        for (int c = 0; c < 0x20; c++) {
+            table[c] = true;
+        }
+        table['"'] = true;
+        table['\\'] = true;
+        return table;
+    }();
+
+    void putEscaped(unsigned char c) {
+        static constexpr char HEX[] = "0123456789abcdef";
+
+        *m_pos++ = '\\';
+        switch (c) {
+        case '"':
+        case '\\':
+            *m_pos++ = static_cast<char>(c);
+            break;
+        case '\n':
+            *m_pos++ = 'n';
+            break;
+        case '\r':
+            *m_pos++ = 'r';
+            break;
+        case '\t':
+            *m_pos++ = 't';
+            break;
+        case '\b':
+            *m_pos++ = 'b';
+            break;
+        case '\f':
+            *m_pos++ = 'f';
+            break;
+        default:
+            std::memcpy(m_pos, "u00", 3);
+            m_pos[3] = HEX[c >> 4];
+            m_pos[4] = HEX[c & 0xF];
+            m_pos += 5;
+            break;
+        }
+    }
+
+  public:
+    explicit CompactBuffer(std::string &out) : m_out(out) {
+        std::size_t used = m_out.size();
+        m_out.resize(m_out.capacity());
+        m_pos = m_out.data() + used;
+        m_end = m_out.data() + m_out.size();
+    }
+
+    CompactBuffer(const CompactBuffer &) = delete;
+    CompactBuffer &operator=(const CompactBuffer &) = delete;
+
+    ~CompactBuffer() { m_out.resize(size()); }
+
+    [[nodiscard]] std::size_t size() const {
+        return static_cast<std::size_t>(m_pos - m_out.data());
+    }
+
+    /*
+     * Passes the contents to flush and empties the buffer.
+     */
+    template <typename Flush> void drain(Flush &flush) {
+        flush(std::string_view(m_out.data(), size()));
+        m_pos = m_out.data();
+    }
+
+    void raw(char c) {
+        ensure(1);
+        *m_pos++ = c;
+    }
+
+    void raw(std::string_view str) {
+        ensure(str.size());
+        std::memcpy(m_pos, str.data(), str.size());
+        m_pos += str.size();
+    }
+
+    void string(std::string_view str) {
+        // Every character expands to at most six
+        ensure(str.size() * 6 + 2);
+
+        *m_pos++ = '"';
+        for (char c : str) {
+            auto u = static_cast<unsigned char>(c);
+            if (ESCAPED[u]) {
+                putEscaped(u);
+            } else {
+                *m_pos++ = c;
+            }
+        }
+        *m_pos++ = '"';
+    }
+
+    void key(std::string_view key) {
+        string(key);
+        raw(':');
+    }
+
+    void number(std::size_t value) {
+        ensure(std::numeric_limits<std::size_t>::digits10 + 1);
+        m_pos = std::to_chars(m_pos, m_end, value).ptr;
+    }
+
+    /*
+     * Appends the shortest representation that reads back as value, which
+     * must be finite.
+     */
+    void real(float value) {
+        ensure(std::numeric_limits<float>::max_digits10 + 8);
+        m_pos = std::to_chars(m_pos, m_end, value).ptr;
+    }
+};
+
+void appendMetadata(CompactBuffer &out, const detail::HasMetadata &obj) {
+    if (!obj.hasMetadata()) {
+        return;
+    }
+
+    out.raw(",\"metadata\":{");
+    bool first = true;
+    for (const auto &[key, value] : obj.metadata()) {
+        if (!first) {
+            out.raw(',');
+        }
+        first = false;
+        out.key(key);
+        out.string(value);
+    }
+    out.raw('}');
+}
+
+void appendNode(CompactBuffer &out, IdRef id, const Node &node) {
+    out.key(id);
+    out.raw("{\"type\":");
+    out.string(node.type()->name);
+    appendMetadata(out, node);
+    out.raw('}');
+}
+
+void appendSection(CompactBuffer &out, IdRef id, const Section &section) {
+    out.key(id);
+    out.raw('{');
+
+    if (section.isConnected()) {
+        out.raw("\"link\":{\"startNode\":");
+        out.string(section.start());
+        out.raw(",\"startSlot\":");
+        out.number(section.startSlot());
+        out.raw(",\"endNode\":");
+        out.string(section.end());
+        out.raw(",\"endSlot\":");
+        out.number(section.endSlot());
+        out.raw("},");
+    }
+
+    out.raw("\"dir\":");
+    out.string(dirName(section.dir()));
+
+    if (section.length() != Section::DEFAULT_LENGTH) {
+        out.raw(",\"length\":");
+        out.real(section.length());
+    }
+    if (section.costMultiplier() != Section::DEFAULT_COST_MULTIPLIER) {
+        out.raw(",\"costMultiplier\":");
+        out.real(section.costMultiplier());
+    }
+
+    if (section.isDestination()) {
+        const auto &dest = *section.destination();
+        out.raw(",\"dest\":{\"address\":");
+        out.string(dest.address());
+        out.raw(",\"name\":");
+        out.string(dest.name());
+        appendMetadata(out, dest);
+        out.raw('}');
+    }
+
+    appendMetadata(out, section);
+    out.raw('}');
+}
 
-void writeModel(std::ostream &out, const Model &model) {
+/*
+ * Appends a compact definition to buffer. Whenever at least limit bytes are
+ * buffered, they are passed to flush and discarded; the tail is left for the
+ * caller to drain.
+ */
+template <typename Flush>
+void writeCompact(CompactBuffer &buffer, const Model &model, std::size_t limit,
+                  Flush flush) {
+    auto separate = [&](bool &first) {
+        if (!first) {
+            buffer.raw(',');
+        }
+        first = false;
+    };
+
+    buffer.raw("[{");
+    bool first = true;
+    for (const auto &[nodeId, node] : model.nodes()) {
+        separate(first);
+        appendNode(buffer, nodeId, node);
+        if (buffer.size() >= limit) {
+            buffer.drain(flush);
+        }
+    }
+
+    buffer.raw("},{");
+    first = true;
+    for (const auto &[sectionId, section] : model.sections()) {
+        separate(first);
+        appendSection(buffer, sectionId, section);
+        if (buffer.size() >= limit) {
+            buffer.drain(flush);
+        }
+    }
+
+    buffer.raw("}]");
+}
+
+/*
+ * Smallest number of entities worth handing to a thread.
+ */
+constexpr std::size_t MIN_CHUNK = 256;
+
+unsigned writerThreads(const WriterOptions &options) {
+    if (options.threads == 0) {
+        return std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    return options.threads;
+}
+
+/*
+ * Produces the same text as writeCompact by serializing chunks of nodes and
+ * sections on separate threads. Chunks are passed to flush in order once all
+ * of them are complete.
+ */
+template <typename Flush>
+void writeParallel(const Model &model, unsigned threads, Flush flush) {
+    struct Chunk {
+        bool isSection;
+        bool isFirst;
+        IdMap<Node>::const_iterator nodes;
+        IdMap<Section>::const_iterator sections;
+        std::size_t count;
+        std::string text;
+    };
+
+    std::size_t total = model.nodes().size() + model.sections().size();
+    std::size_t chunkSize = std::max(MIN_CHUNK, total / (threads * 8) + 1);
+
+    std::vector<Chunk> chunks;
+    auto split = [&](const auto &map, auto Chunk::*start, bool isSection) {
+        std::size_t index = 0;
+        for (auto it = map.begin(); it != map.end(); ++it, ++index) {
+            if (index % chunkSize == 0) {
+                Chunk &c = chunks.emplace_back();
+                c.isSection = isSection;
+                c.isFirst = index == 0;
+                c.*start = it;
+                c.count = std::min(chunkSize, map.size() - index);
+            }
+        }
+    };
+    split(model.nodes(), &Chunk::nodes, false);
+    split(model.sections(), &Chunk::sections, true);
+
+    auto serialize = [&](Chunk &c) {
+        CompactBuffer out(c.text);
+        auto write = [&](auto it, auto append) {
+            for (std::size_t i = 0; i < c.count; i++, ++it) {
+                if (i != 0 || !c.isFirst) {
+                    out.raw(',');
+                }
+                append(it->first, it->second);
+            }
+        };
+
+        if (c.isSection) {
+            write(c.sections, [&](IdRef id, const Section &section) {
+                appendSection(out, id, section);
+            });
+        } else {
+            write(c.nodes, [&](IdRef id, const Node &node) {
+                appendNode(out, id, node);
+            });
+        }
+    };
+
+    threads = static_cast<unsigned>(
+        std::min(static_cast<std::size_t>(threads), chunks.size()));
+
+    std::atomic<std::size_t> nextChunk = 0;
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto work = [&]() {
+        try {
+            for (std::size_t i = nextChunk++; i < chunks.size();
+                 i = nextChunk++) {
+                serialize(chunks[i]);
+            }
+        } catch (...) {
+            std::lock_guard lock(errorMutex);
+            error = std::current_exception();
+            nextChunk = chunks.size();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    flush("[{");
+    bool inSections = false;
+    for (auto &chunk : chunks) {
+        if (chunk.isSection && !inSections) {
+            flush("},{");
+            inSections = true;
+        }
+        flush(chunk.text);
+        std::string().swap(chunk.text);
+    }
+    if (!inSections) {
+        flush("},{");
+    }
+    flush("}]");
+}
+
+void writePretty(std::ostream &out, const Model &model) {
     minijson::array_writer w(
         out, minijson::writer_configuration().pretty_printing(true));
 
@@ -113,10 +497,111 @@ void writeModel(std::ostream &out, const Model &model) {
     writeSections(w, model);
 }
 
-void writeModel(const std::string &filename, const Model &model) {
+#ifdef PIWCS_PRW_HAVE_UNISTD
+
+void writeFd(int fd, std::string_view data) {
+    while (!data.empty()) {
+        auto written = ::write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::ios_base::failure(
+                "could not write model",
+                std::error_code(errno, std::generic_category()));
+        }
+        data.remove_prefix(static_cast<std::size_t>(written));
+    }
+}
+
+#endif
+
+} // namespace
+
+void writeModel(std::ostream &out, const Model &model,
+                const WriterOptions &options) {
+    if (options.pretty) {
+        writePretty(out, model);
+        return;
+    }
+
+    auto flush = [&](std::string_view data) {
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    };
+
+    if (unsigned threads = writerThreads(options); threads > 1) {
+        writeParallel(model, threads, flush);
+        return;
+    }
+
+    std::string storage;
+    storage.reserve(options.bufferSize + options.bufferSize / 8);
+    CompactBuffer buffer(storage);
+    writeCompact(buffer, model, options.bufferSize, flush);
+    buffer.drain(flush);
+}
+
+void writeModel(const std::string &filename, const Model &model,
+                const WriterOptions &options) {
     std::ofstream out(filename);
     out.exceptions(std::ios_base::failbit); // throws if the file failed to open
-    writeModel(out, model);
+    writeModel(out, model, options);
+}
+
+#ifdef PIWCS_PRW_HAVE_UNISTD
+
+void writeModelFd(int fd, const Model &model, const WriterOptions &options) {
+    if (options.pretty) {
+        std::ostringstream out;
+        writePretty(out, model);
+        writeFd(fd, out.view());
+        return;
+    }
+
+    auto flush = [&](std::string_view data) { writeFd(fd, data); };
+
+    if (unsigned threads = writerThreads(options); threads > 1) {
+        writeParallel(model, threads, flush);
+        return;
+    }
+
+    std::string storage;
+    storage.reserve(options.bufferSize + options.bufferSize / 8);
+    CompactBuffer buffer(storage);
+    writeCompact(buffer, model, options.bufferSize, flush);
+    buffer.drain(flush);
+}
+
+#else
+
+void writeModelFd(int /*fd*/, const Model & /*model*/,
+                  const WriterOptions & /*options*/) {
+    throw std::ios_base::failure(
+        "file descriptors are not supported on this platform",
+        std::make_error_code(std::errc::function_not_supported));
+}
+
+#endif
+
+void writeModelBuffer(std::string &buffer, const Model &model,
+                      const WriterOptions &options) {
+    if (options.pretty) {
+        std::ostringstream out;
+        writePretty(out, model);
+        buffer += out.view();
+        return;
+    }
+
+    if (unsigned threads = writerThreads(options); threads > 1) {
+        writeParallel(model, threads,
+                      [&](std::string_view data) { buffer += data; });
+        return;
+    }
+
+    // Nothing is flushed, so the definition stays appended to buffer
+    CompactBuffer out(buffer);
+    writeCompact(out, model, std::numeric_limits<std::size_t>::max(),
+                 [](std::string_view) {});
 }
 
 } // namespace piwcs::prw
@@ -0,0 +1,599 @@
+#include <piwcsprwmodel/journal.h>
+
+#include "binaryformat.h"
+#include "debug.h"
+#include "mappedfile.h"
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <type_traits>
+
+/*
+ * Journal layout. All integers use the byte order of the writing machine.
+ *
+ *   JournalHeader
+ *   { RecordHeader, payload }...
+ *
+ * A payload starts with an Op code followed by its operands. Strings are
+ * encoded as a 32-bit length followed by the characters; floats as their bit
+ * patterns; metadata is a 32-bit count followed by key and value strings.
+ * Records are appended in a single write, so a crash can only leave a partial
+ * record at the very end.
+ */
+
+namespace piwcs::prw {
+
+namespace {
+
+constexpr std::string_view MAGIC = "PIWCSJNL";
+constexpr std::uint32_t FORMAT_VERSION = 2;
+
+struct JournalHeader {
+    char magic[8];
+    std::uint32_t byteOrder;
+    std::uint32_t version;
+
+    /*
+     * Checksum of the snapshot this journal applies to, or 0 if unknown.
+     */
+    std::uint64_t base;
+};
+
+struct RecordHeader {
+    std::uint32_t size;
+
+    /*
+     * Low half of the payload checksum.
+     */
+    std::uint32_t checksum;
+};
+
+static_assert(std::has_unique_object_representations_v<JournalHeader>);
+static_assert(std::has_unique_object_representations_v<RecordHeader>);
+
+enum class Op : std::uint8_t {
+    ADD_NODE = 1,
+    ADD_SECTION,
+    REMOVE_NODE,
+    REMOVE_SECTION,
+    LINK,
+    UNLINK,
+    SET_METADATA,
+    ERASE_METADATA,
+    SET_ATTRIBUTES,
+};
+
+constexpr std::uint8_t HAS_DESTINATION = 1;
+
+std::uint32_t recordChecksum(std::string_view payload) {
+    return static_cast<std::uint32_t>(detail::checksum(payload));
+}
+
+JournalHeader makeHeader(std::uint64_t base) {
+    JournalHeader h{};
+    std::memcpy(h.magic, MAGIC.data(), sizeof(h.magic));
+    h.byteOrder = detail::ENDIAN_MARK;
+    h.version = FORMAT_VERSION;
+    h.base = base;
+    return h;
+}
+
+void writeHeader(std::ostream &out, std::uint64_t base) {
+    std::string data;
+    detail::append(data, makeHeader(base));
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+/*
+ * Splits journal data into record payloads.
+ */
+class JournalScanner {
+
+    std::string_view m_data;
+    std::size_t m_pos = 0;
+    JournalHeader m_header{};
+
+  public:
+    explicit JournalScanner(std::string_view data) : m_data(data) {
+        if (data.size() < sizeof(JournalHeader)) {
+            // Empty, or interrupted while the header was written
+            m_header = makeHeader(0);
+            m_pos = data.size();
+            return;
+        }
+
+        std::memcpy(&m_header, data.data(), sizeof(JournalHeader));
+        const JournalHeader &h = m_header;
+
+        if (MAGIC != std::string_view(h.magic, sizeof(h.magic))) {
+            throw InvalidFormatError("not a PRW model journal");
+        }
+        if (h.byteOrder != detail::ENDIAN_MARK) {
+            throw InvalidFormatError("journal byte order mismatch");
+        }
+        if (h.version != FORMAT_VERSION) {
+            throw InvalidFormatError("unsupported journal version");
+        }
+
+        m_pos = sizeof(JournalHeader);
+    }
+
+    [[nodiscard]] std::uint64_t base() const { return m_header.base; }
+
+    /*
+     * Returns the length of the journal up to and excluding the current
+     * record.
+     */
+    [[nodiscard]] std::size_t position() const { return m_pos; }
+
+    /*
+     * Returns the payload of the next complete record, or nothing at the end
+     * of the journal or at a partially written record.
+     */
+    std::optional<std::string_view> next() {
+        if (m_data.size() - m_pos < sizeof(RecordHeader)) {
+            return std::nullopt;
+        }
+
+        RecordHeader r;
+        std::memcpy(&r, m_data.data() + m_pos, sizeof(RecordHeader));
+        std::size_t begin = m_pos + sizeof(RecordHeader);
+        if (m_data.size() - begin < r.size) {
+            return std::nullopt;
+        }
+
+        std::string_view payload = m_data.substr(begin, r.size);
+        if (r.checksum != recordChecksum(payload)) {
+            throw InvalidFormatError("journal checksum mismatch");
+        }
+
+        m_pos = begin + r.size;
+        return payload;
+    }
+};
+
+/*
+ * Decodes the operands of a single record.
+ */
+class RecordReader {
+
+    std::string_view m_data;
+
+    std::string_view take(std::size_t count) {
+        if (m_data.size() < count) {
+            throw InvalidFormatError("journal record truncated");
+        }
+        std::string_view result = m_data.substr(0, count);
+        m_data.remove_prefix(count);
+        return result;
+    }
+
+  public:
+    explicit RecordReader(std::string_view payload) : m_data(payload) {}
+
+    std::uint8_t byte() { return static_cast<std::uint8_t>(take(1)[0]); }
+
+    std::uint32_t u32() {
+        std::uint32_t value;
+        std::memcpy(&value, take(sizeof(value)).data(), sizeof(value));
+        return value;
+    }
+
+    std::string_view string() { return take(u32()); }
+
+    float f32() { return std::bit_cast<float>(u32()); }
+
+    void metadata(detail::HasMetadata &target) {
+        std::uint32_t count = u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            IdRef key = string();
+            target.metadata()[key] = string();
+        }
+    }
+
+    void finish() const {
+        if (!m_data.empty()) {
+            throw InvalidFormatError("unexpected data in journal record");
+        }
+    }
+};
+
+detail::HasMetadata *metadataTarget(Model &model, std::uint8_t target,
+                                    IdRef id) {
+    detail::HasMetadata *result = nullptr;
+    switch (target) {
+    case static_cast<std::uint8_t>(Journal::Target::NODE):
+        result = model.node(id);
+        break;
+    case static_cast<std::uint8_t>(Journal::Target::SECTION):
+        result = model.section(id);
+        break;
+    default:
+        throw InvalidFormatError("unknown metadata target in journal");
+    }
+
+    if (result == nullptr) {
+        throw IllegalModelError("metadata target not found");
+    }
+    return result;
+}
+
+void setAttributes(Section &section, float length, float costMultiplier) {
+    if (!section.setLength(length) ||
+        !section.setCostMultiplier(costMultiplier)) {
+        throw InvalidFormatError("invalid section attributes in journal");
+    }
+}
+
+void applyRecord(Model &model, std::string_view payload) {
+    RecordReader r(payload);
+
+    switch (static_cast<Op>(r.byte())) {
+    case Op::ADD_NODE: {
+        std::uint8_t type = r.byte();
+        if (type >= detail::NODE_TYPE_COUNT) {
+            throw InvalidFormatError("unknown node type in journal");
+        }
+
+        Node node(detail::nodeTypes()[type], Identifier(r.string()));
+        r.metadata(node);
+        r.finish();
+
+        if (!model.addNode(std::move(node))) {
+            throw IllegalModelError("duplicate node ID");
+        }
+        break;
+    }
+    case Op::ADD_SECTION: {
+        Identifier id(r.string());
+        std::uint8_t dir = r.byte();
+        if (dir > static_cast<std::uint8_t>(Section::AllowedTravel::BIDIR)) {
+            throw InvalidFormatError("unknown directionality in journal");
+        }
+        float length = r.f32();
+        float costMultiplier = r.f32();
+
+        std::unique_ptr<Destination> dest;
+        if ((r.byte() & HAS_DESTINATION) != 0) {
+            Destination::Address address(r.string());
+            Destination::Name name(r.string());
+            dest = std::make_unique<Destination>(std::move(address),
+                                                 std::move(name));
+            r.metadata(*dest);
+        }
+
+        Section section(std::move(id),
+                        static_cast<Section::AllowedTravel>(dir),
+                        std::move(dest));
+        setAttributes(section, length, costMultiplier);
+        r.metadata(section);
+        r.finish();
+
+        if (!model.addSection(std::move(section))) {
+            throw IllegalModelError(
+                "duplicate section ID or destination address");
+        }
+        break;
+    }
+    case Op::REMOVE_NODE: {
+        IdRef id = r.string();
+        r.finish();
+        if (!model.removeNode(id)) {
+            throw IllegalModelError("could not remove node");
+        }
+        break;
+    }
+    case Op::REMOVE_SECTION: {
+        IdRef id = r.string();
+        r.finish();
+        if (!model.removeSection(id)) {
+            throw IllegalModelError("could not remove section");
+        }
+        break;
+    }
+    case Op::LINK: {
+        IdRef section = r.string();
+        IdRef startNode = r.string();
+        SlotId startSlot = r.byte();
+        IdRef endNode = r.string();
+        SlotId endSlot = r.byte();
+        r.finish();
+        if (!model.link(section, startNode, startSlot, endNode, endSlot)) {
+            throw IllegalModelError("linkage inconsistency found");
+        }
+        break;
+    }
+    case Op::UNLINK: {
+        IdRef section = r.string();
+        r.finish();
+        if (!model.unlink(section)) {
+            throw IllegalModelError("could not unlink section");
+        }
+        break;
+    }
+    case Op::SET_METADATA: {
+        std::uint8_t target = r.byte();
+        IdRef id = r.string();
+        IdRef key = r.string();
+        std::string_view value = r.string();
+        r.finish();
+        metadataTarget(model, target, id)->metadata(key) = value;
+        break;
+    }
+    case Op::ERASE_METADATA: {
+        std::uint8_t target = r.byte();
+        IdRef id = r.string();
+        IdRef key = r.string();
+        r.finish();
+        auto *obj = metadataTarget(model, target, id);
+        if (obj->hasMetadata()) {
+            auto &metadata = obj->metadata();
+            if (auto it = metadata.find(key); it != metadata.end()) {
+                metadata.erase(it);
+            }
+        }
+        break;
+    }
+    case Op::SET_ATTRIBUTES: {
+        IdRef id = r.string();
+        float length = r.f32();
+        float costMultiplier = r.f32();
+        r.finish();
+        Section *section = model.section(id);
+        if (section == nullptr) {
+            throw IllegalModelError("attribute target not found");
+        }
+        setAttributes(*section, length, costMultiplier);
+        break;
+    }
+    default:
+        throw InvalidFormatError("unknown journal operation");
+    }
+}
+
+std::size_t replay(Model &model, JournalScanner &scanner) {
+    std::size_t count = 0;
+    while (auto payload = scanner.next()) {
+        applyRecord(model, *payload);
+        count++;
+    }
+    return count;
+}
+
+/*
+ * Writes data into a temporary file and renames it to filename.
+ */
+void replaceFile(const std::string &filename, std::string_view data) {
+    std::string temporary = filename + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios_base::binary);
+        out.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+    std::filesystem::rename(temporary, filename);
+}
+
+} // namespace
+
+Journal::Journal(const std::string &filename) : m_out(&m_file) {
+    if (!std::filesystem::exists(filename)) {
+        throw std::ios_base::failure("journal does not exist: " + filename);
+    }
+
+    std::size_t length = 0;
+    std::size_t valid = 0;
+    {
+        detail::MappedFile file(filename);
+        JournalScanner scanner(file.view());
+        if (scanner.position() < sizeof(JournalHeader)) {
+            throw InvalidFormatError("journal header is incomplete");
+        }
+        while (scanner.next()) {
+        }
+        length = file.size();
+        valid = scanner.position();
+    }
+
+    if (valid != length) {
+        // Drop a partial trailing record so that new records follow the last
+        // complete one
+        std::filesystem::resize_file(filename, valid);
+    }
+
+    m_file.open(filename, std::ios_base::binary | std::ios_base::app);
+    m_file.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+}
+
+Journal::Journal(std::ostream &out) : m_out(&out) { writeHeader(out, 0); }
+
+void Journal::begin(std::uint8_t op) {
+    m_record.clear();
+    detail::append(m_record, RecordHeader{});
+    put(op);
+}
+
+void Journal::put(std::uint8_t value) {
+    m_record.push_back(static_cast<char>(value));
+}
+
+void Journal::put(std::string_view str) {
+    if (str.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::length_error("string too long for the journal");
+    }
+    detail::append(m_record, static_cast<std::uint32_t>(str.size()));
+    m_record.append(str);
+}
+
+void Journal::put(float value) {
+    detail::append(m_record, std::bit_cast<std::uint32_t>(value));
+}
+
+void Journal::putMetadata(const detail::HasMetadata &obj) {
+    if (!obj.hasMetadata()) {
+        detail::append(m_record, std::uint32_t{0});
+        return;
+    }
+
+    const auto &metadata = obj.metadata();
+    detail::append(m_record, static_cast<std::uint32_t>(metadata.size()));
+    for (const auto &[key, value] : metadata) {
+        put(key);
+        put(value);
+    }
+}
+
+void Journal::commit() {
+    std::string_view payload(m_record);
+    payload.remove_prefix(sizeof(RecordHeader));
+
+    RecordHeader h{static_cast<std::uint32_t>(payload.size()),
+                   recordChecksum(payload)};
+    std::memcpy(m_record.data(), &h, sizeof(h));
+
+    m_out->write(m_record.data(),
+                 static_cast<std::streamsize>(m_record.size()));
+}
+
+void Journal::addNode(const Node &node) {
+    begin(static_cast<std::uint8_t>(Op::ADD_NODE));
+    put(static_cast<std::uint8_t>(detail::nodeTypeCode(node.type())));
+    put(node.id());
+    putMetadata(node);
+    commit();
+}
+
+void Journal::addSection(const Section &section) {
+    begin(static_cast<std::uint8_t>(Op::ADD_SECTION));
+    put(section.id());
+    put(static_cast<std::uint8_t>(section.dir()));
+    put(section.length());
+    put(section.costMultiplier());
+
+    if (const Destination *dest = section.destination()) {
+        put(HAS_DESTINATION);
+        put(dest->address());
+        put(dest->name());
+        putMetadata(*dest);
+    } else {
+        put(std::uint8_t{0});
+    }
+
+    putMetadata(section);
+    commit();
+}
+
+void Journal::removeNode(IdRef id) {
+    begin(static_cast<std::uint8_t>(Op::REMOVE_NODE));
+    put(id);
+    commit();
+}
+
+void Journal::removeSection(IdRef id) {
+    begin(static_cast<std::uint8_t>(Op::REMOVE_SECTION));
+    put(id);
+    commit();
+}
+
+void Journal::link(IdRef sectionId, IdRef startNodeId, SlotId startSlotId,
+                   IdRef endNodeId, SlotId endSlotId) {
+    _ASSERT(startSlotId < SLOT_INVALID && endSlotId < SLOT_INVALID,
+            "slot out of range");
+
+    begin(static_cast<std::uint8_t>(Op::LINK));
+    put(sectionId);
+    put(startNodeId);
+    put(static_cast<std::uint8_t>(startSlotId));
+    put(endNodeId);
+    put(static_cast<std::uint8_t>(endSlotId));
+    commit();
+}
+
+void Journal::unlink(IdRef sectionId) {
+    begin(static_cast<std::uint8_t>(Op::UNLINK));
+    put(sectionId);
+    commit();
+}
+
+void Journal::setMetadata(Target target, IdRef id, IdRef key,
+                          std::string_view value) {
+    begin(static_cast<std::uint8_t>(Op::SET_METADATA));
+    put(static_cast<std::uint8_t>(target));
+    put(id);
+    put(key);
+    put(value);
+    commit();
+}
+
+void Journal::eraseMetadata(Target target, IdRef id, IdRef key) {
+    begin(static_cast<std::uint8_t>(Op::ERASE_METADATA));
+    put(static_cast<std::uint8_t>(target));
+    put(id);
+    put(key);
+    commit();
+}
+
+void Journal::setAttributes(IdRef sectionId, float length,
+                            float costMultiplier) {
+    begin(static_cast<std::uint8_t>(Op::SET_ATTRIBUTES));
+    put(sectionId);
+    put(length);
+    put(costMultiplier);
+    commit();
+}
+
+void Journal::flush() { m_out->flush(); }
+
+std::size_t replayJournal(Model &model, std::istream &in) {
+    std::string data(std::istreambuf_iterator<char>(in), {});
+    if (in.bad()) {
+        throw std::ios_base::failure("could not read journal");
+    }
+
+    JournalScanner scanner(data);
+    return replay(model, scanner);
+}
+
+std::size_t replayJournal(Model &model, const std::string &filename) {
+    detail::MappedFile file(filename);
+    JournalScanner scanner(file.view());
+    return replay(model, scanner);
+}
+
+Model compactJournal(const std::string &snapshotFile,
+                     const std::string &journalFile) {
+    Model model = readModelBinary(snapshotFile);
+    std::uint64_t base =
+        detail::checksum(detail::MappedFile(snapshotFile).view());
+
+    if (std::filesystem::exists(journalFile)) {
+        detail::MappedFile journal(journalFile);
+        JournalScanner scanner(journal.view());
+
+        // A journal bound to another snapshot has already been folded in.
+        // An unbound journal may or may not have been, so it is rejected
+        if (scanner.base() == base) {
+            replay(model, scanner);
+        } else if (scanner.base() == 0 && scanner.next()) {
+            throw InvalidFormatError("journal is not bound to a snapshot");
+        }
+    }
+
+    std::ostringstream snapshot(std::ios_base::binary);
+    writeModelBinary(snapshot, model);
+    std::string data = std::move(snapshot).str();
+    replaceFile(snapshotFile, data);
+
+    std::string header;
+    detail::append(header, makeHeader(detail::checksum(data)));
+    replaceFile(journalFile, header);
+
+    return model;
+}
+
+} // namespace piwcs::prw
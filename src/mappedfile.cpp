@@ -0,0 +1,85 @@
+#include "mappedfile.h"
+
+#include <cerrno>
+#include <ios>
+#include <system_error>
+
+#if __has_include(<sys/mman.h>)
+#define PIWCS_PRW_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+namespace piwcs::prw::detail {
+
+namespace {
+
+[[noreturn]] void fail(const char *what, const std::string &filename) {
+    std::error_code code(errno, std::generic_category());
+    throw std::ios_base::failure(std::string(what) + " \"" + filename + "\"",
+                                 code);
+}
+
+} // namespace
+
+#ifdef PIWCS_PRW_HAVE_MMAP
+
+MappedFile::MappedFile(const std::string &filename, Access access) {
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fail("could not open", filename);
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        fail("could not stat", filename);
+    }
+
+    m_size = static_cast<std::size_t>(st.st_size);
+
+    if (m_size != 0) {
+        int prot = access == Access::COPY_ON_WRITE ? PROT_READ | PROT_WRITE
+                                                   : PROT_READ;
+        void *addr = ::mmap(nullptr, m_size, prot, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            fail("could not map", filename);
+        }
+        ::madvise(addr, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<char *>(addr);
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (m_data != nullptr) {
+        ::munmap(m_data, m_size);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &filename, Access /*access*/) {
+    std::ifstream in(filename, std::ios_base::binary);
+    if (!in) {
+        fail("could not open", filename);
+    }
+
+    m_buffer.assign(std::istreambuf_iterator<char>(in), {});
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+}
+
+MappedFile::~MappedFile() = default;
+
+#endif
+
+} // namespace piwcs::prw::detail
@@ -0,0 +1,87 @@
+#ifndef PIWCS_PRW_MODEL_MAPPEDFILE
+#define PIWCS_PRW_MODEL_MAPPEDFILE
+
+#include <string>
+#include <string_view>
+
+namespace piwcs::prw::detail {
+
+/**
+ * A read-only view of the entire contents of a file.
+ *
+ * Where supported, the file is memory-mapped so that its contents are paged in
+ * on demand and never copied. Otherwise the file is read into memory.
+ */
+class MappedFile {
+
+  public:
+    /**
+     * Access modes of a mapping.
+     */
+    enum class Access {
+        /**
+         * The contents may only be read.
+         */
+        READ_ONLY,
+
+        /**
+         * The contents may be modified in memory. Changes are private to this
+         * mapping and are never written back to the file.
+         */
+        COPY_ON_WRITE
+    };
+
+  private:
+    char *m_data = nullptr;
+    std::size_t m_size = 0;
+
+    /**
+     * Fallback storage on platforms without memory mapping.
+     */
+    std::string m_buffer;
+
+  public:
+    /**
+     * Maps the file `filename`.
+     *
+     * @exception std::ios_base::failure if the file could not be opened or
+     * mapped
+     *
+     * @param filename the path of the file to map
+     * @param access the access mode of the mapping
+     */
+    explicit MappedFile(const std::string &filename,
+                        Access access = Access::READ_ONLY);
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    /**
+     * Returns the contents of the file. The view is valid for the lifetime of
+     * this object.
+     *
+     * @return the contents of the file
+     */
+    [[nodiscard]] std::string_view view() const { return {m_data, m_size}; }
+
+    /**
+     * Returns a pointer to the writable contents of the file. The mapping
+     * must have been created with Access::COPY_ON_WRITE.
+     *
+     * @return the contents of the file
+     */
+    [[nodiscard]] char *data() { return m_data; }
+
+    /**
+     * Returns the size of the file.
+     *
+     * @return the size of the file in bytes
+     */
+    [[nodiscard]] std::size_t size() const { return m_size; }
+};
+
+} // namespace piwcs::prw::detail
+
+#endif // PIWCS_PRW_MODEL_MAPPEDFILE
@@ -0,0 +1,64 @@
+#ifndef PIWCS_PRW_MODEL_MEMORY
+#define PIWCS_PRW_MODEL_MEMORY
+
+#include <piwcsprwmodel/metadata.h>
+
+#include <cstddef>
+#include <deque>
+#include <string>
+
+/*
+ * Estimates of heap memory owned by standard containers, used by
+ * Model::memoryUsage. Allocator overhead is not included.
+ */
+
+namespace piwcs::prw::detail {
+
+/**
+ * Returns the heap memory owned by a string, which is zero for strings stored
+ * inline.
+ */
+inline std::size_t heapBytes(const std::string &str) {
+    static const std::size_t INLINE_CAPACITY = std::string().capacity();
+    return str.capacity() > INLINE_CAPACITY ? str.capacity() + 1 : 0;
+}
+
+/**
+ * Returns the heap memory owned by a deque, assuming the 512-byte blocks of
+ * libstdc++ and libc++.
+ */
+template <typename T> std::size_t heapBytes(const std::deque<T> &deque) {
+    constexpr std::size_t BLOCK = 512;
+    constexpr std::size_t PER_BLOCK = sizeof(T) < BLOCK ? BLOCK / sizeof(T) : 1;
+    std::size_t blocks = deque.size() / PER_BLOCK + 1;
+    return blocks * PER_BLOCK * sizeof(T) + blocks * sizeof(T *);
+}
+
+/**
+ * Returns the heap memory of the buckets and entries of a node-based
+ * unordered container, excluding memory owned by the entries.
+ */
+template <typename C> std::size_t nodeBytes(const C &container) {
+    // Each node holds a next pointer, the entry and its cached hash
+    constexpr std::size_t NODE = sizeof(void *) +
+                                 sizeof(typename C::value_type) +
+                                 sizeof(std::size_t);
+    return container.bucket_count() * sizeof(void *) +
+           container.size() * NODE;
+}
+
+/**
+ * Returns the heap memory owned by the metadata of an object, excluding the
+ * interned keys. Shared metadata is split evenly between its holders.
+ */
+inline std::size_t heapBytes(const HasMetadata &obj) {
+    if (!obj.hasMetadata()) {
+        return 0;
+    }
+    return (sizeof(SharedMetadata) + obj.m_meta->data.memoryUsage()) /
+           obj.m_meta->refs;
+}
+
+} // namespace piwcs::prw::detail
+
+#endif // PIWCS_PRW_MODEL_MEMORY
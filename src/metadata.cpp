@@ -1,48 +1,261 @@
 #include <piwcsprwmodel/metadata.h>
 
-namespace piwcs::prw::detail {
+#include "memory.h"
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
 
-bool HasMetadata::hasMetadata() const { return m_meta && !m_meta->empty(); }
+namespace piwcs::prw {
+
+namespace {
+
+/*
+ * Returns the interned copy of a metadata key. Interned keys live until the
+ * program exits; node-based storage keeps their addresses stable.
+ */
+const Identifier *internKey(IdRef key) {
+    static std::shared_mutex mutex;
+    static std::unordered_set<Identifier, IdHash, std::equal_to<>> keys;
+
+    {
+        std::shared_lock lock(mutex);
+        if (auto it = keys.find(key); it != keys.end()) {
+            return &*it;
+        }
+    }
+
+    std::unique_lock lock(mutex);
+    return &*keys.emplace(key).first;
+}
+
+} // namespace
+
+std::vector<Metadata::Record>::iterator Metadata::lowerBound(IdRef key) {
+    return std::lower_bound(
+        m_records.begin(), m_records.end(), key,
+        [](const Record &r, IdRef k) { return IdRef(*r.key) < k; });
+}
+
+std::vector<Metadata::Record>::const_iterator
+Metadata::lowerBound(IdRef key) const {
+    return std::lower_bound(
+        m_records.begin(), m_records.end(), key,
+        [](const Record &r, IdRef k) { return IdRef(*r.key) < k; });
+}
+
+Metadata::iterator Metadata::find(IdRef key) {
+    auto it = lowerBound(key);
+    if (it == m_records.end() || *it->key != key) {
+        return end();
+    }
+    return iterator(it);
+}
+
+Metadata::const_iterator Metadata::find(IdRef key) const {
+    auto it = lowerBound(key);
+    if (it == m_records.end() || *it->key != key) {
+        return end();
+    }
+    return const_iterator(it);
+}
+
+std::pair<Metadata::iterator, bool> Metadata::try_emplace(IdRef key,
+                                                          std::string value) {
+    auto it = lowerBound(key);
+    if (it != m_records.end() && *it->key == key) {
+        return {iterator(it), false};
+    }
+    it = m_records.insert(it, {internKey(key), std::move(value)});
+    return {iterator(it), true};
+}
+
+Metadata::iterator Metadata::erase(const_iterator pos) {
+    return iterator(m_records.erase(pos.m_it));
+}
+
+Metadata::size_type Metadata::erase(IdRef key) {
+    auto it = find(key);
+    if (it == end()) {
+        return 0;
+    }
+    erase(it);
+    return 1;
+}
+
+std::size_t Metadata::memoryUsage() const {
+    std::size_t result = m_records.capacity() * sizeof(Record);
+    for (const auto &r : m_records) {
+        result += detail::heapBytes(r.value);
+    }
+    return result;
+}
+
+std::size_t Metadata::hash() const {
+    std::size_t result = m_records.size();
+    for (const auto &r : m_records) {
+        // Equal keys are interned to the same address
+        result = result * 31 + std::hash<const void *>{}(r.key);
+        result = result * 31 + std::hash<std::string>{}(r.value);
+    }
+    return result;
+}
+
+bool Metadata::operator==(const Metadata &other) const {
+    // Equal keys are interned to the same address
+    return std::equal(m_records.begin(), m_records.end(),
+                      other.m_records.begin(), other.m_records.end(),
+                      [](const Record &a, const Record &b) {
+                          return a.key == b.key && a.value == b.value;
+                      });
+}
+
+namespace detail {
+
+void HasMetadata::release() {
+    if (m_meta != nullptr && m_meta->refs.fetch_sub(1) == 1) {
+        delete m_meta;
+    }
+    m_meta = nullptr;
+}
+
+/*
+ * Copies the records of source into the storage of this object, which a
+ * writable reference has been handed out for.
+ */
+void HasMetadata::assignData(const HasMetadata &source) {
+    if (source.m_meta == nullptr) {
+        m_meta->data.clear();
+    } else {
+        m_meta->data = source.m_meta->data;
+    }
+}
+
+HasMetadata &HasMetadata::operator=(HasMetadata &&other) {
+    if (this == &other) {
+        return *this;
+    }
+
+    touch();
+    if (m_meta != nullptr && m_meta->exposed) {
+        if (other.m_meta != nullptr && other.m_meta->refs == 1) {
+            m_meta->data = std::move(other.m_meta->data);
+        } else {
+            assignData(other);
+        }
+        other.release();
+    } else {
+        release();
+        m_meta = std::exchange(other.m_meta, nullptr);
+    }
+    return *this;
+}
+
+void HasMetadata::shareMetadata(const HasMetadata &source) {
+    if (this == &source) {
+        return;
+    }
+
+    touch();
+
+    if (m_meta != nullptr && m_meta->exposed) {
+        assignData(source);
+        return;
+    }
+
+    SharedMetadata *shared = nullptr;
+    if (source.hasMetadata()) {
+        if (source.m_meta->exposed) {
+            shared = new SharedMetadata{1, false, source.m_meta->data};
+        } else {
+            shared = source.m_meta;
+            shared->refs++;
+        }
+    }
+
+    release();
+    m_meta = shared;
+}
+
+bool HasMetadata::hasMetadata() const {
+    return m_meta != nullptr && !m_meta->data.empty();
+}
 
 Metadata &HasMetadata::metadata() {
-    if (!m_meta) {
-        m_meta.emplace();
+    touch();
+
+    if (m_meta == nullptr) {
+        m_meta = new SharedMetadata;
+    } else if (m_meta->refs > 1) {
+        // Copy on write
+        auto *copy = new SharedMetadata{1, false, m_meta->data};
+        release();
+        m_meta = copy;
     }
-    return *m_meta;
+    m_meta->exposed = true;
+    return m_meta->data;
 }
 
 const Metadata &HasMetadata::metadata() const {
-    if (!m_meta) {
+    if (m_meta == nullptr) {
         static const Metadata EMPTY{};
         return EMPTY;
     }
-    return *m_meta;
+    return m_meta->data;
 }
 
 bool HasMetadata::hasMetadata(IdRef key) const {
-    return m_meta && m_meta->contains(key);
+    return m_meta != nullptr && m_meta->data.contains(key);
 }
 
 std::string_view HasMetadata::metadata(IdRef key) const {
-    if (!m_meta) {
+    if (m_meta == nullptr) {
         return "";
     }
 
-    auto it = m_meta->find(key);
-    if (it == m_meta->cend()) {
+    auto it = m_meta->data.find(key);
+    if (it == m_meta->data.cend()) {
         return "";
     }
 
     return it->second;
 }
 
-std::string &HasMetadata::metadata(IdRef key) {
-    auto &map = metadata();
-    auto it = map.find(key);
-    if (it == map.cend()) {
-        return map.emplace(Identifier(key), std::string{}).first->second;
+std::string &HasMetadata::metadata(IdRef key) { return metadata()[key]; }
+
+} // namespace detail
+
+MetadataTable::~MetadataTable() {
+    for (detail::SharedMetadata *shared : m_maps) {
+        if (shared->refs.fetch_sub(1) == 1) {
+            delete shared;
+        }
+    }
+}
+
+void MetadataTable::assign(detail::HasMetadata &target, Metadata &&metadata) {
+    target.touch();
+    if (target.m_meta != nullptr && target.m_meta->exposed) {
+        target.m_meta->data = std::move(metadata);
+        return;
+    }
+
+    target.release();
+    if (metadata.empty()) {
+        return;
+    }
+
+    auto it = m_maps.find(metadata);
+    if (it == m_maps.end()) {
+        // The table holds one reference of its own
+        auto *shared =
+            new detail::SharedMetadata{2, false, std::move(metadata)};
+        m_maps.insert(shared);
+        target.m_meta = shared;
+    } else {
+        (*it)->refs++;
+        target.m_meta = *it;
     }
-    return it->second;
 }
 
-} // namespace piwcs::prw::detail
+} // namespace piwcs::prw
@@ -0,0 +1,138 @@
+#include <piwcsprwmodel/metaindex.h>
+
+#include "memory.h"
+#include <piwcsprwmodel/nodes.h>
+#include <piwcsprwmodel/section.h>
+
+namespace piwcs::prw::detail {
+
+template <typename T> void MetadataIndex<T>::unindex(IdRef id) {
+    auto it = m_indexed.find(id);
+    if (it == m_indexed.end()) {
+        return;
+    }
+
+    for (const auto &[key, value] : it->second) {
+        auto byKey = m_postings.find(key);
+        auto byValue = byKey->second.find(value);
+        byValue->second.erase(byValue->second.find(id));
+
+        // Empty entries are dropped so that queries run in O(result)
+        if (byValue->second.empty()) {
+            byKey->second.erase(byValue);
+            if (byKey->second.empty()) {
+                m_postings.erase(byKey);
+            }
+        }
+    }
+    m_indexed.erase(it);
+}
+
+template <typename T> void MetadataIndex<T>::remove(IdRef id) {
+    unindex(id);
+    if (auto it = m_dirty.find(id); it != m_dirty.end()) {
+        m_dirty.erase(it);
+    }
+    if (auto it = m_watched.find(id); it != m_watched.end()) {
+        m_watched.erase(it);
+    }
+}
+
+template <typename T> void MetadataIndex<T>::update(const IdMap<T> &entities) {
+    for (const auto &id : m_watched) {
+        auto it = entities.find(id);
+        if (it == entities.end()) {
+            m_dirty.emplace(id);
+            continue;
+        }
+
+        auto indexed = m_indexed.find(id);
+        const Metadata &metadata = it->second.metadata();
+        bool changed = indexed == m_indexed.end()
+                           ? !metadata.empty()
+                           : indexed->second != metadata;
+        if (changed) {
+            m_dirty.emplace(id);
+        }
+    }
+
+    for (const auto &id : m_dirty) {
+        unindex(id);
+
+        auto it = entities.find(id);
+        if (it == entities.end()) {
+            if (auto w = m_watched.find(id); w != m_watched.end()) {
+                m_watched.erase(w);
+            }
+            continue;
+        }
+
+        if (it->second.exposed()) {
+            m_watched.emplace(id);
+        }
+        if (!it->second.hasMetadata()) {
+            continue;
+        }
+
+        const Metadata &metadata = it->second.metadata();
+        for (const auto &[key, value] : metadata) {
+            m_postings[key][value].emplace(id);
+        }
+        m_indexed.emplace(id, metadata);
+    }
+    m_dirty.clear();
+}
+
+template <typename T>
+std::vector<IdRef> MetadataIndex<T>::find(IdRef key) const {
+    std::vector<IdRef> result;
+    if (auto byKey = m_postings.find(key); byKey != m_postings.end()) {
+        for (const auto &[value, ids] : byKey->second) {
+            result.insert(result.end(), ids.begin(), ids.end());
+        }
+    }
+    return result;
+}
+
+template <typename T>
+std::vector<IdRef> MetadataIndex<T>::find(IdRef key, IdRef value) const {
+    auto byKey = m_postings.find(key);
+    if (byKey == m_postings.end()) {
+        return {};
+    }
+    auto byValue = byKey->second.find(value);
+    if (byValue == byKey->second.end()) {
+        return {};
+    }
+    return {byValue->second.begin(), byValue->second.end()};
+}
+
+template <typename T> std::size_t MetadataIndex<T>::memoryUsage() const {
+    std::size_t result = nodeBytes(m_postings) + nodeBytes(m_dirty) +
+                         nodeBytes(m_watched) + m_indexed.allocated_bytes();
+
+    for (const auto &[key, byValue] : m_postings) {
+        result += heapBytes(key) + nodeBytes(byValue);
+        for (const auto &[value, ids] : byValue) {
+            result += heapBytes(value) + nodeBytes(ids);
+            for (const auto &id : ids) {
+                result += heapBytes(id);
+            }
+        }
+    }
+    for (const auto &[id, metadata] : m_indexed) {
+        result += heapBytes(id) + metadata.memoryUsage();
+    }
+    for (const auto &id : m_dirty) {
+        result += heapBytes(id);
+    }
+    for (const auto &id : m_watched) {
+        result += heapBytes(id);
+    }
+    return result;
+}
+
+template class MetadataIndex<Node>;
+template class MetadataIndex<Section>;
+
+} // namespace piwcs::prw::detail
@@ -1,10 +1,121 @@
 #include "debug.h"
+#include "memory.h"
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
 #include <piwcsprwmodel/model.h>
 #include <piwcsprwmodel/nodes.h>
 #include <piwcsprwmodel/section.h>
 
 namespace piwcs::prw {
 
+Model::Model() : m_ids(std::make_unique<detail::IdPool>()) {}
+
+Model::Model(Model &&other) noexcept
+    : m_ids(std::move(other.m_ids)), m_nodes(std::move(other.m_nodes)),
+      m_sections(std::move(other.m_sections)),
+      m_nodeHandles(std::move(other.m_nodeHandles)),
+      m_sectionHandles(std::move(other.m_sectionHandles)),
+      m_destinations(std::move(other.m_destinations)),
+      m_openSlots(std::move(other.m_openSlots)),
+      m_openSlotCount(std::exchange(other.m_openSlotCount, 0)),
+      m_unlinkedSectionCount(std::exchange(other.m_unlinkedSectionCount, 0)),
+      m_nodeMetadata(std::move(other.m_nodeMetadata)),
+      m_sectionMetadata(std::move(other.m_sectionMetadata)) {}
+
+Model &Model::operator=(Model &&other) noexcept {
+    if (this != &other) {
+        // The previous contents are destroyed together with moved
+        Model moved(std::move(other));
+        swap(moved);
+    }
+    return *this;
+}
+
+void Model::swap(Model &other) noexcept {
+    std::swap(m_ids, other.m_ids);
+    std::swap(m_nodes, other.m_nodes);
+    std::swap(m_sections, other.m_sections);
+    std::swap(m_nodeHandles, other.m_nodeHandles);
+    std::swap(m_sectionHandles, other.m_sectionHandles);
+    std::swap(m_destinations, other.m_destinations);
+    std::swap(m_openSlots, other.m_openSlots);
+    std::swap(m_openSlotCount, other.m_openSlotCount);
+    std::swap(m_unlinkedSectionCount, other.m_unlinkedSectionCount);
+    std::swap(m_nodeMetadata, other.m_nodeMetadata);
+    std::swap(m_sectionMetadata, other.m_sectionMetadata);
+}
+
+/*
+ * Returns the ID pool, allocating it if this Model has been moved from.
+ */
+detail::IdPool &Model::ids() {
+    if (!m_ids) {
+        m_ids = std::make_unique<detail::IdPool>();
+    }
+    return *m_ids;
+}
+
+/*
+ * Inserts an entity into its map and records its location in the handle
+ * table. If the map has to relocate its entries, all locations are refreshed.
+ */
+template <typename T>
+T &Model::insert(IdMap<T> &map, detail::HandleTable<T> &handles,
+                 detail::MetadataIndex<T> *index, T &&entity) {
+    bool relocates = map.growth_left() == 0;
+
+    std::uint32_t handle = handles.acquire();
+    entity.m_handle = handle;
+    auto it = map.emplace(entity.id(), std::move(entity)).first;
+
+    // Moved entities do not keep their observer
+    if (relocates) {
+        for (auto &[id, e] : map) {
+            handles.update(e.m_handle, &e);
+            e.m_observer = index;
+        }
+    } else {
+        handles.update(handle, &it->second);
+        it->second.m_observer = index;
+    }
+
+    if (index != nullptr && it->second.hasMetadata()) {
+        index->mark(it->first);
+    }
+    return it->second;
+}
+
+/*
+ * Moves an entity into this Model without validation or bookkeeping.
+ */
+Node &Model::place(Node &&node) {
+    node.m_pool = &ids();
+    return insert(m_nodes, m_nodeHandles, m_nodeMetadata.get(),
+                  std::move(node));
+}
+
+Section &Model::place(Section &&section) {
+    section.m_pool = &ids();
+    return insert(m_sections, m_sectionHandles, m_sectionMetadata.get(),
+                  std::move(section));
+}
+
+/*
+ * Records a link in the entities without validation or bookkeeping.
+ */
+void Model::connect(Section &section, Node &start, SlotId startSlot,
+                    Node &end, SlotId endSlot) {
+    detail::IdPool &pool = ids();
+    auto sectionHandle = pool.intern(section.id());
+    start.m_slots[startSlot] = sectionHandle;
+    end.m_slots[endSlot] = sectionHandle;
+    section.m_start = pool.intern(start.id());
+    section.m_end = pool.intern(end.id());
+    section.m_startSlot = startSlot;
+    section.m_endSlot = endSlot;
+}
+
 Model::AddResult Model::addNode(Node node) {
 
     // Check ID
@@ -25,7 +136,12 @@ Model::AddResult Model::addNode(Node node) {
         }
     }
 
-    m_nodes.emplace(node.id(), std::move(node));
+    if (count != 0) {
+        m_openSlots.emplace(node.id(), (1U << count) - 1);
+        m_openSlotCount += count;
+    }
+
+    place(std::move(node));
     return AddResult::OK;
 }
 
@@ -42,14 +158,9 @@ Model::AddResult Model::addSection(Section section) {
     }
 
     // Check for duplicate destination address
-    if (section.isDestination()) {
-        const auto &address = section.destination()->address();
-        for (const auto &[_, otherSection] : sections()) {
-            if (otherSection.isDestination() &&
-                otherSection.destination()->address() == address) {
-                return AddResult::DUPLICATE;
-            }
-        }
+    if (section.isDestination() &&
+        m_destinations.contains(section.destination()->address())) {
+        return AddResult::DUPLICATE;
     }
 
     // Check for non-null node IDs
@@ -57,7 +168,12 @@ Model::AddResult Model::addSection(Section section) {
         return AddResult::HAS_REF;
     }
 
-    m_sections.emplace(section.id(), std::move(section));
+    if (section.isDestination()) {
+        m_destinations.emplace(section.destination()->address(), section.id());
+    }
+
+    place(std::move(section));
+    m_unlinkedSectionCount++;
     return AddResult::OK;
 }
 
@@ -80,6 +196,13 @@ Model::RemoveResult Model::removeNode(IdRef id) {
         }
     }
 
+    m_openSlots.erase(it->first);
+    m_openSlotCount -= count;
+
+    if (m_nodeMetadata) {
+        m_nodeMetadata->remove(id);
+    }
+    m_nodeHandles.release(node.m_handle);
     m_nodes.erase(it);
     return RemoveResult::OK;
 }
@@ -100,7 +223,16 @@ Model::RemoveResult Model::removeSection(IdRef id) {
         return RemoveResult::REFERENCED;
     }
 
+    if (section.isDestination()) {
+        m_destinations.erase(section.destination()->address());
+    }
+
+    if (m_sectionMetadata) {
+        m_sectionMetadata->remove(id);
+    }
+    m_sectionHandles.release(section.m_handle);
     m_sections.erase(it);
+    m_unlinkedSectionCount--;
     return RemoveResult::OK;
 }
 
@@ -121,8 +253,8 @@ Model::LinkResult Model::link(IdRef sectionId, IdRef startNodeId,
         return LinkResult::SAME_NODE;
     }
 
-    if (start->section(startSlot) != ID_NULL ||
-        end->section(endSlot) != ID_NULL) {
+    if (start->m_slots[startSlot] != detail::IdPool::NULL_HANDLE ||
+        end->m_slots[endSlot] != detail::IdPool::NULL_HANDLE) {
         return LinkResult::NODE_OCCUPIED;
     }
 
@@ -134,10 +266,11 @@ Model::LinkResult Model::link(IdRef sectionId, IdRef startNodeId,
         _FAIL("section->start() == ID_NULL, section->end() != ID_NULL");
     }
 
-    start->m_slots[startSlot] = sectionId;
-    end->m_slots[endSlot] = sectionId;
-    section->m_start = startNodeId;
-    section->m_end = endNodeId;
+    connect(*section, *start, startSlot, *end, endSlot);
+
+    closeSlot(startNodeId, startSlot);
+    closeSlot(endNodeId, endSlot);
+    m_unlinkedSectionCount--;
 
     return LinkResult::OK;
 }
@@ -167,21 +300,19 @@ Model::UnlinkResult Model::unlink(IdRef sectionId) {
     _ASSERT(end != nullptr, "end node not found");
 
     for (auto *node : {start, end}) {
-        _DEBUG_ONLY(bool found);
-
-        for (auto &slot : node->m_slots) { // NOLINT *-array-to-pointer-decay
-            if (slot == sectionId) {
-                slot = ID_NULL;
-                _DEBUG_ONLY(found = true);
-                break;
-            }
-        }
+        SlotId slot = node->slotOf(sectionId);
+        _ASSERT(slot != SLOT_INVALID,
+                "node did not connect to unlinked section");
 
-        _ASSERT(found, "node did not connect to unlinked section");
+        node->m_slots[slot] = detail::IdPool::NULL_HANDLE;
+        openSlot(node->id(), slot);
     }
 
-    section->m_start = ID_NULL;
-    section->m_end = ID_NULL;
+    section->m_start = detail::IdPool::NULL_HANDLE;
+    section->m_end = detail::IdPool::NULL_HANDLE;
+    section->m_startSlot = SLOT_INVALID;
+    section->m_endSlot = SLOT_INVALID;
+    m_unlinkedSectionCount++;
 
     return UnlinkResult::OK;
 }
@@ -206,4 +337,191 @@ Section *Model::section(IdRef id) {
     return it == m_sections.end() ? nullptr : &it->second;
 }
 
+NodeHandle Model::nodeHandle(IdRef id) const {
+    const Node *node = this->node(id);
+    return node == nullptr ? NodeHandle()
+                           : m_nodeHandles.handle(node->m_handle);
+}
+
+SectionHandle Model::sectionHandle(IdRef id) const {
+    const Section *section = this->section(id);
+    return section == nullptr ? SectionHandle()
+                              : m_sectionHandles.handle(section->m_handle);
+}
+
+void Model::openSlot(IdRef nodeId, SlotId slot) {
+    auto it = m_openSlots.find(nodeId);
+    if (it == m_openSlots.end()) {
+        it = m_openSlots.emplace(nodeId, 0).first;
+    }
+    it->second |= 1U << slot;
+    m_openSlotCount++;
+}
+
+void Model::closeSlot(IdRef nodeId, SlotId slot) {
+    auto it = m_openSlots.find(nodeId);
+    _ASSERT(it != m_openSlots.end(), "closed slot is not open");
+
+    it->second &= ~(1U << slot);
+    if (it->second == 0) {
+        m_openSlots.erase(it);
+    }
+    m_openSlotCount--;
+}
+
+const Section *Model::sectionByAddress(std::string_view address) const {
+    auto it = m_destinations.find(address);
+    return it == m_destinations.end() ? nullptr : section(it->second);
+}
+
+Section *Model::sectionByAddress(std::string_view address) {
+    auto it = m_destinations.find(address);
+    return it == m_destinations.end() ? nullptr : section(it->second);
+}
+
+namespace {
+
+template <typename T>
+std::vector<IdRef> withMetadata(const IdMap<T> &entities,
+                                detail::MetadataIndex<T> *index, IdRef key,
+                                const IdRef *value) {
+    if (index != nullptr) {
+        index->update(entities);
+        return value == nullptr ? index->find(key) : index->find(key, *value);
+    }
+
+    std::vector<IdRef> result;
+    for (const auto &[id, entity] : entities) {
+        if (!entity.hasMetadata()) {
+            continue;
+        }
+        auto it = entity.metadata().find(key);
+        if (it != entity.metadata().end() &&
+            (value == nullptr || it->second == *value)) {
+            result.push_back(id);
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+void Model::setMetadataIndexed(bool enabled) {
+    if (enabled == isMetadataIndexed()) {
+        return;
+    }
+
+    if (enabled) {
+        m_nodeMetadata = std::make_unique<detail::MetadataIndex<Node>>();
+        m_sectionMetadata = std::make_unique<detail::MetadataIndex<Section>>();
+    } else {
+        m_nodeMetadata.reset();
+        m_sectionMetadata.reset();
+    }
+    auto observe = [](auto &entities, auto *index) {
+        for (auto &[id, entity] : entities) {
+            entity.m_observer = index;
+            if (index != nullptr && entity.hasMetadata()) {
+                index->mark(id);
+            }
+        }
+    };
+    observe(m_nodes, m_nodeMetadata.get());
+    observe(m_sections, m_sectionMetadata.get());
+}
+
+std::vector<IdRef> Model::nodesWithMetadata(IdRef key) {
+    return withMetadata(m_nodes, m_nodeMetadata.get(), key, nullptr);
+}
+
+std::vector<IdRef> Model::nodesWithMetadata(IdRef key, IdRef value) {
+    return withMetadata(m_nodes, m_nodeMetadata.get(), key, &value);
+}
+
+std::vector<IdRef> Model::sectionsWithMetadata(IdRef key) {
+    return withMetadata(m_sections, m_sectionMetadata.get(), key, nullptr);
+}
+
+std::vector<IdRef> Model::sectionsWithMetadata(IdRef key, IdRef value) {
+    return withMetadata(m_sections, m_sectionMetadata.get(), key, &value);
+}
+
+Model::MemoryUsage Model::memoryUsage() const {
+    MemoryUsage result;
+
+    auto entities = [&](const auto &map, std::size_t &objects) {
+        using Entry = typename std::decay_t<decltype(map)>::value_type;
+        objects += map.size() * sizeof(Entry);
+        result.indices += map.allocated_bytes() - map.size() * sizeof(Entry);
+
+        for (const auto &[id, entity] : map) {
+            // The key and the entity each hold a copy of the ID
+            result.identifiers += 2 * detail::heapBytes(id);
+            result.metadata += detail::heapBytes(entity);
+        }
+    };
+
+    entities(m_nodes, result.nodes);
+    entities(m_sections, result.sections);
+
+    for (const auto &[id, section] : m_sections) {
+        if (const Destination *dest = section.destination()) {
+            result.destinations += sizeof(Destination) +
+                                   detail::heapBytes(dest->address()) +
+                                   detail::heapBytes(dest->name());
+            result.metadata += detail::heapBytes(*dest);
+        }
+    }
+
+    if (m_ids) {
+        result.identifiers += sizeof(detail::IdPool) + m_ids->memoryUsage();
+    }
+
+    if (m_nodeMetadata) {
+        result.indices += sizeof(*m_nodeMetadata) +
+                          m_nodeMetadata->memoryUsage() +
+                          sizeof(*m_sectionMetadata) +
+                          m_sectionMetadata->memoryUsage();
+    }
+
+    result.indices += m_destinations.allocated_bytes() +
+                      m_openSlots.allocated_bytes() +
+                      m_nodeHandles.memoryUsage() +
+                      m_sectionHandles.memoryUsage();
+    for (const auto &[address, id] : m_destinations) {
+        result.indices += detail::heapBytes(address) + detail::heapBytes(id);
+    }
+    for (const auto &[id, mask] : m_openSlots) {
+        result.indices += detail::heapBytes(id);
+    }
+
+    return result;
+}
+
+Model::MetadataStats Model::metadataStats() const {
+    MetadataStats result;
+
+    // Objects that share metadata return the same map
+    std::unordered_set<const Metadata *> stored;
+    auto count = [&](const detail::HasMetadata &obj) {
+        if (obj.hasMetadata()) {
+            result.objects++;
+            stored.insert(&obj.metadata());
+        }
+    };
+
+    for (const auto &[id, node] : m_nodes) {
+        count(node);
+    }
+    for (const auto &[id, section] : m_sections) {
+        count(section);
+        if (const Destination *dest = section.destination()) {
+            count(*dest);
+        }
+    }
+
+    result.stored = stored.size();
+    return result;
+}
+
 } // namespace piwcs::prw
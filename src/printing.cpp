@@ -1,7 +1,6 @@
 #include <piwcsprwmodel/nodes.h>
 #include <piwcsprwmodel/section.h>
 
-#include "nodetypeinfo.h"
 #include <iostream>
 
 namespace piwcs::prw {
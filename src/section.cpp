@@ -1,13 +1,37 @@
 #include <piwcsprwmodel/section.h>
 
 #include "debug.h"
+#include <cmath>
 
 namespace piwcs::prw {
 
 Section::Section(Identifier id, AllowedTravel dir,
                  std::unique_ptr<Destination> dest)
-    : m_id(std::move(id)), m_start(ID_NULL), m_end(ID_NULL), m_dir(dir),
-      m_dest(std::move(dest)) {}
+    : m_id(std::move(id)), m_dir(dir), m_dest(std::move(dest)) {}
+
+namespace {
+
+bool isValidAttribute(float value) {
+    return std::isfinite(value) && value >= 0;
+}
+
+} // namespace
+
+bool Section::setLength(float length) {
+    if (!isValidAttribute(length)) {
+        return false;
+    }
+    m_length = length;
+    return true;
+}
+
+bool Section::setCostMultiplier(float multiplier) {
+    if (!isValidAttribute(multiplier)) {
+        return false;
+    }
+    m_costMultiplier = multiplier;
+    return true;
+}
 
 bool Section::canTraverse(SlotId from, SlotId to) const {
     switch (m_dir) {
@@ -0,0 +1,339 @@
+#include <piwcsprwmodel/store.h>
+
+#include "debug.h"
+#include <algorithm>
+#include <limits>
+
+namespace piwcs::prw {
+
+namespace detail {
+
+void ModelShard::copy(const Node &node) {
+    Node result(node.type(), Identifier(node.id()));
+    result.shareMetadata(node);
+
+    result.m_pool = &m_ids;
+    for (SlotId slot = 0; slot < node.sectionCount(); slot++) {
+        IdRef section = node.section(slot);
+        if (section != ID_NULL) {
+            result.m_slots[slot] = m_ids.intern(section);
+        }
+    }
+
+    m_nodes.emplace(result.id(), std::move(result));
+}
+
+void ModelShard::copy(const Section &section) {
+    std::unique_ptr<Destination> dest;
+    if (const Destination *src = section.destination()) {
+        dest = std::make_unique<Destination>(src->address(), src->name());
+        dest->shareMetadata(*src);
+    }
+
+    Section result(Identifier(section.id()), section.dir(), std::move(dest));
+    result.shareMetadata(section);
+    result.m_length = section.m_length;
+    result.m_costMultiplier = section.m_costMultiplier;
+
+    result.m_pool = &m_ids;
+    if (section.isConnected()) {
+        result.m_start = m_ids.intern(section.start());
+        result.m_end = m_ids.intern(section.end());
+        result.m_startSlot = section.startSlot();
+        result.m_endSlot = section.endSlot();
+    }
+
+    m_sections.emplace(result.id(), std::move(result));
+}
+
+} // namespace detail
+
+namespace {
+
+constexpr std::size_t SHARD_BITS = 8;
+static_assert(ModelSnapshot::SHARD_COUNT == std::size_t{1} << SHARD_BITS);
+
+/*
+ * Sorts ids and removes duplicates.
+ */
+void normalize(std::vector<Identifier> &ids) {
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+} // namespace
+
+std::size_t ModelSnapshot::shardOf(std::string_view key) {
+    // FlatMap uses the low bits of the hash, so shards use the high bits
+    constexpr int SHIFT = std::numeric_limits<std::size_t>::digits - SHARD_BITS;
+    return IdHash{}(key) >> SHIFT;
+}
+
+ModelSnapshot::ModelSnapshot(Shards shards, std::uint64_t version,
+                             std::size_t nodeCount, std::size_t sectionCount)
+    : m_shards(std::move(shards)), m_version(version), m_nodeCount(nodeCount),
+      m_sectionCount(sectionCount) {}
+
+const Node *ModelSnapshot::node(IdRef id) const {
+    const auto &nodes = m_shards[shardOf(id)]->m_nodes;
+    auto it = nodes.find(id);
+    return it == nodes.end() ? nullptr : &it->second;
+}
+
+const Section *ModelSnapshot::section(IdRef id) const {
+    const auto &sections = m_shards[shardOf(id)]->m_sections;
+    auto it = sections.find(id);
+    return it == sections.end() ? nullptr : &it->second;
+}
+
+const Section *
+ModelSnapshot::sectionByAddress(std::string_view address) const {
+    const auto &destinations = m_shards[shardOf(address)]->m_destinations;
+    auto it = destinations.find(address);
+    return it == destinations.end() ? nullptr : section(it->second);
+}
+
+const CompiledModel &ModelSnapshot::compiled() const {
+    std::call_once(m_compileOnce, [this]() {
+        m_compiled = std::make_unique<CompiledModel>(*this);
+    });
+    return *m_compiled;
+}
+
+ModelStore::ModelStore(Model model) : m_model(std::move(model)) {
+    for (const auto &[id, node] : m_model.nodes()) {
+        m_dirtyNodes.emplace_back(id);
+    }
+    for (const auto &[id, section] : m_model.sections()) {
+        touchSection(section);
+    }
+
+    m_published.store(rebuild(nullptr));
+}
+
+void ModelStore::touchNode(IdRef id) { m_dirtyNodes.emplace_back(id); }
+
+void ModelStore::touchSection(const Section &section) {
+    m_dirtySections.emplace_back(section.id());
+    if (section.isDestination()) {
+        m_dirtyAddresses.emplace_back(section.destination()->address());
+    }
+}
+
+void ModelStore::touchHeld(const ModelSnapshot &published) {
+    // Entities returned by node() and section() may be changed through the
+    // returned pointer or through held metadata references at any time, so
+    // they are compared with their published copies instead
+    normalize(m_heldNodes);
+    normalize(m_heldSections);
+
+    std::erase_if(m_heldNodes, [&](const Identifier &id) {
+        const Node *node = m_model.node(id);
+        if (node == nullptr) {
+            return true;
+        }
+
+        const Node *copy = published.node(id);
+        if (copy == nullptr || node->metadata() != copy->metadata()) {
+            touchNode(id);
+        }
+        return false;
+    });
+
+    std::erase_if(m_heldSections, [&](const Identifier &id) {
+        const Section *section = m_model.section(id);
+        if (section == nullptr) {
+            return true;
+        }
+
+        const Section *copy = published.section(id);
+        if (copy == nullptr || section->metadata() != copy->metadata() ||
+            section->length() != copy->length() ||
+            section->costMultiplier() != copy->costMultiplier()) {
+            touchSection(*section);
+        }
+        return false;
+    });
+}
+
+std::shared_ptr<const ModelSnapshot>
+ModelStore::rebuild(const ModelSnapshot *previous) {
+    normalize(m_dirtyNodes);
+    normalize(m_dirtySections);
+    normalize(m_dirtyAddresses);
+
+    // Group changed keys by shard
+    std::array<std::vector<IdRef>, ModelSnapshot::SHARD_COUNT> nodes;
+    std::array<std::vector<IdRef>, ModelSnapshot::SHARD_COUNT> sections;
+    std::array<std::vector<IdRef>, ModelSnapshot::SHARD_COUNT> addresses;
+    for (const auto &id : m_dirtyNodes) {
+        nodes[ModelSnapshot::shardOf(id)].push_back(id);
+    }
+    for (const auto &id : m_dirtySections) {
+        sections[ModelSnapshot::shardOf(id)].push_back(id);
+    }
+    for (const auto &address : m_dirtyAddresses) {
+        addresses[ModelSnapshot::shardOf(address)].push_back(address);
+    }
+
+    auto contains = [](const std::vector<IdRef> &keys, IdRef key) {
+        return std::binary_search(keys.begin(), keys.end(), key);
+    };
+
+    ModelSnapshot::Shards shards;
+    if (previous != nullptr) {
+        shards = previous->m_shards;
+    } else {
+        shards.fill(std::make_shared<const detail::ModelShard>());
+    }
+
+    for (std::size_t i = 0; i < ModelSnapshot::SHARD_COUNT; i++) {
+        if (nodes[i].empty() && sections[i].empty() && addresses[i].empty()) {
+            continue;
+        }
+
+        const detail::ModelShard &old = *shards[i];
+        auto shard = std::make_shared<detail::ModelShard>();
+
+        // Unchanged entities are copied from the previous shard, changed ones
+        // from the working Model
+        for (const auto &[id, node] : old.m_nodes) {
+            if (!contains(nodes[i], id)) {
+                shard->copy(node);
+            }
+        }
+        for (IdRef id : nodes[i]) {
+            if (const Node *node = m_model.node(id)) {
+                shard->copy(*node);
+            }
+        }
+
+        for (const auto &[id, section] : old.m_sections) {
+            if (!contains(sections[i], id)) {
+                shard->copy(section);
+            }
+        }
+        for (IdRef id : sections[i]) {
+            if (const Section *section = m_model.section(id)) {
+                shard->copy(*section);
+            }
+        }
+
+        for (const auto &[address, id] : old.m_destinations) {
+            if (!contains(addresses[i], address)) {
+                shard->m_destinations.emplace(address, id);
+            }
+        }
+        for (IdRef address : addresses[i]) {
+            if (const Section *section = m_model.sectionByAddress(address)) {
+                shard->m_destinations.emplace(Identifier(address),
+                                              Identifier(section->id()));
+            }
+        }
+
+        shards[i] = std::move(shard);
+    }
+
+    m_dirtyNodes.clear();
+    m_dirtySections.clear();
+    m_dirtyAddresses.clear();
+
+    std::uint64_t version = previous == nullptr ? 1 : previous->version() + 1;
+    return std::shared_ptr<const ModelSnapshot>(
+        new ModelSnapshot(std::move(shards), version, m_model.nodes().size(),
+                          m_model.sections().size()));
+}
+
+std::shared_ptr<const ModelSnapshot> ModelStore::publish() {
+    auto previous = snapshot();
+    touchHeld(*previous);
+    if (m_dirtyNodes.empty() && m_dirtySections.empty() &&
+        m_dirtyAddresses.empty()) {
+        return previous;
+    }
+
+    auto next = rebuild(previous.get());
+    m_published.store(next, std::memory_order_release);
+    return next;
+}
+
+Model::AddResult ModelStore::addNode(Node node) {
+    Identifier id(node.id());
+    auto result = m_model.addNode(std::move(node));
+    if (result == Model::AddResult::OK) {
+        touchNode(id);
+    }
+    return result;
+}
+
+Model::AddResult ModelStore::addSection(Section section) {
+    Identifier id(section.id());
+    auto result = m_model.addSection(std::move(section));
+    if (result == Model::AddResult::OK) {
+        touchSection(*m_model.section(id));
+    }
+    return result;
+}
+
+Model::RemoveResult ModelStore::removeNode(IdRef id) {
+    Identifier removed(id);
+    auto result = m_model.removeNode(removed);
+    if (result == Model::RemoveResult::OK) {
+        touchNode(removed);
+    }
+    return result;
+}
+
+Model::RemoveResult ModelStore::removeSection(IdRef id) {
+    const Section *section = m_model.section(id);
+    if (section == nullptr) {
+        return Model::RemoveResult::NOT_FOUND;
+    }
+
+    // Remember the destination address before the section is gone
+    touchSection(*section);
+    return m_model.removeSection(Identifier(id));
+}
+
+Model::LinkResult ModelStore::link(IdRef sectionId, IdRef startNodeId,
+                                   SlotId startSlotId, IdRef endNodeId,
+                                   SlotId endSlotId) {
+    auto result = m_model.link(sectionId, startNodeId, startSlotId, endNodeId,
+                               endSlotId);
+    if (result == Model::LinkResult::OK) {
+        touchNode(startNodeId);
+        touchNode(endNodeId);
+        touchSection(*m_model.section(sectionId));
+    }
+    return result;
+}
+
+Model::UnlinkResult ModelStore::unlink(IdRef sectionId) {
+    const Section *section = m_model.section(sectionId);
+    if (section != nullptr && section->isConnected()) {
+        touchNode(section->start());
+        touchNode(section->end());
+        touchSection(*section);
+    }
+    return m_model.unlink(sectionId);
+}
+
+Node *ModelStore::node(IdRef id) {
+    Node *node = m_model.node(id);
+    if (node != nullptr) {
+        touchNode(id);
+        m_heldNodes.emplace_back(id);
+    }
+    return node;
+}
+
+Section *ModelStore::section(IdRef id) {
+    Section *section = m_model.section(id);
+    if (section != nullptr) {
+        touchSection(*section);
+        m_heldSections.emplace_back(id);
+    }
+    return section;
+}
+
+} // namespace piwcs::prw
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+
+#include <piwcsprwmodel.h>
+
+#include <string>
+#include <vector>
+
+using namespace piwcs::prw;
+
+namespace {
+
+using Kind = ModelBuilder::Violation::Kind;
+
+std::vector<Kind> kinds(const std::vector<ModelBuilder::Violation> &v) {
+    std::vector<Kind> result;
+    for (const auto &violation : v) {
+        result.push_back(violation.kind);
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(ModelBuilder, AnyOrder) {
+    ModelBuilder builder;
+    builder.reserve(3, 2);
+    builder.link("s1", "n1", 1, "n2", 0);
+    builder.addSection(Section("s1", Section::AllowedTravel::BIDIR,
+                               std::make_unique<Destination>("1.0", "A")));
+    builder.addNode(Node(THRU, "n1"));
+    builder.link("s2", "n2", 1, "n3", 0);
+    builder.addNode(Node(THRU, "n2"));
+    builder.addNode(Node(MOTORIZED, "n3"));
+    builder.addSection(Section("s2"));
+
+    EXPECT_TRUE(builder.validate().empty());
+    Model model = builder.build();
+
+    EXPECT_EQ(model.nodes().size(), 3);
+    EXPECT_EQ(model.sections().size(), 2);
+    EXPECT_EQ(model.section("s1")->start(), "n1");
+    EXPECT_EQ(model.section("s1")->end(), "n2");
+    EXPECT_EQ(model.section("s1")->startSlot(), 1);
+    EXPECT_EQ(model.node("n2")->section(0), "s1");
+    EXPECT_EQ(model.node("n2")->section(1), "s2");
+    EXPECT_EQ(model.node("n3")->section(0), "s2");
+    EXPECT_EQ(model.sectionByAddress("1.0"), model.section("s1"));
+
+    // Bookkeeping matches a Model built edit by edit
+    EXPECT_EQ(model.unlinkedSectionCount(), 0);
+    EXPECT_EQ(model.openSlots().size(), 3);
+    EXPECT_TRUE(model.openSlots().contains("n1", 0));
+    EXPECT_TRUE(model.openSlots().contains("n3", 1));
+    EXPECT_TRUE(model.openSlots().contains("n3", 2));
+    EXPECT_EQ(model.node(model.nodeHandle("n2")), model.node("n2"));
+
+    // The built Model accepts further edits
+    EXPECT_TRUE(!!model.unlink("s2"));
+    EXPECT_TRUE(!!model.removeNode("n3"));
+    EXPECT_EQ(model.openSlots().size(), 2);
+    EXPECT_TRUE(model.openSlots().contains("n2", 1));
+    EXPECT_EQ(model.unlinkedSectionCount(), 1);
+}
+
+TEST(ModelBuilder, Empty) {
+    ModelBuilder builder;
+    EXPECT_TRUE(builder.validate().empty());
+    Model model = builder.build();
+    EXPECT_TRUE(model.nodes().empty());
+    EXPECT_TRUE(model.sections().empty());
+}
+
+TEST(ModelBuilder, AllViolations) {
+    ModelBuilder builder;
+    builder.addNode(Node(THRU, "n1"));
+    builder.addNode(Node(THRU, "n1"));
+    builder.addNode(Node(THRU, ""));
+    builder.addNode(Node(END, "n2"));
+    builder.addSection(Section("s1", Section::AllowedTravel::BIDIR,
+                               std::make_unique<Destination>("1.0", "A")));
+    builder.addSection(Section("s1"));
+    builder.addSection(Section("s2", Section::AllowedTravel::BIDIR,
+                               std::make_unique<Destination>("1.0", "B")));
+    builder.addSection(Section("s3"));
+    builder.addSection(Section("s4"));
+    builder.addSection(Section("s5"));
+
+    builder.link("s1", "n1", 1, "n2", 0);
+    builder.link("s1", "n1", 0, "n2", 0);
+    builder.link("s3", "n1", 1, "n2", 1);
+    builder.link("s4", "n1", 1, "n1", 0);
+    builder.link("s5", "n1", 1, "n9", 0);
+    builder.link("s9", "n1", 0, "n2", 0);
+
+    std::vector<Kind> expected = {
+        Kind::NODE_DUPLICATE,     Kind::NODE_BAD_ID,
+        Kind::SECTION_DUPLICATE,  Kind::ADDRESS_DUPLICATE,
+        Kind::LINK_NODE_OCCUPIED, Kind::LINK_NOT_FOUND,
+        Kind::LINK_SAME_NODE,     Kind::LINK_NOT_FOUND,
+        Kind::LINK_NOT_FOUND,
+    };
+    EXPECT_EQ(kinds(builder.validate()), expected);
+    EXPECT_EQ(builder.validate()[0].id, "n1");
+    EXPECT_EQ(builder.validate()[3].id, "s2");
+    EXPECT_EQ(builder.validate()[8].id, "s9");
+
+    EXPECT_THROW(builder.build(), IllegalModelError);
+
+    // A failed build leaves the builder unchanged
+    EXPECT_EQ(builder.validate().size(), expected.size());
+}
+
+TEST(ModelBuilder, SectionOccupied) {
+    ModelBuilder builder;
+    builder.addNode(Node(CROSSING, "n1"));
+    builder.addNode(Node(CROSSING, "n2"));
+    builder.addSection(Section("s1"));
+    builder.link("s1", "n1", 0, "n2", 0);
+    builder.link("s1", "n1", 1, "n2", 1);
+
+    EXPECT_EQ(kinds(builder.validate()),
+              std::vector<Kind>{Kind::LINK_SECTION_OCCUPIED});
+
+    try {
+        builder.build();
+        FAIL() << "build() did not throw";
+    } catch (const IllegalModelError &e) {
+        EXPECT_NE(std::string(e.what()).find("s1"), std::string::npos);
+    }
+}
+
+TEST(ModelBuilder, HasRef) {
+    Model source;
+    source.newNode(THRU, "n1");
+    source.newNode(THRU, "n2");
+    source.newSection("s1");
+    source.link("s1", "n1", 1, "n2", 0);
+
+    ModelBuilder builder;
+    builder.addNode(*source.node("n1"));
+    // Sections cannot be copied; take it from the source Model instead
+    builder.addSection(std::move(*source.section("s1")));
+    EXPECT_EQ(kinds(builder.validate()),
+              (std::vector<Kind>{Kind::NODE_HAS_REF, Kind::SECTION_HAS_REF}));
+}
+
+TEST(ModelBuilder, Rehash) {
+    constexpr int COUNT = 3000;
+
+    ModelBuilder builder;
+    for (int i = 0; i < COUNT; i++) {
+        builder.addNode(Node(THRU, "n" + std::to_string(i)));
+        builder.addSection(Section("s" + std::to_string(i)));
+        builder.link("s" + std::to_string(i), "n" + std::to_string(i), 1,
+                     "n" + std::to_string((i + 1) % COUNT), 0);
+    }
+
+    Model model = builder.build();
+    EXPECT_TRUE(isComplete(model));
+    for (int i = 0; i < COUNT; i++) {
+        auto id = "n" + std::to_string(i);
+        EXPECT_EQ(model.node(model.nodeHandle(id))->id(), id);
+    }
+
+    // The builder is empty after building
+    EXPECT_TRUE(builder.build().nodes().empty());
+}
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+
+#include <piwcsprwmodel.h>
+
+using namespace piwcs::prw;
+
+namespace {
+
+using Index = CompiledModel::Index;
+
+} // namespace
+
+TEST(CompiledModel, Empty) {
+    CompiledModel compiled{Model()};
+
+    EXPECT_EQ(compiled.nodeCount(), 0);
+    EXPECT_EQ(compiled.sectionCount(), 0);
+    EXPECT_EQ(compiled.destinationCount(), 0);
+    EXPECT_EQ(compiled.nodeIndex("n1"), CompiledModel::NONE);
+    EXPECT_EQ(compiled.sectionIndex("s1"), CompiledModel::NONE);
+    EXPECT_EQ(compiled.destinationIndex("1.0.0"), CompiledModel::NONE);
+}
+
+TEST(CompiledModel, Indices) {
+    Model model;
+    model.newNode(THRU, "n2");
+    model.newNode(MOTORIZED, "n1");
+    model.newSection("s2");
+    model.newSection("s1");
+
+    CompiledModel compiled(model);
+
+    ASSERT_EQ(compiled.nodeCount(), 2);
+    ASSERT_EQ(compiled.sectionCount(), 2);
+
+    EXPECT_EQ(compiled.nodeIndex("n1"), 0);
+    EXPECT_EQ(compiled.nodeIndex("n2"), 1);
+    EXPECT_EQ(compiled.nodeIndex("n3"), CompiledModel::NONE);
+    EXPECT_EQ(compiled.sectionIndex("s1"), 0);
+    EXPECT_EQ(compiled.sectionIndex("s2"), 1);
+
+    EXPECT_EQ(compiled.nodeId(0), "n1");
+    EXPECT_EQ(compiled.nodeId(1), "n2");
+    EXPECT_EQ(compiled.sectionId(0), "s1");
+    EXPECT_EQ(compiled.sectionId(1), "s2");
+
+    EXPECT_EQ(compiled.nodeType(0), MOTORIZED);
+    EXPECT_EQ(compiled.nodeType(1), THRU);
+    EXPECT_EQ(compiled.slotCount(0), 3);
+    EXPECT_EQ(compiled.slotCount(1), 2);
+}
+
+TEST(CompiledModel, Costs) {
+    Model model;
+    model.newSection("s1");
+    model.newSection("s2");
+    model.section("s2")->setLength(4);
+    model.section("s2")->setCostMultiplier(2.5F);
+
+    CompiledModel compiled(model);
+
+    EXPECT_EQ(compiled.sectionLength(0), 1);
+    EXPECT_EQ(compiled.sectionCost(0), 1);
+    EXPECT_EQ(compiled.sectionLength(1), 4);
+    EXPECT_EQ(compiled.sectionCost(1), 10);
+    EXPECT_EQ(compiled.sectionCosts(), (std::vector<float>{1, 10}));
+}
+
+TEST(CompiledModel, Links) {
+    Model model;
+    model.newNode(MOTORIZED, "n1");
+    model.newNode(THRU, "n2");
+    model.newSection("s1");
+    model.newSection("s2", Section::AllowedTravel::BIDIR, nullptr);
+    model.newSection("s3");
+    model.link("s1", "n1", 2, "n2", 0);
+    model.link("s2", "n2", 1, "n1", 0);
+
+    CompiledModel compiled(model);
+
+    Index n1 = compiled.nodeIndex("n1");
+    Index n2 = compiled.nodeIndex("n2");
+    Index s1 = compiled.sectionIndex("s1");
+    Index s2 = compiled.sectionIndex("s2");
+    Index s3 = compiled.sectionIndex("s3");
+
+    EXPECT_EQ(compiled.slotSection(n1, 0), s2);
+    EXPECT_EQ(compiled.slotSection(n1, 1), CompiledModel::NONE);
+    EXPECT_EQ(compiled.slotSection(n1, 2), s1);
+    EXPECT_EQ(compiled.slotSection(n2, 0), s1);
+    EXPECT_EQ(compiled.slotSection(n2, 1), s2);
+
+    EXPECT_EQ(compiled.sectionNode(s1, 0), n1);
+    EXPECT_EQ(compiled.sectionSlot(s1, 0), 2);
+    EXPECT_EQ(compiled.sectionNode(s1, 1), n2);
+    EXPECT_EQ(compiled.sectionSlot(s1, 1), 0);
+
+    EXPECT_EQ(compiled.sectionNode(s2, 0), n2);
+    EXPECT_EQ(compiled.sectionSlot(s2, 0), 1);
+    EXPECT_EQ(compiled.sectionNode(s2, 1), n1);
+    EXPECT_EQ(compiled.sectionSlot(s2, 1), 0);
+
+    EXPECT_EQ(compiled.sectionNode(s3, 0), CompiledModel::NONE);
+    EXPECT_EQ(compiled.sectionNode(s3, 1), CompiledModel::NONE);
+    EXPECT_EQ(compiled.sectionSlot(s3, 0), SLOT_INVALID);
+    EXPECT_EQ(compiled.sectionSlot(s3, 1), SLOT_INVALID);
+
+    EXPECT_EQ(compiled.sectionDir(s1), Section::AllowedTravel::UNIDIR);
+    EXPECT_EQ(compiled.sectionDir(s2), Section::AllowedTravel::BIDIR);
+}
+
+TEST(CompiledModel, Destinations) {
+    Model model;
+    model.newSection("s1", Section::AllowedTravel::UNIDIR,
+                     std::make_unique<Destination>("1.0.1", "Name1"));
+    model.newSection("s2");
+    model.newSection("s3", Section::AllowedTravel::UNIDIR,
+                     std::make_unique<Destination>("1.0.0", "Name3"));
+
+    CompiledModel compiled(model);
+
+    ASSERT_EQ(compiled.destinationCount(), 2);
+
+    Index d0 = compiled.destinationIndex("1.0.0");
+    Index d1 = compiled.destinationIndex("1.0.1");
+    EXPECT_EQ(d0, 0);
+    EXPECT_EQ(d1, 1);
+    EXPECT_EQ(compiled.destinationAddress(d0), "1.0.0");
+    EXPECT_EQ(compiled.destinationAddress(d1), "1.0.1");
+
+    EXPECT_EQ(compiled.destinationSection(d0), compiled.sectionIndex("s3"));
+    EXPECT_EQ(compiled.destinationSection(d1), compiled.sectionIndex("s1"));
+
+    EXPECT_EQ(compiled.sectionDestination(compiled.sectionIndex("s1")), d1);
+    EXPECT_EQ(compiled.sectionDestination(compiled.sectionIndex("s2")),
+              CompiledModel::NONE);
+    EXPECT_EQ(compiled.sectionDestination(compiled.sectionIndex("s3")), d0);
+}
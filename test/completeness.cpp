@@ -2,6 +2,8 @@
 
 #include <piwcsprwmodel.h>
 
+#include <set>
+
 using namespace piwcs::prw;
 
 TEST(Completeness, Basic) {
@@ -41,3 +43,69 @@ TEST(Completeness, VeryIncomplete) {
 
     ASSERT_FALSE(isComplete(model));
 }
+
+TEST(Completeness, OpenSlots) {
+    Model model;
+    model.newNode(THRU, "n1");
+    model.newNode(MOTORIZED, "n2");
+    model.newSection("s1");
+
+    EXPECT_EQ(model.openSlots().size(), 5);
+    EXPECT_EQ(model.unlinkedSectionCount(), 1);
+
+    model.link("s1", "n1", 1, "n2", 0);
+
+    EXPECT_EQ(model.openSlots().size(), 3);
+    EXPECT_EQ(model.unlinkedSectionCount(), 0);
+    EXPECT_TRUE(model.openSlots().contains("n1", 0));
+    EXPECT_FALSE(model.openSlots().contains("n1", 1));
+    EXPECT_FALSE(model.openSlots().contains("n2", 0));
+    EXPECT_TRUE(model.openSlots().contains("n2", 1));
+    EXPECT_TRUE(model.openSlots().contains("n2", 2));
+    EXPECT_FALSE(model.openSlots().contains("n3", 0));
+
+    std::set<std::pair<std::string, SlotId>> found;
+    for (auto [node, slot] : model.openSlots()) {
+        found.emplace(node, slot);
+    }
+    EXPECT_EQ(found, (std::set<std::pair<std::string, SlotId>>{
+                         {"n1", 0}, {"n2", 1}, {"n2", 2}}));
+
+    model.unlink("s1");
+
+    EXPECT_EQ(model.openSlots().size(), 5);
+    EXPECT_EQ(model.unlinkedSectionCount(), 1);
+    EXPECT_TRUE(model.openSlots().contains("n1", 1));
+
+    model.removeNode("n2");
+    model.removeSection("s1");
+
+    EXPECT_EQ(model.openSlots().size(), 2);
+    EXPECT_EQ(model.unlinkedSectionCount(), 0);
+    EXPECT_FALSE(model.openSlots().contains("n2", 1));
+}
+
+TEST(Completeness, CompleteAfterEdits) {
+    Model model;
+    model.newNode(THRU, "n1");
+    model.newNode(THRU, "n2");
+    model.newSection("s1");
+    model.newSection("s2");
+    model.link("s1", "n1", 0, "n2", 0);
+    model.link("s2", "n1", 1, "n2", 1);
+    ASSERT_TRUE(isComplete(model));
+    EXPECT_TRUE(model.openSlots().empty());
+    EXPECT_EQ(model.openSlots().begin(), model.openSlots().end());
+
+    model.unlink("s2");
+    ASSERT_FALSE(isComplete(model));
+
+    model.link("s2", "n2", 1, "n1", 1);
+    ASSERT_TRUE(isComplete(model));
+
+    model.newSection("s3");
+    ASSERT_FALSE(isComplete(model));
+
+    model.removeSection("s3");
+    ASSERT_TRUE(isComplete(model));
+}
@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+
+#include <piwcsprwmodel.h>
+
+#include <map>
+#include <random>
+
+using namespace piwcs::prw;
+
+TEST(IdMap, Empty) {
+    IdMap<int> map;
+
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.size(), 0);
+    EXPECT_EQ(map.begin(), map.end());
+    EXPECT_EQ(map.find("a"), map.end());
+    EXPECT_FALSE(map.contains(IdRef("a")));
+    EXPECT_EQ(map.erase("a"), 0);
+}
+
+TEST(IdMap, InsertFind) {
+    IdMap<int> map;
+
+    auto [it, inserted] = map.emplace(IdRef("a"), 1);
+    EXPECT_TRUE(inserted);
+    EXPECT_EQ(it->first, "a");
+    EXPECT_EQ(it->second, 1);
+
+    std::tie(it, inserted) = map.emplace(Identifier("a"), 2);
+    EXPECT_FALSE(inserted);
+    EXPECT_EQ(it->second, 1);
+
+    map["b"] = 3;
+    EXPECT_EQ(map.size(), 2);
+    EXPECT_EQ(map.at("b"), 3);
+    EXPECT_EQ(map.find(IdRef("a"))->second, 1);
+    EXPECT_EQ(map.find(Identifier("b"))->second, 3);
+    EXPECT_THROW(static_cast<void>(map.at("c")), std::out_of_range);
+}
+
+TEST(IdMap, LongKeys) {
+    IdMap<int> map;
+    Identifier longKey(100, 'x');
+
+    map[longKey] = 1;
+    map[longKey + "y"] = 2;
+
+    EXPECT_EQ(map.at(IdRef(longKey)), 1);
+    EXPECT_EQ(map.at(longKey + "y"), 2);
+    EXPECT_FALSE(map.contains(longKey + "z"));
+}
+
+TEST(IdMap, Erase) {
+    IdMap<int> map{{"a", 1}, {"b", 2}, {"c", 3}};
+
+    EXPECT_EQ(map.erase("b"), 1);
+    EXPECT_EQ(map.erase("b"), 0);
+    EXPECT_EQ(map.size(), 2);
+    EXPECT_FALSE(map.contains("b"));
+
+    map.erase(map.find("a"));
+    EXPECT_EQ(map.size(), 1);
+    EXPECT_EQ(map.begin()->first, "c");
+
+    map["b"] = 4;
+    EXPECT_EQ(map.at("b"), 4);
+}
+
+TEST(IdMap, EraseWhileIterating) {
+    IdMap<int> map;
+    for (int i = 0; i < 100; i++) {
+        map[std::to_string(i)] = i;
+    }
+
+    for (auto it = map.begin(); it != map.end();) {
+        if (it->second % 2 == 0) {
+            it = map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    EXPECT_EQ(map.size(), 50);
+    for (const auto &[key, value] : map) {
+        EXPECT_EQ(value % 2, 1);
+        EXPECT_EQ(key, std::to_string(value));
+    }
+}
+
+TEST(IdMap, CopyMoveCompare) {
+    IdMap<std::string> map{{"a", "1"}, {"b", "2"}};
+
+    IdMap<std::string> copy = map;
+    EXPECT_EQ(copy, map);
+
+    copy["a"] = "3";
+    EXPECT_NE(copy, map);
+
+    IdMap<std::string> moved = std::move(copy);
+    EXPECT_EQ(moved.at("a"), "3");
+    EXPECT_TRUE(copy.empty()); // NOLINT(*-use-after-move)
+
+    copy = moved;
+    EXPECT_EQ(copy, moved);
+}
+
+TEST(IdMap, Reserve) {
+    IdMap<int> map;
+    map.reserve(1000);
+    auto buckets = map.bucket_count();
+
+    for (int i = 0; i < 1000; i++) {
+        map[std::to_string(i)] = i;
+    }
+
+    EXPECT_EQ(map.bucket_count(), buckets);
+}
+
+namespace {
+
+/*
+ * A key whose copies throw once a budget of copies is exhausted.
+ */
+struct FragileKey {
+    static inline int copiesLeft = -1;
+
+    int value;
+
+    explicit FragileKey(int value) : value(value) {}
+
+    FragileKey(const FragileKey &other) : value(other.value) {
+        if (copiesLeft == 0) {
+            throw std::bad_alloc();
+        }
+        copiesLeft--;
+    }
+
+    FragileKey &operator=(const FragileKey &) = delete;
+    ~FragileKey() = default;
+
+    bool operator==(const FragileKey &) const = default;
+};
+
+struct FragileKeyHash {
+    std::size_t operator()(const FragileKey &key) const {
+        return std::hash<int>()(key.value);
+    }
+};
+
+} // namespace
+
+TEST(IdMap, ThrowingGrowthHasNoEffect) {
+    detail::FlatMap<FragileKey, std::string, FragileKeyHash,
+                    std::equal_to<>>
+        map;
+    for (int i = 0; i < 14; i++) {
+        map.emplace(FragileKey(i), std::string(100, static_cast<char>('a' + i)));
+    }
+    ASSERT_EQ(map.growth_left(), 0);
+    auto buckets = map.bucket_count();
+
+    // Fail halfway through moving the entries into a larger table
+    FragileKey::copiesLeft = 7;
+    EXPECT_THROW(map.emplace(FragileKey(14), "x"), std::bad_alloc);
+    FragileKey::copiesLeft = -1;
+
+    EXPECT_EQ(map.size(), 14);
+    EXPECT_EQ(map.bucket_count(), buckets);
+    EXPECT_EQ(map.growth_left(), 0);
+    for (int i = 0; i < 14; i++) {
+        auto it = map.find(FragileKey(i));
+        ASSERT_NE(it, map.end());
+        EXPECT_EQ(it->second, std::string(100, static_cast<char>('a' + i)));
+    }
+
+    map.emplace(FragileKey(14), "x");
+    EXPECT_EQ(map.size(), 15);
+    EXPECT_GT(map.bucket_count(), buckets);
+}
+
+TEST(IdMap, MatchesStdMap) {
+    IdMap<int> map;
+    std::map<Identifier, int> reference;
+    std::mt19937 rng(42); // NOLINT(*-msc51-cpp)
+
+    for (int i = 0; i < 100000; i++) {
+        Identifier key = "k" + std::to_string(rng() % 2000);
+        switch (rng() % 3) {
+        case 0:
+        case 1:
+            map[key] = i;
+            reference[key] = i;
+            break;
+        default:
+            EXPECT_EQ(map.erase(key), reference.erase(key));
+            break;
+        }
+    }
+
+    ASSERT_EQ(map.size(), reference.size());
+    for (const auto &[key, value] : reference) {
+        auto it = map.find(key);
+        ASSERT_NE(it, map.end());
+        EXPECT_EQ(it->second, value);
+    }
+
+    std::size_t count = 0;
+    for ([[maybe_unused]] const auto &entry : map) {
+        count++;
+    }
+    EXPECT_EQ(count, reference.size());
+}
@@ -12,17 +12,35 @@ Model _read(const char *src) {
     return readModel(in);
 }
 
+Model _readBuffer(const char *src) { return readModelBuffer(src); }
+
+Model _readParallel(const char *src) { return readModelParallel(src, 4); }
+
 #define MUST_FAIL(msg, src)                                                    \
     try {                                                                      \
         (void)_read(src);                                                      \
         FAIL() << "Error not detected by readModel: " << msg;                  \
     } catch (...) {                                                            \
         /* Do nothing */                                                       \
+    }                                                                          \
+    try {                                                                      \
+        (void)_readBuffer(src);                                                \
+        FAIL() << "Error not detected by readModelBuffer: " << msg;            \
+    } catch (...) {                                                            \
+        /* Do nothing */                                                       \
+    }                                                                          \
+    try {                                                                      \
+        (void)_readParallel(src);                                              \
+        FAIL() << "Error not detected by readModelParallel: " << msg;          \
+    } catch (...) {                                                            \
+        /* Do nothing */                                                       \
     }
 
 #define MUST_PASS(msg, src)                                                    \
     try {                                                                      \
         (void)_read(src);                                                      \
+        (void)_readBuffer(src);                                                \
+        (void)_readParallel(src);                                              \
     } catch (...) {                                                            \
         FAIL() << "Errors detected by readModel when testing " << msg;         \
     }
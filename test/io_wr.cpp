@@ -2,6 +2,7 @@
 
 #include <piwcsprwmodel.h>
 
+#include <cstdio>
 #include <sstream>
 
 using namespace piwcs::prw;
@@ -37,6 +38,8 @@ void modelsMustBeEqual(const Model &a, const Model &b) {
         EXPECT_EQ(as.start(), bs->start());
         EXPECT_EQ(as.end(), bs->end());
         EXPECT_EQ(as.dir(), bs->dir());
+        EXPECT_EQ(as.length(), bs->length());
+        EXPECT_EQ(as.costMultiplier(), bs->costMultiplier());
 
         EXPECT_EQ(as.isDestination(), bs->isDestination());
         if (as.isDestination()) {
@@ -56,7 +59,17 @@ void modelsMustBeEqual(const Model &a, const Model &b) {
 void writeReadCheck(const Model &model) {
     std::stringstream buffer;
     writeModel(buffer, model);
+    modelsMustBeEqual(model, readModelBuffer(buffer.str()));
+    modelsMustBeEqual(model, readModelParallel(buffer.str(), 4));
     modelsMustBeEqual(model, readModel(buffer));
+
+    std::string compact;
+    writeModelBuffer(compact, model, {.pretty = false});
+    modelsMustBeEqual(model, readModelBuffer(compact));
+
+    std::string parallel;
+    writeModelBuffer(parallel, model, {.pretty = false, .threads = 4});
+    EXPECT_EQ(parallel, compact);
 }
 
 } // namespace
@@ -110,3 +123,249 @@ TEST(IoWriteRead, Maximal) {
 
     writeReadCheck(model);
 }
+
+namespace {
+
+Model maximalModel() {
+    Model model;
+
+    model.newNode(THRU, "n1");
+    model.newNode(MOTORIZED, "n2");
+    model.newNode(PASSIVE, "n3");
+    model.newNode(FIXED, "n4");
+    model.newNode(MANUAL, "n5");
+    model.newNode(CROSSING, "n6");
+    model.newNode(END, "n7");
+
+    model.node("n5")->metadata("n5-key1") = "apple";
+    model.node("n5")->metadata("n5-key2") = "orange";
+
+    model.newSection("s1", Section::AllowedTravel::BIDIR,
+                     std::make_unique<Destination>("1.0.1", "My Name"));
+    model.newSection("s2", Section::AllowedTravel::NONE, nullptr);
+    model.newSection("s3");
+
+    model.section("s1")->metadata("s1-key1") = "grape";
+    model.section("s1")->metadata("s1-key2") = "apple";
+
+    model.section("s1")->destination()->metadata("d-key1") = "tomato";
+    model.section("s1")->destination()->metadata("n5-key1") = "papaya";
+
+    model.section("s2")->setLength(12.5F);
+    model.section("s3")->setLength(0.1F);
+    model.section("s3")->setCostMultiplier(3);
+
+    model.link("s1", "n1", 0, "n2", 1);
+    model.link("s2", "n2", 2, "n6", 3);
+
+    return model;
+}
+
+std::string binarySnapshot(const Model &model) {
+    std::ostringstream out(std::ios_base::binary);
+    writeModelBinary(out, model);
+    return std::move(out).str();
+}
+
+/*
+ * A ring large enough to be split into many chunks by the parallel reader and
+ * writer.
+ */
+Model ringModel() {
+    constexpr int COUNT = 5000;
+    Model model;
+
+    for (int i = 0; i < COUNT; i++) {
+        auto index = std::to_string(i);
+        model.newNode(THRU, "n" + index);
+        model.newSection("s" + index, Section::AllowedTravel::BIDIR,
+                         i % 10 == 0 ? std::make_unique<Destination>(
+                                           "1." + index, "Dest " + index)
+                                     : nullptr);
+        model.section("s" + index)->metadata("k") = index;
+        model.section("s" + index)->setLength(static_cast<float>(i) / 7);
+    }
+    for (int i = 0; i < COUNT; i++) {
+        model.link("s" + std::to_string(i), "n" + std::to_string(i), 1,
+                   "n" + std::to_string((i + 1) % COUNT), 0);
+    }
+
+    return model;
+}
+
+Model fromBinary(const std::string &data) {
+    std::istringstream in(data, std::ios_base::binary);
+    return readModelBinary(in);
+}
+
+} // namespace
+
+TEST(IoWriteRead, Compact) {
+    Model model;
+    model.newNode(THRU, "n1");
+    model.newSection("s1", Section::AllowedTravel::BIDIR,
+                     std::make_unique<Destination>("1.0", "Name"));
+
+    std::string buffer;
+    writeModelBuffer(buffer, model, {.pretty = false});
+    EXPECT_EQ(buffer, R"([{"n1":{"type":"THRU"}},)"
+                      R"({"s1":{"dir":"BIDIR",)"
+                      R"("dest":{"address":"1.0","name":"Name"}}}])");
+
+    std::ostringstream stream;
+    writeModel(stream, model, {.pretty = false, .bufferSize = 4});
+    EXPECT_EQ(stream.str(), buffer);
+}
+
+TEST(IoWriteRead, Attributes) {
+    writeReadCheck(maximalModel());
+
+    Model model;
+    model.newSection("s1");
+    model.section("s1")->setLength(2.5F);
+    model.section("s1")->setCostMultiplier(0.1F);
+
+    std::string buffer;
+    writeModelBuffer(buffer, model, {.pretty = false});
+    EXPECT_EQ(buffer, R"([{},{"s1":{"dir":"UNIDIR",)"
+                      R"("length":2.5,"costMultiplier":0.1}}])");
+
+    EXPECT_THROW(readModelBuffer(R"([{},{"s1":{"length":-1}}])"),
+                 InvalidFormatError);
+}
+
+TEST(IoWriteRead, CompactEscapes) {
+    Model model;
+    model.newNode(THRU, "n1");
+    model.node("n1")->metadata("quote\"key") = "back\\slash";
+    model.node("n1")->metadata("controls") = std::string("\n\t\x01\0", 4);
+    model.node("n1")->metadata("utf8") = "\xc3\xa9/\x7f";
+    writeReadCheck(model);
+}
+
+TEST(IoWriteRead, Fd) {
+    Model model = maximalModel();
+    std::FILE *file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+
+    writeModelFd(fileno(file), model, {.pretty = false, .bufferSize = 64});
+
+    std::string data;
+    std::rewind(file);
+    for (int c = std::fgetc(file); c != EOF; c = std::fgetc(file)) {
+        data += static_cast<char>(c);
+    }
+    std::fclose(file);
+
+    modelsMustBeEqual(model, readModelBuffer(data));
+}
+
+TEST(IoWriteRead, Large) { writeReadCheck(ringModel()); }
+
+TEST(IoWriteRead, CompactParallel) {
+    Model model = ringModel();
+
+    std::string sequential;
+    writeModelBuffer(sequential, model, {.pretty = false});
+
+    for (unsigned threads : {0U, 2U, 7U}) {
+        std::ostringstream stream;
+        writeModel(stream, model, {.pretty = false, .threads = threads});
+        EXPECT_EQ(stream.str(), sequential);
+
+        std::string prefixed = "prefix";
+        writeModelBuffer(prefixed, model,
+                         {.pretty = false, .threads = threads});
+        EXPECT_EQ(prefixed, "prefix" + sequential);
+    }
+
+    std::FILE *file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    writeModelFd(fileno(file), model, {.pretty = false, .threads = 4});
+
+    std::string data;
+    std::rewind(file);
+    for (int c = std::fgetc(file); c != EOF; c = std::fgetc(file)) {
+        data += static_cast<char>(c);
+    }
+    std::fclose(file);
+    EXPECT_EQ(data, sequential);
+}
+
+TEST(IoWriteRead, ParallelErrors) {
+    // Errors late in the input must still be reported
+    std::stringstream buffer;
+    Model model;
+    for (int i = 0; i < 2000; i++) {
+        model.newSection("s" + std::to_string(i));
+    }
+    writeModel(buffer, model);
+
+    std::string text = buffer.str();
+    std::string head = text.substr(0, text.rfind('}'));
+
+    std::string broken = head + R"(, "s0": {}}])";
+    EXPECT_THROW(readModelParallel(broken, 4), IllegalModelError);
+
+    broken = head + R"(, "sX": {"x": 1}}])";
+    EXPECT_THROW(readModelParallel(broken, 4), InvalidFormatError);
+}
+
+TEST(IoWriteRead, Mapped) {
+    Model model = maximalModel();
+    std::string filename = ::testing::TempDir() + "io_wr_mapped.json";
+
+    writeModel(filename, model);
+    modelsMustBeEqual(model, readModelMapped(filename));
+
+    EXPECT_THROW(readModelMapped(filename + ".missing"),
+                 std::ios_base::failure);
+}
+
+TEST(IoBinary, Empty) {
+    Model model;
+    modelsMustBeEqual(model, fromBinary(binarySnapshot(model)));
+}
+
+TEST(IoBinary, Maximal) {
+    Model model = maximalModel();
+    modelsMustBeEqual(model, fromBinary(binarySnapshot(model)));
+}
+
+TEST(IoBinary, MatchesJson) {
+    std::stringstream json;
+    writeModel(json, maximalModel());
+    Model fromJson = readModel(json);
+
+    modelsMustBeEqual(fromJson, fromBinary(binarySnapshot(fromJson)));
+}
+
+TEST(IoBinary, File) {
+    Model model = maximalModel();
+    std::string filename = ::testing::TempDir() + "io_binary_file.prwbin";
+
+    writeModelBinary(filename, model);
+    modelsMustBeEqual(model, readModelBinary(filename));
+
+    EXPECT_THROW(readModelBinary(filename + ".missing"),
+                 std::ios_base::failure);
+}
+
+TEST(IoBinary, Corrupted) {
+    std::string data = binarySnapshot(maximalModel());
+
+    EXPECT_THROW(fromBinary(""), InvalidFormatError);
+    EXPECT_THROW(fromBinary(data.substr(0, data.size() - 1)),
+                 InvalidFormatError);
+
+    std::string badMagic = data;
+    badMagic[0] = 'X';
+    EXPECT_THROW(fromBinary(badMagic), InvalidFormatError);
+
+    // Flip a single bit in every byte, including the header, in turn
+    for (std::size_t i = 0; i < data.size(); i++) {
+        std::string flipped = data;
+        flipped[i] = static_cast<char>(flipped[i] ^ 0x10);
+        EXPECT_THROW(fromBinary(flipped), InvalidFormatError) << "byte " << i;
+    }
+}
@@ -0,0 +1,312 @@
+#include <gtest/gtest.h>
+
+#include <piwcsprwmodel.h>
+#include <piwcsprwmodel/journal.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+using namespace piwcs::prw;
+
+namespace {
+
+void modelsMustBeEqual(const Model &a, const Model &b) {
+    EXPECT_EQ(a.nodes().size(), b.nodes().size());
+    EXPECT_EQ(a.sections().size(), b.sections().size());
+
+    for (const auto &[id, an] : a.nodes()) {
+        const auto *bn = b.node(id);
+        ASSERT_NE(bn, nullptr);
+        EXPECT_EQ(an.type(), bn->type());
+        for (SlotId i = 0; i < an.sectionCount(); i++) {
+            EXPECT_EQ(an.section(i), bn->section(i));
+        }
+        EXPECT_EQ(an.hasMetadata(), bn->hasMetadata());
+        if (an.hasMetadata()) {
+            EXPECT_EQ(an.metadata(), bn->metadata());
+        }
+    }
+
+    for (const auto &[id, as] : a.sections()) {
+        const auto *bs = b.section(id);
+        ASSERT_NE(bs, nullptr);
+        EXPECT_EQ(as.start(), bs->start());
+        EXPECT_EQ(as.end(), bs->end());
+        EXPECT_EQ(as.startSlot(), bs->startSlot());
+        EXPECT_EQ(as.endSlot(), bs->endSlot());
+        EXPECT_EQ(as.dir(), bs->dir());
+        EXPECT_EQ(as.length(), bs->length());
+        EXPECT_EQ(as.costMultiplier(), bs->costMultiplier());
+        EXPECT_EQ(as.isDestination(), bs->isDestination());
+        if (as.isDestination()) {
+            EXPECT_EQ(as.destination()->address(),
+                      bs->destination()->address());
+            EXPECT_EQ(as.destination()->name(), bs->destination()->name());
+            EXPECT_EQ(as.destination()->metadata(),
+                      bs->destination()->metadata());
+        }
+        EXPECT_EQ(as.hasMetadata(), bs->hasMetadata());
+        if (as.hasMetadata()) {
+            EXPECT_EQ(as.metadata(), bs->metadata());
+        }
+    }
+}
+
+/*
+ * Applies a series of edits to model and records them in journal.
+ */
+void edit(Model &model, Journal &journal) {
+    Node n1(THRU, "n1");
+    n1.metadata("k") = "v";
+    journal.addNode(n1);
+    ASSERT_TRUE(!!model.addNode(std::move(n1)));
+
+    Node n2(MOTORIZED, "n2");
+    journal.addNode(n2);
+    ASSERT_TRUE(!!model.addNode(std::move(n2)));
+
+    Node n3(END, "n3");
+    journal.addNode(n3);
+    ASSERT_TRUE(!!model.addNode(std::move(n3)));
+
+    auto dest = std::make_unique<Destination>("1.0", "Station");
+    dest->metadata("dk") = "dv";
+    Section s1("s1", Section::AllowedTravel::BIDIR, std::move(dest));
+    s1.metadata("sk") = "sv";
+    s1.setLength(250);
+    journal.addSection(s1);
+    ASSERT_TRUE(!!model.addSection(std::move(s1)));
+
+    Section s2("s2");
+    journal.addSection(s2);
+    ASSERT_TRUE(!!model.addSection(std::move(s2)));
+
+    ASSERT_TRUE(!!model.link("s1", "n1", 0, "n2", 1));
+    journal.link("s1", "n1", 0, "n2", 1);
+    ASSERT_TRUE(!!model.link("s2", "n1", 1, "n3", 0));
+    journal.link("s2", "n1", 1, "n3", 0);
+    ASSERT_TRUE(!!model.unlink("s2"));
+    journal.unlink("s2");
+    ASSERT_TRUE(!!model.removeSection("s2"));
+    journal.removeSection("s2");
+    ASSERT_TRUE(!!model.removeNode("n3"));
+    journal.removeNode("n3");
+
+    model.node("n2")->metadata("new") = "value";
+    journal.setMetadata(Journal::Target::NODE, "n2", "new", "value");
+    model.section("s1")->metadata("sk") = "changed";
+    journal.setMetadata(Journal::Target::SECTION, "s1", "sk", "changed");
+    model.node("n1")->metadata().erase("k");
+    journal.eraseMetadata(Journal::Target::NODE, "n1", "k");
+    model.section("s1")->setCostMultiplier(1.5F);
+    journal.setAttributes("s1", 250, 1.5F);
+}
+
+constexpr std::size_t EDIT_COUNT = 14;
+
+std::string tempPath(const char *name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+std::string readFile(const std::string &filename) {
+    std::ifstream in(filename, std::ios_base::binary);
+    return {std::istreambuf_iterator<char>(in), {}};
+}
+
+void writeFile(const std::string &filename, const std::string &data) {
+    std::ofstream out(filename, std::ios_base::binary);
+    out << data;
+}
+
+} // namespace
+
+TEST(Journal, Replay) {
+    Model model;
+    std::stringstream buffer;
+    Journal journal(buffer);
+    edit(model, journal);
+    journal.flush();
+
+    Model replayed;
+    EXPECT_EQ(replayJournal(replayed, buffer), EDIT_COUNT);
+    modelsMustBeEqual(model, replayed);
+}
+
+TEST(Journal, Empty) {
+    std::stringstream buffer;
+    Journal journal(buffer);
+
+    Model model;
+    EXPECT_EQ(replayJournal(model, buffer), 0);
+
+    std::istringstream nothing;
+    EXPECT_EQ(replayJournal(model, nothing), 0);
+}
+
+TEST(Journal, TornTail) {
+    Model model;
+    std::stringstream buffer;
+    Journal journal(buffer);
+    edit(model, journal);
+
+    std::string data = buffer.str();
+    for (std::size_t cut = 1; cut < 8; cut++) {
+        std::istringstream in(data.substr(0, data.size() - cut));
+        Model replayed;
+        EXPECT_EQ(replayJournal(replayed, in), EDIT_COUNT - 1);
+    }
+}
+
+TEST(Journal, Corrupted) {
+    Model model;
+    std::stringstream buffer;
+    Journal journal(buffer);
+    edit(model, journal);
+    std::string data = buffer.str();
+
+    // Flip a bit in the payload of the last record
+    std::string corrupted = data;
+    corrupted[corrupted.size() - 2] ^= 0x10;
+    std::istringstream in(corrupted);
+    Model replayed;
+    EXPECT_THROW(replayJournal(replayed, in), InvalidFormatError);
+
+    std::string foreign = data;
+    foreign[0] = 'X';
+    std::istringstream foreignIn(foreign);
+    EXPECT_THROW(replayJournal(replayed, foreignIn), InvalidFormatError);
+}
+
+TEST(Journal, IllegalEdit) {
+    std::stringstream buffer;
+    Journal journal(buffer);
+    journal.addNode(Node(THRU, "n1"));
+    journal.addNode(Node(THRU, "n1"));
+
+    Model model;
+    EXPECT_THROW(replayJournal(model, buffer), IllegalModelError);
+
+    std::stringstream missing;
+    Journal other(missing);
+    other.link("s1", "n1", 0, "n2", 1);
+    EXPECT_THROW(replayJournal(model, missing), IllegalModelError);
+}
+
+TEST(Journal, Compaction) {
+    std::string snapshot = tempPath("piwcsprw-test-journal.prwbin");
+    std::string journalFile = tempPath("piwcsprw-test-journal.prwjnl");
+    std::filesystem::remove(journalFile);
+
+    writeModelBinary(snapshot, Model());
+    Model model = compactJournal(snapshot, journalFile);
+    {
+        Journal journal(journalFile);
+        edit(model, journal);
+    }
+    std::string stale = readFile(journalFile);
+
+    modelsMustBeEqual(model, compactJournal(snapshot, journalFile));
+    modelsMustBeEqual(model, readModelBinary(snapshot));
+
+    Model replayed = readModelBinary(snapshot);
+    EXPECT_EQ(replayJournal(replayed, journalFile), 0);
+
+    // Compaction interrupted before the journal was replaced
+    writeFile(journalFile, stale);
+    modelsMustBeEqual(model, compactJournal(snapshot, journalFile));
+
+    // Further edits go to the new journal
+    {
+        Journal journal(journalFile);
+        ASSERT_TRUE(!!model.unlink("s1"));
+        journal.unlink("s1");
+    }
+    modelsMustBeEqual(model, compactJournal(snapshot, journalFile));
+
+    std::filesystem::remove(snapshot);
+    std::filesystem::remove(journalFile);
+}
+
+TEST(Journal, CompactionInterruptedBetweenRenames) {
+    std::string snapshot = tempPath("piwcsprw-test-crash.prwbin");
+    std::string journalFile = tempPath("piwcsprw-test-crash.prwjnl");
+    std::filesystem::remove(journalFile);
+
+    writeModelBinary(snapshot, Model());
+    Model model = compactJournal(snapshot, journalFile);
+    {
+        Journal journal(journalFile);
+        edit(model, journal);
+    }
+
+    // The new snapshot replaced the old one, but the journal was not replaced
+    writeModelBinary(snapshot, model);
+
+    modelsMustBeEqual(model, compactJournal(snapshot, journalFile));
+    modelsMustBeEqual(model, readModelBinary(snapshot));
+
+    std::filesystem::remove(snapshot);
+    std::filesystem::remove(journalFile);
+}
+
+TEST(Journal, UnboundJournal) {
+    std::string snapshot = tempPath("piwcsprw-test-unbound.prwbin");
+    std::string journalFile = tempPath("piwcsprw-test-unbound.prwjnl");
+    std::filesystem::remove(journalFile);
+
+    // Journal files are only created by compactJournal
+    EXPECT_THROW(Journal journal(journalFile), std::ios_base::failure);
+    EXPECT_FALSE(std::filesystem::exists(journalFile));
+
+    writeModelBinary(snapshot, Model());
+    std::string before = readFile(snapshot);
+
+    std::stringstream buffer;
+    Model model;
+    Journal journal(buffer);
+    edit(model, journal);
+    writeFile(journalFile, buffer.str());
+
+    EXPECT_THROW(compactJournal(snapshot, journalFile), InvalidFormatError);
+    EXPECT_EQ(readFile(snapshot), before);
+
+    // An empty unbound journal has nothing to fold in
+    std::stringstream empty;
+    Journal emptyJournal(empty);
+    writeFile(journalFile, empty.str());
+    EXPECT_EQ(compactJournal(snapshot, journalFile).nodes().size(), 0);
+
+    std::filesystem::remove(snapshot);
+    std::filesystem::remove(journalFile);
+}
+
+TEST(Journal, ReopenAfterTornWrite) {
+    std::string snapshot = tempPath("piwcsprw-test-torn.prwbin");
+    std::string journalFile = tempPath("piwcsprw-test-torn.prwjnl");
+    std::filesystem::remove(journalFile);
+
+    writeModelBinary(snapshot, Model());
+    Model model = compactJournal(snapshot, journalFile);
+    {
+        Journal journal(journalFile);
+        edit(model, journal);
+    }
+
+    std::string data = readFile(journalFile);
+    writeFile(journalFile, data.substr(0, data.size() - 3));
+
+    {
+        // The partial record is dropped before new records are appended
+        Journal journal(journalFile);
+        journal.setAttributes("s1", 250, 1.5F);
+    }
+
+    Model replayed;
+    EXPECT_EQ(replayJournal(replayed, journalFile), EDIT_COUNT);
+    modelsMustBeEqual(model, replayed);
+
+    std::filesystem::remove(snapshot);
+    std::filesystem::remove(journalFile);
+}
@@ -2,6 +2,11 @@
 
 #include <piwcsprwmodel.h>
 
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
 using namespace piwcs::prw;
 
 TEST(Metadata, InitialState) {
@@ -67,3 +72,248 @@ TEST(Metadata, EmptyValVsNoVal) {
     EXPECT_TRUE(n.hasMetadata("k1"));
     EXPECT_EQ(cn.metadata("k1"), "");
 }
+
+TEST(Metadata, CopyAndErase) {
+    Node n(THRU, "n1");
+    n.metadata("k2") = "banana";
+    n.metadata("k1") = "apple";
+    n.metadata("k3") = "cherry";
+
+    Node copy = n;
+    EXPECT_EQ(copy.metadata(), n.metadata());
+    copy.metadata("k1") = "grape";
+    EXPECT_EQ(n.metadata("k1"), "apple");
+    EXPECT_NE(copy.metadata(), n.metadata());
+
+    // Records are visited in key order
+    std::string keys;
+    for (const auto &[key, value] : n.metadata()) {
+        keys += key;
+    }
+    EXPECT_EQ(keys, "k1k2k3");
+
+    auto &view = n.metadata();
+    EXPECT_EQ(view.erase("k2"), 1);
+    EXPECT_EQ(view.erase("k2"), 0);
+    view.erase(view.find("k1"));
+    EXPECT_EQ(view.size(), 1);
+    EXPECT_EQ(view.begin()->second, "cherry");
+    EXPECT_FALSE(n.hasMetadata("k1"));
+
+    view.erase("k3");
+    EXPECT_FALSE(n.hasMetadata());
+    Node empty = n;
+    EXPECT_TRUE(empty.metadata().empty());
+}
+
+TEST(Metadata, NoMetadataIsCompact) {
+    // Objects without metadata pay for a pointer to it and to an observer
+    EXPECT_EQ(sizeof(detail::HasMetadata), 2 * sizeof(void *));
+}
+
+TEST(Metadata, CopyOnWrite) {
+    Node a(THRU, "n1");
+    Node b(THRU, "n2");
+
+    MetadataTable table;
+    Metadata m1;
+    m1["k"] = "v";
+    Metadata m2 = m1;
+    table.assign(a, std::move(m1));
+    table.assign(b, std::move(m2));
+    EXPECT_EQ(table.size(), 1);
+
+    // Identical maps are stored once
+    EXPECT_EQ(&std::as_const(a).metadata(), &std::as_const(b).metadata());
+
+    // Writing gives the writer a private copy
+    a.metadata("k") = "changed";
+    EXPECT_EQ(a.metadata("k"), "changed");
+    EXPECT_EQ(std::as_const(b).metadata("k"), "v");
+
+    // Copies share metadata until it is written
+    Node c = b;
+    EXPECT_EQ(&std::as_const(c).metadata(), &std::as_const(b).metadata());
+    c.metadata("k2") = "v2";
+    EXPECT_FALSE(b.hasMetadata("k2"));
+
+    // Metadata that may be written through a reference is never shared
+    auto &view = a.metadata();
+    Node d = a;
+    view["k"] = "again";
+    EXPECT_EQ(std::as_const(d).metadata("k"), "changed");
+}
+
+TEST(Metadata, ReferenceOutlivesAssignment) {
+    Node a(THRU, "n1");
+    Node b(THRU, "n2");
+    b.metadata("k") = "b";
+
+    // The storage behind a writable reference is never replaced
+    auto &view = a.metadata();
+    view["k"] = "a";
+
+    a = b;
+    EXPECT_EQ(&a.metadata(), &view);
+    EXPECT_EQ(view.find("k")->second, "b");
+
+    Node c(THRU, "n3");
+    c.metadata("k") = "c";
+    a.shareMetadata(c);
+    EXPECT_EQ(view.find("k")->second, "c");
+
+    a = Node(THRU, "n4");
+    EXPECT_TRUE(view.empty());
+
+    MetadataTable table;
+    Metadata m;
+    m["k"] = "table";
+    table.assign(a, std::move(m));
+    EXPECT_EQ(view.find("k")->second, "table");
+    EXPECT_EQ(table.size(), 0);
+
+    // Writes after the assignments remain private to a
+    view["k"] = "private";
+    EXPECT_EQ(b.metadata("k"), "b");
+    EXPECT_EQ(c.metadata("k"), "c");
+
+    // Const views of unshared metadata reflect later writes
+    const auto &constView = std::as_const(c).metadata();
+    c.metadata("k") = "changed";
+    EXPECT_EQ(constView.find("k")->second, "changed");
+}
+
+TEST(Metadata, Stats) {
+    Model model;
+    MetadataTable table;
+    for (int i = 0; i < 10; i++) {
+        Node node(THRU, "n" + std::to_string(i));
+        Metadata metadata;
+        metadata["era"] = i < 8 ? "1970s" : "2020s";
+        table.assign(node, std::move(metadata));
+        model.addNode(std::move(node));
+    }
+    model.newNode(THRU, "plain");
+    model.newSection("s1");
+    model.section("s1")->metadata("k") = "v";
+
+    auto stats = model.metadataStats();
+    EXPECT_EQ(stats.objects, 11);
+    EXPECT_EQ(stats.stored, 3);
+    EXPECT_DOUBLE_EQ(stats.ratio(), 11.0 / 3);
+    EXPECT_DOUBLE_EQ(Model().metadataStats().ratio(), 1.0);
+}
+
+namespace {
+
+std::vector<std::string> sorted(const std::vector<IdRef> &ids) {
+    std::vector<std::string> result(ids.begin(), ids.end());
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+} // namespace
+
+TEST(Metadata, Index) {
+    using V = std::vector<std::string>;
+
+    Model model;
+    model.newNode(THRU, "n1");
+    model.node("n1")->metadata("signal") = "red";
+    model.newSection("s1");
+    model.section("s1")->metadata("maintainer") = "X";
+
+    for (bool indexed : {false, true}) {
+        model.setMetadataIndexed(indexed);
+        EXPECT_EQ(model.isMetadataIndexed(), indexed);
+
+        model.newNode(THRU, "n2");
+        model.node("n2")->metadata("signal") = "green";
+        model.newSection("s2");
+
+        EXPECT_EQ(sorted(model.nodesWithMetadata("signal")), (V{"n1", "n2"}));
+        EXPECT_EQ(sorted(model.nodesWithMetadata("signal", "red")), V{"n1"});
+        EXPECT_EQ(sorted(model.sectionsWithMetadata("maintainer", "X")),
+                  V{"s1"});
+        EXPECT_TRUE(model.sectionsWithMetadata("signal").empty());
+
+        // Edits through every part of the metadata API are followed
+        model.section("s2")->metadata("maintainer") = "X";
+        model.node("n1")->metadata("signal") = "green";
+        EXPECT_EQ(sorted(model.sectionsWithMetadata("maintainer", "X")),
+                  (V{"s1", "s2"}));
+        EXPECT_EQ(sorted(model.nodesWithMetadata("signal", "green")),
+                  (V{"n1", "n2"}));
+        EXPECT_TRUE(model.nodesWithMetadata("signal", "red").empty());
+
+        model.node("n1")->metadata().erase("signal");
+        model.section("s2")->shareMetadata(Section("plain"));
+        EXPECT_EQ(sorted(model.nodesWithMetadata("signal")), V{"n2"});
+        EXPECT_EQ(sorted(model.sectionsWithMetadata("maintainer")), V{"s1"});
+
+        MetadataTable table;
+        Metadata metadata;
+        metadata["signal"] = "red";
+        table.assign(*model.node("n1"), std::move(metadata));
+        EXPECT_EQ(sorted(model.nodesWithMetadata("signal", "red")), V{"n1"});
+
+        EXPECT_TRUE(!!model.removeNode("n2"));
+        EXPECT_EQ(sorted(model.nodesWithMetadata("signal")), V{"n1"});
+
+        // Restore the initial state
+        EXPECT_TRUE(!!model.removeSection("s2"));
+        model.node("n1")->metadata("signal") = "red";
+    }
+}
+
+TEST(Metadata, IndexFollowsHeldReferences) {
+    using V = std::vector<std::string>;
+
+    Model model;
+    model.setMetadataIndexed(true);
+    model.newNode(THRU, "n1");
+    model.newSection("s1");
+
+    std::string &value = model.node("n1")->metadata("maint");
+    value = "A";
+    EXPECT_EQ(sorted(model.nodesWithMetadata("maint", "A")), V{"n1"});
+
+    value = "B";
+    EXPECT_EQ(sorted(model.nodesWithMetadata("maint", "B")), V{"n1"});
+    EXPECT_TRUE(model.nodesWithMetadata("maint", "A").empty());
+
+    Metadata &metadata = model.section("s1")->metadata();
+    EXPECT_TRUE(model.sectionsWithMetadata("maint").empty());
+    metadata["maint"] = "C";
+    EXPECT_EQ(sorted(model.sectionsWithMetadata("maint", "C")), V{"s1"});
+    metadata.clear();
+    EXPECT_TRUE(model.sectionsWithMetadata("maint").empty());
+
+    EXPECT_TRUE(!!model.removeNode("n1"));
+    EXPECT_TRUE(model.nodesWithMetadata("maint").empty());
+}
+
+TEST(Metadata, IndexSurvivesRehash) {
+    Model model;
+    model.setMetadataIndexed(true);
+
+    constexpr int COUNT = 3000;
+    for (int i = 0; i < COUNT; i++) {
+        auto id = "n" + std::to_string(i);
+        model.newNode(THRU, id);
+        model.node(id)->metadata("parity") = i % 2 == 0 ? "even" : "odd";
+        if (i % 1000 == 0) {
+            EXPECT_EQ(model.nodesWithMetadata("parity").size(), i + 1);
+        }
+    }
+    for (int i = 0; i < COUNT; i += 2) {
+        model.node("n" + std::to_string(i))->metadata("parity") = "odd";
+    }
+    EXPECT_EQ(model.nodesWithMetadata("parity", "odd").size(), COUNT);
+
+    // The index follows the Model when it is moved
+    Model moved = std::move(model);
+    moved.node("n0")->metadata("parity") = "even";
+    EXPECT_EQ(moved.nodesWithMetadata("parity", "even").size(), 1);
+    EXPECT_GT(moved.memoryUsage().indices, 0);
+}
@@ -2,6 +2,9 @@
 
 #include <piwcsprwmodel.h>
 
+#include <string>
+#include <vector>
+
 using namespace piwcs::prw;
 
 TEST(Identifiers, Validators) {
@@ -16,6 +19,37 @@ TEST(Identifiers, Validators) {
     EXPECT_FALSE(isId(ID_INVALID));
 }
 
+TEST(Identifiers, InlineId) {
+    EXPECT_TRUE(InlineId::fits("123"));
+    EXPECT_TRUE(InlineId::fits(ID_NULL));
+    EXPECT_TRUE(InlineId::fits(Identifier(IDENT_LENGTH, '1')));
+    EXPECT_FALSE(InlineId::fits(Identifier(IDENT_LENGTH + 1, '1')));
+    EXPECT_FALSE(InlineId::fits(IdRef("1\0", 2)));
+
+    InlineId a("123");
+    InlineId b(Identifier("123"));
+    InlineId c("124");
+    InlineId longest(Identifier(IDENT_LENGTH, 'x'));
+
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a, c);
+    EXPECT_EQ(InlineId(), InlineId(ID_NULL));
+    EXPECT_NE(a, InlineId());
+
+    EXPECT_EQ(a.view(), "123");
+    EXPECT_EQ(a.size(), 3);
+    EXPECT_EQ(InlineId().view(), ID_NULL);
+    EXPECT_EQ(longest.view(), Identifier(IDENT_LENGTH, 'x'));
+
+    // Hashes must agree for heterogeneous lookup
+    IdHash hash;
+    EXPECT_EQ(a.hash(), hash(IdRef("123")));
+    EXPECT_EQ(a.hash(), hash(Identifier("123")));
+    EXPECT_EQ(a.hash(), hash("123"));
+    EXPECT_EQ(hash(a), hash(IdRef("123")));
+    EXPECT_EQ(longest.hash(), hash(Identifier(IDENT_LENGTH, 'x')));
+}
+
 TEST(Model, Constructor) {
     Model model;
 
@@ -157,8 +191,12 @@ TEST(Model, Link) {
         EXPECT_EQ(n2->section(1), s1->id());
         EXPECT_EQ(s1->start(), n1->id());
         EXPECT_EQ(s1->end(), n2->id());
+        EXPECT_EQ(s1->startSlot(), 0);
+        EXPECT_EQ(s1->endSlot(), 1);
         EXPECT_EQ(s2->start(), ID_NULL);
         EXPECT_EQ(s2->end(), ID_NULL);
+        EXPECT_EQ(s2->startSlot(), SLOT_INVALID);
+        EXPECT_EQ(s2->endSlot(), SLOT_INVALID);
     };
 
     // OK
@@ -271,8 +309,12 @@ TEST(Model, UnlinkFailure) {
         EXPECT_EQ(n2->section(1), s1->id());
         EXPECT_EQ(s1->start(), n1->id());
         EXPECT_EQ(s1->end(), n2->id());
+        EXPECT_EQ(s1->startSlot(), 0);
+        EXPECT_EQ(s1->endSlot(), 1);
         EXPECT_EQ(s2->start(), ID_NULL);
         EXPECT_EQ(s2->end(), ID_NULL);
+        EXPECT_EQ(s2->startSlot(), SLOT_INVALID);
+        EXPECT_EQ(s2->endSlot(), SLOT_INVALID);
     };
     checkStatusQuo();
 
@@ -311,6 +353,221 @@ TEST(Model, Unlink) {
     EXPECT_EQ(n2->section(1), ID_NULL);
     EXPECT_EQ(s1->start(), ID_NULL);
     EXPECT_EQ(s1->end(), ID_NULL);
+    EXPECT_EQ(s1->startSlot(), SLOT_INVALID);
+    EXPECT_EQ(s1->endSlot(), SLOT_INVALID);
     EXPECT_EQ(s2->start(), n1->id());
     EXPECT_EQ(s2->end(), n2->id());
+    EXPECT_EQ(s2->startSlot(), 1);
+    EXPECT_EQ(s2->endSlot(), 0);
+}
+
+TEST(Model, FindSectionByAddress) {
+    Model model;
+
+    model.newSection("s1", Section::AllowedTravel::UNIDIR,
+                     std::make_unique<Destination>("1.0.0", "Name1"));
+    model.newSection("s2", Section::AllowedTravel::UNIDIR,
+                     std::make_unique<Destination>("1.0.1", "Name2"));
+    model.newSection("s3");
+
+    const Section *section = model.sectionByAddress("1.0.1");
+    EXPECT_NE(section, nullptr);
+    EXPECT_EQ(section->id(), "s2");
+
+    section = model.sectionByAddress("1.0.0");
+    EXPECT_NE(section, nullptr);
+    EXPECT_EQ(section->id(), "s1");
+
+    section = model.sectionByAddress("1.0.2");
+    EXPECT_EQ(section, nullptr);
+
+    section = model.sectionByAddress("");
+    EXPECT_EQ(section, nullptr);
+}
+
+TEST(Model, RemoveSectionWithDestination) {
+    Model model;
+
+    model.newSection("s1", Section::AllowedTravel::UNIDIR,
+                     std::make_unique<Destination>("1.0.0", "Name1"));
+
+    auto res = model.removeSection("s1");
+    EXPECT_EQ(res, Model::RemoveResult::OK);
+    EXPECT_EQ(model.sectionByAddress("1.0.0"), nullptr);
+
+    auto addRes =
+        model.newSection("s2", Section::AllowedTravel::UNIDIR,
+                         std::make_unique<Destination>("1.0.0", "Name2"));
+    EXPECT_EQ(addRes, Model::AddResult::OK);
+    EXPECT_NE(model.sectionByAddress("1.0.0"), nullptr);
+    EXPECT_EQ(model.sectionByAddress("1.0.0")->id(), "s2");
+}
+
+TEST(Model, SharedIdentifiers) {
+    Model model;
+    EXPECT_TRUE(!!model.newSection("s1"));
+    EXPECT_TRUE(!!model.newNode(THRU, "n1"));
+    EXPECT_TRUE(!!model.newNode(CROSSING, "n2"));
+    EXPECT_TRUE(!!model.link("s1", "n1", 0, "n2", 3));
+
+    auto n1 = model.node("n1");
+    auto n2 = model.node("n2");
+    auto s1 = model.section("s1");
+
+    // Both nodes refer to one stored copy of the section ID
+    EXPECT_EQ(n1->section(0).data(), n2->section(3).data());
+
+    EXPECT_EQ(n2->section(4), ID_INVALID);
+    EXPECT_EQ(n2->slotOf("s1"), 3);
+    EXPECT_EQ(s1->start(), "n1");
+    EXPECT_EQ(s1->end(), "n2");
+
+    // IDs remain resolvable after relinking
+    EXPECT_TRUE(!!model.unlink("s1"));
+    EXPECT_TRUE(!!model.link("s1", "n2", 0, "n1", 1));
+    EXPECT_EQ(n1->section(1), "s1");
+    EXPECT_EQ(n2->section(0), "s1");
+    EXPECT_EQ(n2->section(3), ID_NULL);
+    EXPECT_EQ(s1->start(), "n2");
+    EXPECT_EQ(s1->end(), "n1");
+}
+
+TEST(Model, LongIdentifiers) {
+    Identifier longSection(IDENT_LENGTH + 10, 's');
+    Identifier longNode(IDENT_LENGTH + 10, 'n');
+
+    Model model;
+    EXPECT_TRUE(!!model.newSection(longSection));
+    EXPECT_TRUE(!!model.newNode(THRU, longNode));
+    EXPECT_TRUE(!!model.newNode(THRU, "n2"));
+    EXPECT_TRUE(!!model.link(longSection, longNode, 1, "n2", 0));
+
+    EXPECT_EQ(model.node(longNode)->section(1), longSection);
+    EXPECT_EQ(model.node(longNode)->slotOf(longSection), 1);
+    EXPECT_EQ(model.node("n2")->slotOf(longSection), 0);
+    EXPECT_EQ(model.section(longSection)->start(), longNode);
+
+    EXPECT_TRUE(!!model.unlink(longSection));
+    EXPECT_EQ(model.node(longNode)->section(1), ID_NULL);
+}
+
+TEST(Model, Handles) {
+    Model model;
+    EXPECT_TRUE(!!model.newNode(THRU, "n1"));
+    EXPECT_TRUE(!!model.newSection("s1"));
+
+    NodeHandle n1 = model.nodeHandle("n1");
+    SectionHandle s1 = model.sectionHandle("s1");
+    ASSERT_TRUE(n1);
+    ASSERT_TRUE(s1);
+    EXPECT_EQ(model.node(n1), model.node("n1"));
+    EXPECT_EQ(model.section(s1), model.section("s1"));
+    EXPECT_EQ(model.nodeHandle("n1"), n1);
+
+    EXPECT_FALSE(model.nodeHandle("n2"));
+    EXPECT_FALSE(model.sectionHandle("n1"));
+    EXPECT_EQ(model.node(NodeHandle()), nullptr);
+    EXPECT_EQ(model.section(SectionHandle()), nullptr);
+
+    // Removal invalidates handles, even if the entry is reused
+    EXPECT_TRUE(!!model.removeNode("n1"));
+    EXPECT_EQ(model.node(n1), nullptr);
+    EXPECT_TRUE(!!model.newNode(END, "n2"));
+    EXPECT_EQ(model.node(n1), nullptr);
+    EXPECT_NE(model.nodeHandle("n2"), n1);
+    EXPECT_EQ(model.node(model.nodeHandle("n2"))->id(), "n2");
+
+    EXPECT_TRUE(!!model.removeSection("s1"));
+    EXPECT_EQ(model.section(s1), nullptr);
+}
+
+TEST(Model, HandlesSurviveRehash) {
+    constexpr int COUNT = 5000;
+
+    Model model;
+    std::vector<NodeHandle> handles;
+    for (int i = 0; i < COUNT; i++) {
+        std::string id = "n" + std::to_string(i);
+        EXPECT_TRUE(!!model.newNode(THRU, id));
+        handles.push_back(model.nodeHandle(id));
+
+        // Churn causes in-place rehashes as well as growth
+        EXPECT_TRUE(!!model.newNode(THRU, "tmp"));
+        EXPECT_TRUE(!!model.removeNode("tmp"));
+    }
+
+    Model moved = std::move(model);
+    for (int i = 0; i < COUNT; i++) {
+        const Node *node = moved.node(handles[i]);
+        ASSERT_NE(node, nullptr);
+        EXPECT_EQ(node->id(), "n" + std::to_string(i));
+    }
+}
+
+TEST(Model, ReuseMovedFrom) {
+    Model model;
+    EXPECT_TRUE(!!model.newNode(THRU, "n1"));
+    EXPECT_TRUE(!!model.newNode(THRU, "n2"));
+    EXPECT_TRUE(!!model.newSection("s1"));
+
+    Model moved = std::move(model);
+    EXPECT_EQ(moved.nodes().size(), 2);
+
+    // NOLINTBEGIN(*-use-after-move)
+    EXPECT_TRUE(model.nodes().empty());
+    EXPECT_TRUE(model.sections().empty());
+    EXPECT_EQ(model.unlinkedSectionCount(), 0);
+    EXPECT_TRUE(isComplete(model));
+    EXPECT_EQ(model.memoryUsage().identifiers, 0);
+
+    EXPECT_TRUE(!!model.newNode(THRU, "n1"));
+    EXPECT_TRUE(!!model.newNode(THRU, "n2"));
+    EXPECT_TRUE(!!model.newSection("s1"));
+    EXPECT_TRUE(!!model.link("s1", "n1", 1, "n2", 0));
+    EXPECT_EQ(model.node("n1")->section(1), "s1");
+    EXPECT_EQ(model.section("s1")->end(), "n2");
+    EXPECT_GT(model.memoryUsage().identifiers, 0);
+
+    moved = std::move(model);
+    EXPECT_EQ(moved.section("s1")->start(), "n1");
+    EXPECT_TRUE(model.nodes().empty());
+    EXPECT_TRUE(!!model.newNode(THRU, "n3"));
+    // NOLINTEND(*-use-after-move)
+}
+
+TEST(Model, MemoryUsage) {
+    Model model;
+    auto empty = model.memoryUsage();
+    EXPECT_EQ(empty.nodes, 0);
+    EXPECT_EQ(empty.sections, 0);
+    EXPECT_EQ(empty.metadata, 0);
+    EXPECT_EQ(empty.destinations, 0);
+
+    EXPECT_TRUE(!!model.newNode(THRU, "n1"));
+    EXPECT_TRUE(!!model.newNode(THRU, "n2"));
+    auto nodes = model.memoryUsage();
+    EXPECT_EQ(nodes.nodes, 2 * sizeof(IdMap<Node>::value_type));
+    EXPECT_GT(nodes.indices, empty.indices);
+    EXPECT_EQ(nodes.sections, 0);
+
+    EXPECT_TRUE(!!model.newSection(
+        "s1", Section::AllowedTravel::UNIDIR,
+        std::make_unique<Destination>("1.0", "Station")));
+    auto sections = model.memoryUsage();
+    EXPECT_EQ(sections.sections, sizeof(IdMap<Section>::value_type));
+    EXPECT_GE(sections.destinations, sizeof(Destination));
+
+    model.node("n1")->metadata("key") = std::string(100, 'v');
+    auto metadata = model.memoryUsage();
+    EXPECT_GT(metadata.metadata, 100);
+    EXPECT_EQ(metadata.nodes, sections.nodes);
+
+    // Long identifiers are stored outside of the entities
+    EXPECT_TRUE(!!model.newSection(std::string(100, 's')));
+    EXPECT_GE(model.memoryUsage().identifiers, metadata.identifiers + 200);
+
+    auto usage = model.memoryUsage();
+    EXPECT_EQ(usage.total(), usage.nodes + usage.sections + usage.identifiers +
+                                 usage.indices + usage.metadata +
+                                 usage.destinations);
 }
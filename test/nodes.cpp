@@ -203,3 +203,29 @@ TEST(Nodes, SlotOf) {
     EXPECT_EQ(model.node("n2")->slotOf("s3"), SLOT_INVALID);
     EXPECT_EQ(model.node("n2")->slotOf("s4"), SLOT_INVALID);
 }
+
+TEST(NodeTraits, Constexpr) {
+    static_assert(THRU->slotCount == 2);
+    static_assert(THRU->couldTraverse(0, 1));
+    static_assert(!PASSIVE->couldTraverse(0, 1));
+    static_assert(MOTORIZED->successors(COMMON) == 0b110);
+    static_assert(CROSSING->successors(2) == 0b1000);
+    static_assert(END->successors(0) == 0);
+    static_assert(FIXED->successors(SLOT_INVALID) == 0);
+}
+
+TEST(NodeTraits, SuccessorsMatchTransitions) {
+    for (NodeType type :
+         {THRU, MOTORIZED, PASSIVE, FIXED, MANUAL, CROSSING, END}) {
+        Node node(type, "123");
+        for (SlotId from = 0; from <= Node::MAX_SLOTS; from++) {
+            unsigned expected = 0;
+            for (SlotId to = 0; to < Node::MAX_SLOTS; to++) {
+                if (node.couldTraverse(from, to)) {
+                    expected |= 1U << to;
+                }
+            }
+            EXPECT_EQ(node.successors(from), expected) << type->name;
+        }
+    }
+}
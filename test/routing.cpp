@@ -0,0 +1,221 @@
+#include <gtest/gtest.h>
+
+#include <piwcsprwmodel.h>
+
+using namespace piwcs::prw;
+
+namespace {
+
+/*
+ * A loop with a passing siding:
+ *
+ *   s0: P1.0 -> M1.0
+ *   s1: M1.1 -> T1.0, s2: T1.1 -> P1.1 (destination 1.0.1)
+ *   s3: M1.2 -> P1.2 (destination 1.0.0)
+ *
+ * A bidirectional line:
+ *
+ *   s5: E1.0 <-> T3.0 (destination 4), s6: T3.1 <-> E2.0 (destination 3)
+ *
+ * An isolated section s9 (destination 2.0.0)
+ */
+Model testModel() {
+    Model model;
+    model.newNode(MOTORIZED, "M1");
+    model.newNode(PASSIVE, "P1");
+    model.newNode(THRU, "T1");
+    model.newNode(END, "E1");
+    model.newNode(THRU, "T3");
+    model.newNode(END, "E2");
+
+    auto dest = [](const char *address) {
+        return std::make_unique<Destination>(address, address);
+    };
+
+    model.newSection("s0");
+    model.newSection("s1");
+    model.newSection("s2", Section::AllowedTravel::UNIDIR, dest("1.0.1"));
+    model.newSection("s3", Section::AllowedTravel::UNIDIR, dest("1.0.0"));
+    model.newSection("s5", Section::AllowedTravel::BIDIR, dest("4"));
+    model.newSection("s6", Section::AllowedTravel::BIDIR, dest("3"));
+    model.newSection("s9", Section::AllowedTravel::UNIDIR, dest("2.0.0"));
+
+    model.link("s0", "P1", 0, "M1", 0);
+    model.link("s1", "M1", 1, "T1", 0);
+    model.link("s2", "T1", 1, "P1", 1);
+    model.link("s3", "M1", 2, "P1", 2);
+    model.link("s5", "E1", 0, "T3", 0);
+    model.link("s6", "T3", 1, "E2", 0);
+
+    return model;
+}
+
+std::vector<std::string> ids(const CompiledModel &model, const Route &route) {
+    std::vector<std::string> result;
+    for (const auto &state : route) {
+        result.emplace_back(model.sectionId(state.section));
+        if (state.reversed) {
+            result.back() += '~';
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(Routing, Successors) {
+    CompiledModel compiled(testModel());
+    Router router(compiled);
+
+    auto s0 = compiled.sectionIndex("s0");
+    auto s1 = compiled.sectionIndex("s1");
+    auto s3 = compiled.sectionIndex("s3");
+
+    auto next = router.successors({s0, false});
+    ASSERT_EQ(next.size(), 2);
+    EXPECT_EQ(next[0], (TrackState{s1, false}));
+    EXPECT_EQ(next[1], (TrackState{s3, false}));
+
+    EXPECT_TRUE(router.successors({s0, true}).empty());
+    EXPECT_EQ(router.successors({s3, false}).size(), 1);
+}
+
+TEST(Routing, Basic) {
+    CompiledModel compiled(testModel());
+    Router router(compiled);
+
+    auto s0 = compiled.sectionIndex("s0");
+    auto s3 = compiled.sectionIndex("s3");
+
+    using V = std::vector<std::string>;
+    EXPECT_EQ(ids(compiled, router.route({s0, false}, "1.0.0")),
+              (V{"s0", "s3"}));
+    EXPECT_EQ(ids(compiled, router.route({s0, false}, "1.0.1")),
+              (V{"s0", "s1", "s2"}));
+    EXPECT_EQ(ids(compiled, router.route({s3, false}, "1.0.1")),
+              (V{"s3", "s0", "s1", "s2"}));
+    EXPECT_EQ(ids(compiled, router.route({s3, false}, "1.0.0")), (V{"s3"}));
+}
+
+TEST(Routing, Unreachable) {
+    CompiledModel compiled(testModel());
+    Router router(compiled);
+
+    auto s0 = compiled.sectionIndex("s0");
+
+    EXPECT_TRUE(router.route({s0, false}, "2.0.0").empty());
+    EXPECT_TRUE(router.route({s0, false}, "3").empty());
+    EXPECT_TRUE(router.route({s0, false}, "9.9.9").empty());
+    EXPECT_TRUE(router.route({s0, true}, "1.0.0").empty());
+    EXPECT_TRUE(router.route({CompiledModel::NONE, false}, "1.0.0").empty());
+}
+
+TEST(Routing, Bidirectional) {
+    CompiledModel compiled(testModel());
+    Router router(compiled);
+
+    auto s5 = compiled.sectionIndex("s5");
+    auto s6 = compiled.sectionIndex("s6");
+
+    using V = std::vector<std::string>;
+    EXPECT_EQ(ids(compiled, router.route({s5, false}, "3")), (V{"s5", "s6"}));
+    EXPECT_EQ(ids(compiled, router.route({s6, true}, "4")), (V{"s6~", "s5~"}));
+    EXPECT_EQ(ids(compiled, router.route({s5, true}, "4")), (V{"s5~"}));
+    EXPECT_TRUE(router.route({s5, true}, "3").empty());
+}
+
+TEST(Routing, Precompute) {
+    CompiledModel compiled(testModel());
+    Router router(compiled);
+    router.precompute();
+
+    auto s0 = compiled.sectionIndex("s0");
+    EXPECT_EQ(router.route({s0, false}, "1.0.1").size(), 3);
+}
+
+TEST(SwitchTable, Basic) {
+    CompiledModel compiled(testModel());
+    Router router(compiled);
+    SwitchTable table(router);
+
+    auto m1 = compiled.nodeIndex("M1");
+    ASSERT_EQ(table.nodes(), std::vector<CompiledModel::Index>{m1});
+    ASSERT_EQ(table.destinationCount(), compiled.destinationCount());
+
+    auto choice = [&](const char *address) {
+        return table.choice(m1, compiled.destinationIndex(address));
+    };
+
+    EXPECT_EQ(choice("1.0.0"), SwitchTable::Choice::DIVERGING);
+    EXPECT_EQ(choice("1.0.1"), SwitchTable::Choice::STRAIGHT);
+    EXPECT_EQ(choice("2.0.0"), SwitchTable::Choice::NONE);
+    EXPECT_EQ(choice("3"), SwitchTable::Choice::NONE);
+
+    auto p1 = compiled.nodeIndex("P1");
+    EXPECT_EQ(table.choice(p1, compiled.destinationIndex("1.0.0")),
+              SwitchTable::Choice::NONE);
+}
+
+TEST(SwitchTable, PreferStraight) {
+    Model model;
+    model.newNode(MOTORIZED, "M1");
+    model.newNode(PASSIVE, "P1");
+    model.newNode(THRU, "T1");
+    model.newSection("s1");
+    model.newSection("s2");
+    model.newSection("s3", Section::AllowedTravel::UNIDIR,
+                     std::make_unique<Destination>("1", "1"));
+    model.newSection("s4");
+    model.link("s1", "M1", 1, "P1", 1);
+    model.link("s2", "M1", 2, "P1", 2);
+    model.link("s3", "P1", 0, "T1", 0);
+    model.link("s4", "T1", 1, "M1", 0);
+
+    CompiledModel compiled(model);
+    Router router(compiled);
+    SwitchTable table(router);
+
+    EXPECT_EQ(table.choice(compiled.nodeIndex("M1"), 0),
+              SwitchTable::Choice::STRAIGHT);
+}
+
+TEST(SwitchTable, Threads) {
+    // Many MOTORIZED nodes in a line, each with a destination on its
+    // diverging track that leads back to the line
+
+    Model model;
+    constexpr int COUNT = 37;
+    for (int i = 0; i < COUNT; i++) {
+        auto index = std::to_string(i);
+        model.newNode(MOTORIZED, "M" + index);
+        model.newNode(PASSIVE, "P" + index);
+        model.newSection("a" + index);
+        model.newSection("d" + index, Section::AllowedTravel::UNIDIR,
+                         std::make_unique<Destination>(index, index));
+        model.newSection("b" + index);
+        model.link("a" + index, "M" + index, 1, "P" + index, 1);
+        model.link("d" + index, "M" + index, 2, "P" + index, 2);
+    }
+    for (int i = 0; i < COUNT; i++) {
+        model.link("b" + std::to_string(i), "P" + std::to_string(i), 0,
+                   "M" + std::to_string((i + 1) % COUNT), 0);
+    }
+
+    CompiledModel compiled(model);
+    Router router(compiled);
+    SwitchTable single(router, 1);
+    SwitchTable multi(router, 4);
+
+    for (auto node : single.nodes()) {
+        for (CompiledModel::Index d = 0; d < compiled.destinationCount();
+             d++) {
+            EXPECT_EQ(single.choice(node, d), multi.choice(node, d));
+
+            auto expected = compiled.nodeId(node).substr(1) ==
+                                    compiled.destinationAddress(d)
+                                ? SwitchTable::Choice::DIVERGING
+                                : SwitchTable::Choice::STRAIGHT;
+            EXPECT_EQ(single.choice(node, d), expected);
+        }
+    }
+}
@@ -2,6 +2,8 @@
 
 #include <piwcsprwmodel.h>
 
+#include <limits>
+
 using namespace piwcs::prw;
 
 TEST(Section, Constructor) {
@@ -69,3 +71,25 @@ TEST(Section, AllowedRoutesForbidden) {
     EXPECT_FALSE(section.canTraverse(0, 0));
     EXPECT_FALSE(section.canTraverse(1, 1));
 }
+
+TEST(Section, Attributes) {
+    Section section("123");
+    EXPECT_EQ(section.length(), Section::DEFAULT_LENGTH);
+    EXPECT_EQ(section.costMultiplier(), Section::DEFAULT_COST_MULTIPLIER);
+    EXPECT_EQ(section.cost(), 1);
+
+    EXPECT_TRUE(section.setLength(20));
+    EXPECT_TRUE(section.setCostMultiplier(0.5F));
+    EXPECT_EQ(section.cost(), 10);
+
+    // Invalid values are rejected and leave the attributes unchanged
+    EXPECT_FALSE(section.setLength(-1));
+    EXPECT_FALSE(section.setLength(std::numeric_limits<float>::infinity()));
+    EXPECT_FALSE(
+        section.setCostMultiplier(std::numeric_limits<float>::quiet_NaN()));
+    EXPECT_EQ(section.length(), 20);
+    EXPECT_EQ(section.costMultiplier(), 0.5F);
+
+    EXPECT_TRUE(section.setLength(0));
+    EXPECT_EQ(section.cost(), 0);
+}
@@ -0,0 +1,233 @@
+#include <gtest/gtest.h>
+
+#include <piwcsprwmodel.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace piwcs::prw;
+
+namespace {
+
+/*
+ * Creates a chain of `count` THRU nodes n0..n(count-1) linked by sections
+ * s0..s(count-2).
+ */
+Model chainModel(std::size_t count) {
+    Model model;
+    for (std::size_t i = 0; i < count; i++) {
+        model.newNode(THRU, "n" + std::to_string(i));
+    }
+    for (std::size_t i = 0; i + 1 < count; i++) {
+        std::string id = "s" + std::to_string(i);
+        model.newSection(id);
+        model.link(id, "n" + std::to_string(i), 1,
+                   "n" + std::to_string(i + 1), 0);
+    }
+    return model;
+}
+
+} // namespace
+
+TEST(ModelStore, Publish) {
+    ModelStore store(chainModel(3));
+
+    auto first = store.snapshot();
+    EXPECT_EQ(first->version(), 1);
+    EXPECT_EQ(first->nodeCount(), 3);
+    EXPECT_EQ(first->sectionCount(), 2);
+
+    // Nothing changed
+    EXPECT_EQ(store.publish(), first);
+
+    ASSERT_EQ(store.addNode(Node(END, "n3")), Model::AddResult::OK);
+    EXPECT_EQ(store.snapshot(), first);
+    EXPECT_EQ(first->node("n3"), nullptr);
+
+    auto second = store.publish();
+    EXPECT_EQ(store.snapshot(), second);
+    EXPECT_EQ(second->version(), 2);
+    EXPECT_EQ(second->nodeCount(), 4);
+    ASSERT_NE(second->node("n3"), nullptr);
+    EXPECT_EQ(second->node("n3")->type(), END);
+
+    ModelStore empty;
+    EXPECT_EQ(empty.snapshot()->version(), 1);
+    EXPECT_EQ(empty.snapshot()->nodeCount(), 0);
+    EXPECT_EQ(empty.snapshot()->node("n0"), nullptr);
+}
+
+TEST(ModelStore, Isolation) {
+    ModelStore store(chainModel(3));
+    auto old = store.snapshot();
+
+    ASSERT_EQ(store.unlink("s1"), Model::UnlinkResult::OK);
+    ASSERT_EQ(store.removeSection("s1"), Model::RemoveResult::OK);
+    ASSERT_EQ(store.removeNode("n2"), Model::RemoveResult::OK);
+    store.node("n0")->metadata("k") = "v";
+    auto current = store.publish();
+
+    // The old snapshot is unaffected
+    ASSERT_NE(old->section("s1"), nullptr);
+    EXPECT_EQ(old->section("s1")->start(), "n1");
+    EXPECT_EQ(old->section("s1")->end(), "n2");
+    EXPECT_EQ(old->node("n1")->section(1), "s1");
+    EXPECT_NE(old->node("n2"), nullptr);
+    EXPECT_FALSE(old->node("n0")->hasMetadata());
+
+    EXPECT_EQ(current->section("s1"), nullptr);
+    EXPECT_EQ(current->node("n2"), nullptr);
+    EXPECT_EQ(current->node("n1")->section(1), ID_NULL);
+    EXPECT_EQ(current->node("n1")->section(0), "s0");
+    EXPECT_EQ(current->node("n0")->metadata("k"), "v");
+    EXPECT_EQ(current->nodeCount(), 2);
+    EXPECT_EQ(current->sectionCount(), 1);
+}
+
+TEST(ModelStore, Sharing) {
+    ModelStore store(chainModel(1000));
+    auto old = store.snapshot();
+
+    store.node("n500")->metadata("k") = "v";
+    auto current = store.publish();
+
+    std::size_t shared = 0;
+    old->forEachNode([&](const Node &node) {
+        if (&node == current->node(node.id())) {
+            shared++;
+        }
+    });
+
+    // Only the shard of n500 is copied
+    EXPECT_NE(old->node("n500"), current->node("n500"));
+    EXPECT_GT(shared, 900);
+    EXPECT_LT(shared, 1000);
+}
+
+TEST(ModelStore, HeldPointers) {
+    ModelStore store(chainModel(3));
+
+    Node *node = store.node("n1");
+    Section *section = store.section("s0");
+    node->metadata("k") = "1";
+    auto first = store.publish();
+    EXPECT_EQ(first->node("n1")->metadata("k"), "1");
+
+    // Changes after publication are still picked up
+    node->metadata("k") = "2";
+    ASSERT_TRUE(section->setLength(5));
+    auto second = store.publish();
+    EXPECT_EQ(second->version(), first->version() + 1);
+    EXPECT_EQ(second->node("n1")->metadata("k"), "2");
+    EXPECT_EQ(second->section("s0")->length(), 5);
+    EXPECT_EQ(first->node("n1")->metadata("k"), "1");
+
+    // So are writes through held metadata references
+    Metadata &held = node->metadata();
+    held["k"] = "3";
+    auto third = store.publish();
+    EXPECT_EQ(third->node("n1")->metadata("k"), "3");
+
+    // Nothing changed
+    EXPECT_EQ(store.publish(), third);
+}
+
+TEST(ModelStore, Destinations) {
+    ModelStore store;
+    ASSERT_EQ(store.addSection(Section("s1", Section::AllowedTravel::BIDIR,
+                                       std::make_unique<Destination>(
+                                           "1.0", "Station"))),
+              Model::AddResult::OK);
+    auto first = store.publish();
+    ASSERT_NE(first->sectionByAddress("1.0"), nullptr);
+    EXPECT_EQ(first->sectionByAddress("1.0")->id(), "s1");
+    EXPECT_EQ(first->sectionByAddress("1.0")->destination()->name(),
+              "Station");
+
+    ASSERT_EQ(store.removeSection("s1"), Model::RemoveResult::OK);
+    auto second = store.publish();
+    EXPECT_EQ(second->sectionByAddress("1.0"), nullptr);
+    EXPECT_NE(first->sectionByAddress("1.0"), nullptr);
+}
+
+TEST(ModelStore, Compiled) {
+    Model model = chainModel(10);
+    model.newSection("dest", Section::AllowedTravel::UNIDIR,
+                     std::make_unique<Destination>("1.0", "Station"));
+    model.newNode(END, "end");
+    model.link("dest", "n9", 1, "end", 0);
+
+    CompiledModel expected(model);
+    ModelStore store(std::move(model));
+    const CompiledModel &compiled = store.snapshot()->compiled();
+
+    ASSERT_EQ(compiled.nodeCount(), expected.nodeCount());
+    ASSERT_EQ(compiled.sectionCount(), expected.sectionCount());
+    EXPECT_EQ(compiled.destinationCount(), expected.destinationCount());
+    for (CompiledModel::Index i = 0; i < compiled.nodeCount(); i++) {
+        EXPECT_EQ(compiled.nodeId(i), expected.nodeId(i));
+        EXPECT_EQ(compiled.nodeType(i), expected.nodeType(i));
+    }
+    for (CompiledModel::Index i = 0; i < compiled.sectionCount(); i++) {
+        EXPECT_EQ(compiled.sectionId(i), expected.sectionId(i));
+    }
+    EXPECT_EQ(compiled.destinationIndex("1.0"),
+              expected.destinationIndex("1.0"));
+
+    EXPECT_EQ(&store.snapshot()->compiled(), &compiled);
+}
+
+TEST(ModelStore, ConcurrentReaders) {
+    constexpr std::size_t NODES = 100;
+    constexpr int EDITS = 200;
+
+    ModelStore store(chainModel(NODES));
+    std::atomic<bool> done = false;
+
+    auto reader = [&] {
+        std::uint64_t lastVersion = 0;
+        while (!done.load()) {
+            auto snapshot = store.snapshot();
+            EXPECT_GE(snapshot->version(), lastVersion);
+            lastVersion = snapshot->version();
+
+            // Every snapshot is internally consistent
+            std::size_t nodes = 0;
+            snapshot->forEachNode([&](const Node &) { nodes++; });
+            EXPECT_EQ(nodes, snapshot->nodeCount());
+            snapshot->forEachSection([&](const Section &section) {
+                if (section.isConnected()) {
+                    const Node *start = snapshot->node(section.start());
+                    ASSERT_NE(start, nullptr);
+                    EXPECT_EQ(start->section(section.startSlot()),
+                              section.id());
+                }
+            });
+        }
+    };
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back(reader);
+    }
+
+    for (int i = 0; i < EDITS; i++) {
+        std::string id = "x" + std::to_string(i);
+        store.addNode(Node(END, id));
+        store.addSection(Section("y" + std::to_string(i)));
+        if (i % 2 == 1) {
+            store.removeNode("x" + std::to_string(i - 1));
+        }
+        store.publish();
+    }
+
+    done = true;
+    for (auto &thread : readers) {
+        thread.join();
+    }
+
+    EXPECT_EQ(store.snapshot()->version(), EDITS + 1);
+    EXPECT_EQ(store.snapshot()->nodeCount(), NODES + EDITS / 2);
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include <piwcsprwmodel.h>
+
+#include <sstream>
+#include <vector>
+
+using namespace piwcs::prw;
+
+namespace {
+
+constexpr const char *SOURCE = R"json([
+    {
+        "n1": { "type":"THRU" },
+        "n2": { "type":"MOTORIZED", "metadata": { "k": "v" } }
+    },
+    {
+        "s1": {
+            "link": {
+                "startNode": "n1", "startSlot": 0,
+                "endNode": "n2", "endSlot": 1
+            },
+            "dir": "BIDIR",
+            "dest": {
+                "address": "1.0.1",
+                "name": "Station",
+                "metadata": { "dk": "dv" }
+            }
+        },
+        "s2": { "metadata": { "sk": "sv" } },
+        "s3": {
+            "link": {
+                "startNode": "n1", "startSlot": 0,
+                "endNode": "nX", "endSlot": 7
+            }
+        }
+    }
+])json";
+
+/*
+ * Records every callback as a line of text.
+ */
+class Recorder : public ModelVisitor {
+  public:
+    std::vector<std::string> log;
+
+    static std::string meta(const Metadata *m) {
+        std::string result;
+        if (m != nullptr) {
+            for (const auto &[key, value] : *m) {
+                result += " " + key + "=" + value;
+            }
+        }
+        return result;
+    }
+
+    void node(const NodeRecord &r) override {
+        log.push_back("node " + std::string(r.id) +
+                      (r.type == MOTORIZED ? " MOTORIZED" : " THRU") +
+                      meta(r.metadata));
+    }
+
+    void destination(const DestinationRecord &r) override {
+        log.push_back("dest " + std::string(r.section) + " " +
+                      std::string(r.address) + " " + std::string(r.name) +
+                      meta(r.metadata));
+    }
+
+    void section(const SectionRecord &r) override {
+        log.push_back("section " + std::string(r.id) + " " +
+                      std::to_string(static_cast<int>(r.dir)) + " " +
+                      (r.isDestination ? "dest" : "-") + meta(r.metadata));
+    }
+
+    void link(const LinkRecord &r) override {
+        log.push_back("link " + std::string(r.section) + " " +
+                      std::string(r.startNode) + ":" +
+                      std::to_string(r.startSlot) + " " +
+                      std::string(r.endNode) + ":" +
+                      std::to_string(r.endSlot));
+    }
+};
+
+const std::vector<std::string> EXPECTED = {
+    "node n1 THRU",
+    "node n2 MOTORIZED k=v",
+    "dest s1 1.0.1 Station dk=dv",
+    "section s1 2 dest",
+    "link s1 n1:0 n2:1",
+    "section s2 1 - sk=sv",
+    "section s3 1 -",
+    "link s3 n1:0 nX:7",
+};
+
+} // namespace
+
+TEST(ModelVisitor, Stream) {
+    Recorder recorder;
+    std::istringstream in(SOURCE);
+    visitModel(in, recorder);
+    EXPECT_EQ(recorder.log, EXPECTED);
+}
+
+TEST(ModelVisitor, Buffer) {
+    Recorder recorder;
+    visitModelBuffer(SOURCE, recorder);
+    EXPECT_EQ(recorder.log, EXPECTED);
+}
+
+TEST(ModelVisitor, DefaultCallbacks) {
+    ModelVisitor visitor;
+    EXPECT_NO_THROW(visitModelBuffer(SOURCE, visitor));
+}
+
+TEST(ModelVisitor, FormatErrors) {
+    ModelVisitor visitor;
+    EXPECT_THROW(visitModelBuffer("[{}]", visitor), InvalidFormatError);
+    EXPECT_THROW(visitModelBuffer(R"([{"n1":{"type":"X"}},{}])", visitor),
+                 InvalidFormatError);
+}
+
+TEST(ModelVisitor, Abort) {
+    struct Aborter : public ModelVisitor {
+        int count = 0;
+        void section(const SectionRecord & /*record*/) override {
+            if (++count == 2) {
+                throw std::logic_error("enough");
+            }
+        }
+    } aborter;
+
+    EXPECT_THROW(visitModelBuffer(SOURCE, aborter), std::logic_error);
+    EXPECT_EQ(aborter.count, 2);
+}
+
+TEST(ModelVisitor, ReadModelRejectsWhatVisitorAccepts) {
+    // The link of s3 refers to an unknown node
+    EXPECT_THROW(readModelBuffer(SOURCE), IllegalModelError);
+}